@@ -8,6 +8,8 @@
 #include <librealsense2/rs.hpp> // Include RealSense Cross Platform API
 #include <example.hpp>         // Include short list of convenience functions for rendering
 
+#include "../rs_run_devices/voxel.hpp"
+
 #include <thread>
 #include <queue>
 #include <atomic>
@@ -19,6 +21,8 @@ using namespace cv::kinfu;
 
 static float max_dist = 2.5;
 static float min_dist = 0;
+// Voxel size (m) of the exported pointcloud, 0 exports all points
+static float voxel_size = 0;
 
 
 // Assigns an RGB value for each point in the pointcloud, based on the depth value
@@ -102,8 +106,27 @@ void draw_kinfu_pointcloud(glfw_state& app_state, Mat points, Mat normals)
 }
 
 
+// Downsamples the pointcloud with a voxel grid (centroid of the points + normals per voxel)
+void voxelize_pointcloud(Mat& points, Mat& normals)
+{
+    if (voxel_size <= 0 || points.empty() || normals.empty())
+        return;
+
+    static workerpool pool;
+    voxelgrid grid(voxel_size, voxelgrid::CENTROID, &pool);
+    Mat p = points.isContinuous() ? points : points.clone();
+    Mat n = normals.isContinuous() ? normals : normals.clone();
+    size_t num_voxels = grid.process(p.ptr<float>(), p.total(), p.channels(),
+                                     nullptr, n.ptr<float>(), n.channels());
+
+    points = Mat((int)num_voxels, 1, CV_32FC3, (void*)grid.points()).clone();
+    normals = Mat((int)num_voxels, 1, CV_32FC3, (void*)grid.normals()).clone();
+}
+
 void export_to_ply(Mat points, Mat normals)
 {
+    voxelize_pointcloud(points, normals);
+
     // First generate a filename
     const size_t buffer_size = 50;
     char fname[buffer_size];
@@ -189,6 +212,10 @@ int main(int argc, char **argv)
     
     setUseOptimized(true);
 
+    // rs-kinfu [voxel_size]
+    if (argc > 1)
+        voxel_size = std::stof(argv[1]);
+
     printf("OpenCL Found : %s\n", cv::ocl::haveOpenCL() ? "true" : "false");
     printf("Using OpenCL : %s\n", cv::ocl::useOpenCL() ? "true" : "false");
 
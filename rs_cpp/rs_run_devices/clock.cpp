@@ -0,0 +1,165 @@
+#include "clock.hpp"
+
+// A jump of the sensor clock against the host clock above this restarts
+// the model.
+static const int64_t MAX_JUMP_NS = 1000000000;
+// Crystal drifts are well below this, larger slopes are noise.
+static const double MAX_DRIFT = 500e-6;
+
+clockmodel::clockmodel(const int64_t &bucket_ns, const size_t &window)
+    : bucket_ns(bucket_ns), window(std::max((size_t)3, window))
+{
+}
+
+void clockmodel::reset()
+{
+    started = false;
+    buckets.clear();
+    _offset = 0.0;
+    _slope = 1.0;
+    _residual_ns = 0.0;
+}
+
+int64_t clockmodel::update(const int64_t &sensor_ns, const int64_t &host_ns)
+{
+    if (started)
+    {
+        int64_t d_sensor = sensor_ns - last.sensor;
+        int64_t d_host = host_ns - last.host;
+        if (d_sensor < 0 || std::abs(d_sensor - d_host) > MAX_JUMP_NS)
+            reset();
+    }
+
+    sample s;
+    s.sensor = sensor_ns;
+    s.host = host_ns;
+    last = s;
+
+    if (!started)
+    {
+        started = true;
+        _sensor_reference = sensor_ns;
+        bucket_start = host_ns;
+        bucket_best = s;
+        _offset = (double)host_ns;
+        _slope = 1.0;
+    }
+    else if (host_ns - bucket_start >= bucket_ns)
+    {
+        add_bucket(bucket_best);
+        bucket_start = host_ns;
+        bucket_best = s;
+    }
+    else if (host_ns - sensor_ns < bucket_best.host - bucket_best.sensor)
+    {
+        bucket_best = s;
+    }
+
+    // offset only until the slope can be fitted.
+    if (buckets.size() < 3)
+        _offset = std::min(_offset, (double)(host_ns - (sensor_ns - _sensor_reference)));
+
+    return correct(sensor_ns);
+}
+
+int64_t clockmodel::correct(const int64_t &sensor_ns)
+{
+    return (int64_t)std::llround(_offset + _slope * (double)(sensor_ns - _sensor_reference));
+}
+
+void clockmodel::add_bucket(const sample &s)
+{
+    buckets.push_back(s);
+    while (buckets.size() > window)
+        buckets.pop_front();
+    if (buckets.size() >= 3)
+        fit();
+}
+
+void clockmodel::fit()
+{
+    size_t n = buckets.size();
+    std::vector<double> x(n);
+    std::vector<double> y(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        // relative to the first bucket to keep the precision.
+        x[i] = (double)(buckets[i].sensor - buckets[0].sensor);
+        y[i] = (double)(buckets[i].host - buckets[0].host);
+    }
+    std::vector<bool> inlier(n, true);
+
+    double a = 0.0;
+    double b = 1.0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        double mx = 0.0, my = 0.0;
+        int m = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (!inlier[i])
+                continue;
+            mx += x[i];
+            my += y[i];
+            m++;
+        }
+        mx /= m;
+        my /= m;
+        double sxx = 0.0, sxy = 0.0;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (!inlier[i])
+                continue;
+            sxx += (x[i] - mx) * (x[i] - mx);
+            sxy += (x[i] - mx) * (y[i] - my);
+        }
+        b = sxx > 0.0 ? sxy / sxx : 1.0;
+        b = std::max(1.0 - MAX_DRIFT, std::min(1.0 + MAX_DRIFT, b));
+        a = my - b * mx;
+
+        std::vector<double> residuals(n);
+        for (size_t i = 0; i < n; i++)
+            residuals[i] = std::abs(y[i] - (a + b * x[i]));
+        std::vector<double> sorted(residuals);
+        std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+        _residual_ns = sorted[n / 2];
+        if (pass == 0)
+            for (size_t i = 0; i < n; i++)
+                inlier[i] = residuals[i] <= 3.0 * _residual_ns;
+    }
+
+    _slope = b;
+    _offset = (double)buckets[0].host + a +
+              b * (double)(_sensor_reference - buckets[0].sensor);
+    _fit_count++;
+}
+
+int clockmodel::fit_count()
+{
+    return _fit_count;
+}
+
+int64_t clockmodel::sensor_reference()
+{
+    return _sensor_reference;
+}
+
+int64_t clockmodel::offset()
+{
+    return (int64_t)std::llround(_offset);
+}
+
+double clockmodel::slope()
+{
+    return _slope;
+}
+
+double clockmodel::drift_ppm()
+{
+    return (_slope - 1.0) * 1e6;
+}
+
+double clockmodel::residual_ns()
+{
+    return _residual_ns;
+}
@@ -0,0 +1,103 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+/**
+ * @brief Online model of a device clock in the host clock domain:
+ * host = offset + slope * (sensor - sensor_reference).
+ *
+ * The arrival time of a frame is its capture time + a transfer latency
+ * that is never below some floor but has large positive spikes. So per
+ * bucket (e.g. 1s) only the sample with the lowest (host - sensor) is kept,
+ * and the line is fitted (least squares, outliers > 3 median abs residuals
+ * rejected) through the last 'window' bucket minima. Until 3 buckets are
+ * there only the offset is tracked (slope 1).
+ * A sensor timestamp that goes backwards or jumps against the host clock
+ * (device reset) restarts the model.
+ *
+ */
+class clockmodel
+{
+public:
+    /**
+     * @brief Construct a new clockmodel object
+     *
+     * @param bucket_ns host time per bucket.
+     * @param window number of buckets used for the fit.
+     */
+    explicit clockmodel(const int64_t &bucket_ns = 1000000000,
+                        const size_t &window = 60);
+
+    /**
+     * @brief Adds a sample and returns the corrected timestamp of it.
+     *
+     * @param sensor_ns sensor timestamp in ns.
+     * @param host_ns host arrival timestamp in ns.
+     * @return int64_t sensor timestamp in the host domain, in ns.
+     */
+    int64_t update(const int64_t &sensor_ns, const int64_t &host_ns);
+
+    /**
+     * @brief Sensor timestamp in the host domain.
+     *
+     * @param sensor_ns sensor timestamp in ns.
+     * @return int64_t ns
+     */
+    int64_t correct(const int64_t &sensor_ns);
+
+    void reset();
+
+    /**
+     * @brief Number of fits so far, changes whenever the line is refitted.
+     *
+     * @return int
+     */
+    int fit_count();
+
+    int64_t sensor_reference();
+    int64_t offset();
+    double slope();
+    double drift_ppm();
+
+    /**
+     * @brief Median abs residual of the bucket minima of the last fit.
+     *
+     * @return double ns
+     */
+    double residual_ns();
+
+private:
+    struct sample
+    {
+        int64_t sensor;
+        int64_t host;
+    };
+
+    void add_bucket(const sample &s);
+    void fit();
+
+    int64_t bucket_ns;
+    size_t window;
+
+    bool started = false;
+    int64_t _sensor_reference = 0;
+    sample last;
+    // lowest (host - sensor) sample of the current bucket.
+    int64_t bucket_start = 0;
+    sample bucket_best;
+    std::deque<sample> buckets;
+
+    double _offset = 0.0;
+    double _slope = 1.0;
+    double _residual_ns = 0.0;
+    int _fit_count = 0;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "config.hpp"
+
+static int parse_int(const std::string &option,
+                     const std::string &value,
+                     const int &min_value)
+{
+    size_t pos = 0;
+    int x = 0;
+    try
+    {
+        x = std::stoi(value, &pos);
+    }
+    catch (const std::exception &)
+    {
+        pos = 0;
+    }
+    if (pos == 0 || pos != value.size() || x < min_value)
+        throw std::invalid_argument(option + " : invalid value '" + value +
+                                    "', expected an integer >= " +
+                                    std::to_string(min_value));
+    return x;
+}
+
+static rs2_format parse_format(rs2args &args,
+                               const std::string &option,
+                               const std::string &value)
+{
+    auto itr = args._SUPPORTED_FORMATS.find(value);
+    if (itr == args._SUPPORTED_FORMATS.end())
+        throw std::invalid_argument(option + " : unknown format '" + value + "'");
+    return itr->second;
+}
+
+int deviceconfig::fps() const
+{
+    return std::max(color.fps, depth.fps);
+}
+
+bool deviceconfig::depth_aligned() const
+{
+    return color.width == depth.width && color.height == depth.height;
+}
+
+rs2config::rs2config()
+{
+}
+
+rs2config::rs2config(rs2args &args)
+{
+    _steps = parse_int("--steps", args.getarg("--steps"), 1);
+    _reset_interval = args.reset_interval();
+    _metrics_printout_interval = args.metrics_printout_interval();
+    _verbose = args.verbose();
+    _network = args.network();
+    _hotplug = args.hotplug();
+    _flush_steps = args.flush_steps();
+    _ready_timeout_ms = args.ready_timeout_ms();
+    _ae_tolerance = args.ae_tolerance();
+    _ae_stable_frames = args.ae_stable_frames();
+    _ae_max_wait_ms = args.ae_max_wait_ms();
+    _trigger_post_sec = args.trigger_post_sec();
+    _save_path = args.save_path();
+    _reset_policy = args.reset_policy();
+    _record_mode = args.record_mode();
+    _motion_gate = args.motion_gate();
+    _depth_output = args.depth_output();
+    _pointcloud = args.pointcloud();
+    _sync = args.sync();
+
+    if (_reset_policy == "interval" && _reset_interval < 1)
+        throw std::invalid_argument("--reset-interval : has to be >= 1 with --reset-policy interval");
+    // the threads run independently, a step does not hold all devices.
+    if (args.multithreading() && args.fusion_extrinsics() != "none")
+        throw std::invalid_argument("--fusion-extrinsics : needs --multithreading false");
+
+    // a device without a section uses the global settings.
+    std::map<std::string, std::string> global_args;
+    for (auto const &key : args._DEVICE_KEYS)
+        global_args[key] = args.device_arg("", key);
+    defaults = parse_device(args, global_args, "--", deviceconfig());
+    _fps = defaults.fps();
+    for (auto const &device_args : args._DEVICE_ARGS)
+        devices[device_args.first] = parse_device(args,
+                                                  device_args.second,
+                                                  "[device " + device_args.first + "] ",
+                                                  defaults);
+}
+
+const deviceconfig &rs2config::device(const std::string &device_sn) const
+{
+    auto itr = devices.find(device_sn);
+    return itr != devices.end() ? itr->second : defaults;
+}
+
+std::map<std::string, std::string> rs2config::save_paths() const
+{
+    std::map<std::string, std::string> paths;
+    for (auto const &device : devices)
+        if (device.second.save_path != _save_path)
+            paths[device.first] = device.second.save_path;
+    return paths;
+}
+
+bool rs2config::saves_filtered_depth(const std::string &device_sn) const
+{
+    return device(device_sn).depth_filters != "none" && _depth_output != "raw";
+}
+
+deviceconfig rs2config::parse_device(rs2args &args,
+                                     const std::map<std::string, std::string> &values,
+                                     const std::string &prefix,
+                                     const deviceconfig &base)
+{
+    auto lookup = [&values](const std::string &key, std::string &value)
+    {
+        auto itr = values.find(key);
+        if (itr == values.end())
+            return false;
+        value = itr->second;
+        return true;
+    };
+
+    deviceconfig d = base;
+    std::string value;
+    const std::vector<std::pair<std::string, int streamsettings::*>> sizes{
+        {"width", &streamsettings::width},
+        {"height", &streamsettings::height},
+        {"fps", &streamsettings::fps}};
+    for (auto const &size : sizes)
+    {
+        if (lookup(size.first, value))
+            d.color.*size.second = d.depth.*size.second =
+                parse_int(prefix + size.first, value, 1);
+        if (lookup("color-" + size.first, value) && value != "0")
+            d.color.*size.second = parse_int(prefix + "color-" + size.first, value, 1);
+        if (lookup("depth-" + size.first, value) && value != "0")
+            d.depth.*size.second = parse_int(prefix + "depth-" + size.first, value, 1);
+    }
+    if (lookup("color-format", value))
+        d.color.format = parse_format(args, prefix + "color-format", value);
+    if (lookup("depth-format", value))
+        d.depth.format = parse_format(args, prefix + "depth-format", value);
+    if (lookup("depth-filters", value))
+        d.depth_filters = value;
+    if (lookup("save-path", value))
+    {
+        if (value.empty())
+            throw std::invalid_argument(prefix + "save-path : empty");
+        d.save_path = value;
+    }
+    return d;
+}
@@ -0,0 +1,163 @@
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <librealsense2/rs.hpp> // Include RealSense Cross Platform API
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rs_args.hpp"
+
+/**
+ * @brief Settings of a color or depth stream.
+ *
+ */
+struct streamsettings
+{
+    int width = 0;
+    int height = 0;
+    int fps = 0;
+    rs2_format format = RS2_FORMAT_ANY;
+};
+
+/**
+ * @brief What a device captures and where it is saved.
+ *
+ */
+struct deviceconfig
+{
+    streamsettings color;
+    streamsettings depth;
+    std::string depth_filters = "none";
+    std::string save_path;
+
+    /**
+     * @brief Rate of the steps of the device, the faster stream.
+     *
+     * @return int
+     */
+    int fps() const;
+
+    /**
+     * @brief Whether the depth is aligned to color, only if both streams
+     * have the same resolution. Otherwise the depth is kept at its own
+     * resolution + intrinsics, a low resolution color would downsample it.
+     *
+     * @return bool
+     */
+    bool depth_aligned() const;
+};
+
+/**
+ * @brief The arguments parsed + validated once.
+ *
+ * The getters of rs2args look up the argument and convert the string on
+ * every call, this class holds the values used while capturing and the
+ * stream settings of every device ([device <sn>] sections of --config).
+ * It does not change after the construction, so it can be read from the
+ * background threads (e.g. the restart of a device).
+ *
+ */
+class rs2config
+{
+public:
+    rs2config();
+
+    /**
+     * @brief Construct a new rs2config object
+     *
+     * @param args arguments (+ config file).
+     * @throw std::invalid_argument if an argument is invalid.
+     */
+    explicit rs2config(rs2args &args);
+
+    /**
+     * @brief Settings of a device, the global ones if it is not in the
+     * config file.
+     *
+     * @param device_sn device serial number.
+     * @return const deviceconfig&
+     */
+    const deviceconfig &device(const std::string &device_sn) const;
+
+    /**
+     * @brief Devices that are saved outside of --save-path.
+     *
+     * @return std::map<std::string, std::string> device_sn > save path.
+     */
+    std::map<std::string, std::string> save_paths() const;
+
+    /**
+     * @brief Whether the filtered depth of a device is saved, only if it
+     * has depth filters and --depth-output is not raw.
+     *
+     * @param device_sn device serial number.
+     * @return bool
+     */
+    bool saves_filtered_depth(const std::string &device_sn) const;
+
+    int steps() const { return _steps; };
+    int fps() const { return _fps; };
+    int reset_interval() const { return _reset_interval; };
+    int metrics_printout_interval() const { return _metrics_printout_interval; };
+    bool verbose() const { return _verbose; };
+    bool network() const { return _network; };
+    bool hotplug() const { return _hotplug; };
+    int flush_steps() const { return _flush_steps; };
+    int ready_timeout_ms() const { return _ready_timeout_ms; };
+    float ae_tolerance() const { return _ae_tolerance; };
+    int ae_stable_frames() const { return _ae_stable_frames; };
+    int ae_max_wait_ms() const { return _ae_max_wait_ms; };
+    float trigger_post_sec() const { return _trigger_post_sec; };
+    const std::string &save_path() const { return _save_path; };
+    const std::string &reset_policy() const { return _reset_policy; };
+    const std::string &record_mode() const { return _record_mode; };
+    const std::string &motion_gate() const { return _motion_gate; };
+    const std::string &depth_output() const { return _depth_output; };
+    const std::string &pointcloud() const { return _pointcloud; };
+    const std::string &sync() const { return _sync; };
+
+private:
+    /**
+     * @brief Applies the per device options on top of 'base'. 'width',
+     * 'height' and 'fps' set both streams, the 'color-*'/'depth-*' ones a
+     * single stream (0 = unchanged).
+     *
+     * @param args arguments, for the supported formats.
+     * @param values option name without '--' > value.
+     * @param prefix where the options come from, for the errors.
+     * @param base settings the options are applied to.
+     * @return deviceconfig
+     */
+    deviceconfig parse_device(rs2args &args,
+                              const std::map<std::string, std::string> &values,
+                              const std::string &prefix,
+                              const deviceconfig &base);
+
+    int _steps = 0;
+    int _fps = 0;
+    int _reset_interval = 0;
+    int _metrics_printout_interval = 0;
+    bool _verbose = false;
+    bool _network = false;
+    bool _hotplug = false;
+    int _flush_steps = 0;
+    int _ready_timeout_ms = 0;
+    float _ae_tolerance = 0.0f;
+    int _ae_stable_frames = 0;
+    int _ae_max_wait_ms = 0;
+    float _trigger_post_sec = 0.0f;
+    std::string _save_path;
+    std::string _reset_policy;
+    std::string _record_mode;
+    std::string _motion_gate;
+    std::string _depth_output;
+    std::string _pointcloud;
+    std::string _sync;
+
+    deviceconfig defaults;
+    std::map<std::string, deviceconfig> devices;
+};
+
+#endif
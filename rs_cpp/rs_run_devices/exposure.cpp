@@ -0,0 +1,89 @@
+#include "exposure.hpp"
+
+aeconvergence::aeconvergence(const float &tolerance, const int &stable_frames)
+    : tolerance(std::max(0.0f, tolerance)),
+      stable_frames(std::max(1, stable_frames))
+{
+}
+
+void aeconvergence::reset()
+{
+    num_frames = 0;
+    num_stable = 0;
+    last_exposure = -1.0;
+    last_gain = -1.0;
+    last_brightness = -1.0;
+}
+
+bool aeconvergence::stable(const double &value, const double &last, const double &scale)
+{
+    // unknown values do not block the convergence.
+    if (value < 0.0)
+        return true;
+    if (last < 0.0)
+        return false;
+    return std::abs(value - last) <= tolerance * scale;
+}
+
+bool aeconvergence::update(const double &exposure,
+                           const double &gain,
+                           const double &brightness)
+{
+    bool is_stable = num_frames > 0 &&
+                     stable(exposure, last_exposure, std::max(1.0, last_exposure)) &&
+                     stable(gain, last_gain, std::max(1.0, last_gain)) &&
+                     stable(brightness, last_brightness, 255.0);
+    num_stable = is_stable ? num_stable + 1 : 0;
+    num_frames++;
+    last_exposure = exposure;
+    last_gain = gain;
+    last_brightness = brightness;
+    return converged();
+}
+
+bool aeconvergence::converged()
+{
+    return num_stable >= stable_frames;
+}
+
+int aeconvergence::frames()
+{
+    return num_frames;
+}
+
+float aeconvergence::mean_brightness(const uint8_t *data,
+                                     const int &width_bytes,
+                                     const int &height,
+                                     const int &stride,
+                                     const int &downsample)
+{
+    int step = std::max(1, downsample);
+    uint64_t sum = 0;
+    uint64_t count = 0;
+    for (int y = 0; y < height; y += step)
+    {
+        const uint8_t *row = data + (size_t)y * stride;
+        int x = 0;
+#if defined(__SSE2__)
+        __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_setzero_si128();
+        for (; x + 16 <= width_bytes; x += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+        }
+        sum += (uint64_t)_mm_cvtsi128_si32(acc) +
+               (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (; x + 16 <= width_bytes; x += 16)
+            acc = vpadalq_u16(acc, vpaddlq_u8(vld1q_u8(row + x)));
+        sum += (uint64_t)vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+               vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+        for (; x < width_bytes; x++)
+            sum += row[x];
+        count += width_bytes;
+    }
+    return count > 0 ? (float)sum / (float)count : 0.0f;
+}
@@ -0,0 +1,88 @@
+#ifndef EXPOSURE_HPP
+#define EXPOSURE_HPP
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/**
+ * @brief Detects when the auto exposure of a camera has settled.
+ *
+ * Every frame gives its exposure, gain (from the metadata, < 0 if not
+ * supported) and mean brightness. The AE has converged once all of them
+ * changed by at most 'tolerance' (relative, brightness relative to 255)
+ * against the previous frame for 'stable_frames' frames in a row.
+ *
+ */
+class aeconvergence
+{
+public:
+    /**
+     * @brief Construct a new aeconvergence object
+     *
+     * @param tolerance max relative change between 2 frames.
+     * @param stable_frames frames in a row within the tolerance.
+     */
+    aeconvergence(const float &tolerance, const int &stable_frames);
+
+    void reset();
+
+    /**
+     * @brief Adds a frame.
+     *
+     * @param exposure actual exposure, < 0 if unknown.
+     * @param gain gain level, < 0 if unknown.
+     * @param brightness mean brightness [0, 255], < 0 if unknown.
+     * @return bool whether the AE has converged.
+     */
+    bool update(const double &exposure,
+                const double &gain,
+                const double &brightness);
+
+    bool converged();
+
+    /**
+     * @brief Number of frames added since the last reset.
+     *
+     * @return int
+     */
+    int frames();
+
+    /**
+     * @brief Mean of the bytes of every 'downsample'-th row (SSE2/NEON),
+     * i.e. the brightness for rgb/bgr/gray, for yuyv the chroma is included.
+     *
+     * @param data frame data.
+     * @param width_bytes bytes per row that are used (width * bpp).
+     * @param height height in pixels.
+     * @param stride row stride in bytes.
+     * @param downsample only every n-th row is used.
+     * @return float [0, 255]
+     */
+    static float mean_brightness(const uint8_t *data,
+                                 const int &width_bytes,
+                                 const int &height,
+                                 const int &stride,
+                                 const int &downsample = 4);
+
+private:
+    bool stable(const double &value, const double &last, const double &scale);
+
+    float tolerance;
+    int stable_frames;
+
+    int num_frames = 0;
+    int num_stable = 0;
+    double last_exposure = -1.0;
+    double last_gain = -1.0;
+    double last_brightness = -1.0;
+};
+
+#endif
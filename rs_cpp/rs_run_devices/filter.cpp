@@ -0,0 +1,822 @@
+#include "filter.hpp"
+
+// Disparity/depth values below this are treated as holes.
+static const float valid_threshold = 1e-6f;
+
+// (window, count) of the 8-frame history per persistence mode, same modes
+// as rs2::temporal_filter.
+static const int persistence_modes[9][2] = {
+    {0, 1}, // 0 : disabled
+    {8, 8}, // 1 : valid in 8/8
+    {3, 2}, // 2 : valid in 2/last 3
+    {4, 2}, // 3 : valid in 2/last 4
+    {8, 2}, // 4 : valid in 2/8
+    {2, 1}, // 5 : valid in 1/last 2
+    {5, 1}, // 6 : valid in 1/last 5
+    {8, 1}, // 7 : valid in 1/8
+    {0, 0}, // 8 : always on
+};
+
+/*******************************************************************************
+ * ROW KERNELS
+ ******************************************************************************/
+
+/**
+ * @brief Sets the values outside [lo, hi] to 0.
+ *
+ * @param src input row.
+ * @param dst output row, can be the same as src.
+ * @param n number of pixels.
+ * @param lo min valid value.
+ * @param hi max valid value.
+ */
+static void threshold_row(const uint16_t *src,
+                          uint16_t *dst,
+                          const int &n,
+                          const uint16_t &lo,
+                          const uint16_t &hi)
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vlo = _mm_set1_epi16((short)lo);
+    const __m128i vhi = _mm_set1_epi16((short)hi);
+    for (; x + 8 <= n; x += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+        // unsigned compares through saturating subtraction.
+        __m128i ge = _mm_cmpeq_epi16(_mm_subs_epu16(vlo, v), zero);
+        __m128i le = _mm_cmpeq_epi16(_mm_subs_epu16(v, vhi), zero);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_and_si128(v, _mm_and_si128(ge, le)));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint16x8_t vlo = vdupq_n_u16(lo);
+    const uint16x8_t vhi = vdupq_n_u16(hi);
+    for (; x + 8 <= n; x += 8)
+    {
+        uint16x8_t v = vld1q_u16(src + x);
+        uint16x8_t mask = vandq_u16(vcgeq_u16(v, vlo), vcleq_u16(v, vhi));
+        vst1q_u16(dst + x, vandq_u16(v, mask));
+    }
+#endif
+
+    for (; x < n; x++)
+    {
+        uint16_t v = src[x];
+        dst[x] = (v >= lo && v <= hi) ? v : 0;
+    }
+}
+
+/**
+ * @brief Converts Z16 depth to disparity (factor / depth), 0 stays 0.
+ *
+ * @param src depth row.
+ * @param dst disparity row.
+ * @param n number of pixels.
+ * @param factor depth to disparity factor.
+ */
+static void disparity_row(const uint16_t *src,
+                          float *dst,
+                          const int &n,
+                          const float &factor)
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 vfactor = _mm_set1_ps(factor);
+    const __m128 fzero = _mm_setzero_ps();
+    for (; x + 8 <= n; x += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+        // division by 0 gives inf, masked out afterwards.
+        __m128 dlo = _mm_and_ps(_mm_div_ps(vfactor, lo), _mm_cmpgt_ps(lo, fzero));
+        __m128 dhi = _mm_and_ps(_mm_div_ps(vfactor, hi), _mm_cmpgt_ps(hi, fzero));
+        _mm_storeu_ps(dst + x, dlo);
+        _mm_storeu_ps(dst + x + 4, dhi);
+    }
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+    const float32x4_t vfactor = vdupq_n_f32(factor);
+    const float32x4_t fzero = vdupq_n_f32(0.0f);
+    for (; x + 8 <= n; x += 8)
+    {
+        uint16x8_t v = vld1q_u16(src + x);
+        float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+        float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+        uint32x4_t mlo = vcgtq_f32(lo, fzero);
+        uint32x4_t mhi = vcgtq_f32(hi, fzero);
+        float32x4_t dlo = vdivq_f32(vfactor, lo);
+        float32x4_t dhi = vdivq_f32(vfactor, hi);
+        vst1q_f32(dst + x, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(dlo), mlo)));
+        vst1q_f32(dst + x + 4, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(dhi), mhi)));
+    }
+#endif
+
+    for (; x < n; x++)
+        dst[x] = src[x] > 0 ? factor / (float)src[x] : 0.0f;
+}
+
+/**
+ * @brief Converts disparity back to Z16 depth, rounded and clamped.
+ *
+ * @param src disparity row.
+ * @param dst depth row.
+ * @param n number of pixels.
+ * @param factor depth to disparity factor.
+ */
+static void depth_row(const float *src,
+                      uint16_t *dst,
+                      const int &n,
+                      const float &factor)
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128 vfactor = _mm_set1_ps(factor);
+    const __m128 fzero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 vmax = _mm_set1_ps(65535.0f);
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16(-32768);
+    for (; x + 8 <= n; x += 8)
+    {
+        __m128 dlo = _mm_loadu_ps(src + x);
+        __m128 dhi = _mm_loadu_ps(src + x + 4);
+        __m128 zlo = _mm_min_ps(_mm_add_ps(_mm_div_ps(vfactor, dlo), half), vmax);
+        __m128 zhi = _mm_min_ps(_mm_add_ps(_mm_div_ps(vfactor, dhi), half), vmax);
+        zlo = _mm_and_ps(zlo, _mm_cmpgt_ps(dlo, fzero));
+        zhi = _mm_and_ps(zhi, _mm_cmpgt_ps(dhi, fzero));
+        // SSE2 has no unsigned 32 -> 16 pack, shifts into the signed range.
+        __m128i ilo = _mm_sub_epi32(_mm_cvttps_epi32(zlo), bias32);
+        __m128i ihi = _mm_sub_epi32(_mm_cvttps_epi32(zhi), bias32);
+        __m128i packed = _mm_add_epi16(_mm_packs_epi32(ilo, ihi), bias16);
+        _mm_storeu_si128((__m128i *)(dst + x), packed);
+    }
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+    const float32x4_t vfactor = vdupq_n_f32(factor);
+    const float32x4_t fzero = vdupq_n_f32(0.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    for (; x + 8 <= n; x += 8)
+    {
+        float32x4_t dlo = vld1q_f32(src + x);
+        float32x4_t dhi = vld1q_f32(src + x + 4);
+        uint32x4_t zlo = vcvtq_u32_f32(vaddq_f32(vdivq_f32(vfactor, dlo), half));
+        uint32x4_t zhi = vcvtq_u32_f32(vaddq_f32(vdivq_f32(vfactor, dhi), half));
+        zlo = vandq_u32(zlo, vcgtq_f32(dlo, fzero));
+        zhi = vandq_u32(zhi, vcgtq_f32(dhi, fzero));
+        vst1q_u16(dst + x, vcombine_u16(vqmovn_u32(zlo), vqmovn_u32(zhi)));
+    }
+#endif
+
+    for (; x < n; x++)
+    {
+        float d = src[x];
+        dst[x] = d > 0.0f ? (uint16_t)std::min(factor / d + 0.5f, 65535.0f) : 0;
+    }
+}
+
+/**
+ * @brief One step of the vertical domain transform for a block of columns.
+ *
+ * cur = a * cur + (1 - a) * ref, if both are valid and differ by <= delta.
+ *
+ * @param ref already filtered neighbouring row.
+ * @param cur row to filter, updated in place.
+ * @param n number of pixels.
+ * @param alpha weight of cur.
+ * @param delta max difference that is smoothed.
+ */
+static void domain_transform_row(const float *ref,
+                                 float *cur,
+                                 const int &n,
+                                 const float &alpha,
+                                 const float &delta)
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128 va = _mm_set1_ps(alpha);
+    const __m128 vb = _mm_set1_ps(1.0f - alpha);
+    const __m128 vdelta = _mm_set1_ps(delta);
+    const __m128 vvalid = _mm_set1_ps(valid_threshold);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (; x + 4 <= n; x += 4)
+    {
+        __m128 r = _mm_loadu_ps(ref + x);
+        __m128 c = _mm_loadu_ps(cur + x);
+        __m128 diff = _mm_andnot_ps(sign, _mm_sub_ps(c, r));
+        __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(r, vvalid),
+                                            _mm_cmpgt_ps(c, vvalid)),
+                                 _mm_cmple_ps(diff, vdelta));
+        __m128 blend = _mm_add_ps(_mm_mul_ps(c, va), _mm_mul_ps(r, vb));
+        _mm_storeu_ps(cur + x, _mm_or_ps(_mm_and_ps(mask, blend), _mm_andnot_ps(mask, c)));
+    }
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+    const float32x4_t va = vdupq_n_f32(alpha);
+    const float32x4_t vb = vdupq_n_f32(1.0f - alpha);
+    const float32x4_t vdelta = vdupq_n_f32(delta);
+    const float32x4_t vvalid = vdupq_n_f32(valid_threshold);
+    for (; x + 4 <= n; x += 4)
+    {
+        float32x4_t r = vld1q_f32(ref + x);
+        float32x4_t c = vld1q_f32(cur + x);
+        uint32x4_t mask = vandq_u32(vandq_u32(vcgtq_f32(r, vvalid), vcgtq_f32(c, vvalid)),
+                                    vcleq_f32(vabdq_f32(c, r), vdelta));
+        float32x4_t blend = vmlaq_f32(vmulq_f32(c, va), r, vb);
+        vst1q_f32(cur + x, vbslq_f32(mask, blend, c));
+    }
+#endif
+
+    for (; x < n; x++)
+    {
+        float r = ref[x];
+        float c = cur[x];
+        if (r > valid_threshold && c > valid_threshold && std::fabs(c - r) <= delta)
+            cur[x] = c * alpha + r * (1.0f - alpha);
+    }
+}
+
+/**
+ * @brief Horizontal domain transform of a row from 'x' on, in one direction.
+ *
+ * @param row row to filter, updated in place.
+ * @param x first pixel to filter.
+ * @param end pixel where the pass stops (exclusive).
+ * @param step +1 left to right, -1 right to left.
+ * @param prev filtered value before 'x'.
+ * @param alpha weight of the current pixel.
+ * @param delta max difference that is smoothed.
+ */
+static void domain_transform_pass(float *row,
+                                  int x,
+                                  const int &end,
+                                  const int &step,
+                                  float prev,
+                                  const float &alpha,
+                                  const float &delta)
+{
+    for (; x != end; x += step)
+    {
+        float c = row[x];
+        if (prev > valid_threshold && c > valid_threshold && std::fabs(c - prev) <= delta)
+        {
+            c = c * alpha + prev * (1.0f - alpha);
+            row[x] = c;
+        }
+        prev = c;
+    }
+}
+
+/**
+ * @brief Horizontal domain transform of 4 rows, left to right then back.
+ *
+ * The recursion runs along the rows, so with SSE2 the 4 rows are processed
+ * in the lanes: blocks of 4x4 pixels are transposed, filtered column by
+ * column and transposed back.
+ *
+ * @param rows 4 rows to filter, updated in place.
+ * @param n number of pixels.
+ * @param alpha weight of the current pixel.
+ * @param delta max difference that is smoothed.
+ */
+static void domain_transform_horizontal(float *const *rows,
+                                        const int &n,
+                                        const float &alpha,
+                                        const float &delta)
+{
+#if defined(__SSE2__)
+    const __m128 va = _mm_set1_ps(alpha);
+    const __m128 vb = _mm_set1_ps(1.0f - alpha);
+    const __m128 vdelta = _mm_set1_ps(delta);
+    const __m128 vvalid = _mm_set1_ps(valid_threshold);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    float lanes[4];
+
+    // one recursion step for the 4 rows.
+    auto filter = [&](__m128 &prev, __m128 &c)
+    {
+        __m128 diff = _mm_andnot_ps(sign, _mm_sub_ps(c, prev));
+        __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(prev, vvalid),
+                                            _mm_cmpgt_ps(c, vvalid)),
+                                 _mm_cmple_ps(diff, vdelta));
+        __m128 blend = _mm_add_ps(_mm_mul_ps(c, va), _mm_mul_ps(prev, vb));
+        c = _mm_or_ps(_mm_and_ps(mask, blend), _mm_andnot_ps(mask, c));
+        prev = c;
+    };
+
+    // 1. left to right.
+    __m128 prev = _mm_set_ps(rows[3][0], rows[2][0], rows[1][0], rows[0][0]);
+    int x = 1;
+    for (; x + 4 <= n; x += 4)
+    {
+        __m128 c0 = _mm_loadu_ps(rows[0] + x);
+        __m128 c1 = _mm_loadu_ps(rows[1] + x);
+        __m128 c2 = _mm_loadu_ps(rows[2] + x);
+        __m128 c3 = _mm_loadu_ps(rows[3] + x);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        filter(prev, c0);
+        filter(prev, c1);
+        filter(prev, c2);
+        filter(prev, c3);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(rows[0] + x, c0);
+        _mm_storeu_ps(rows[1] + x, c1);
+        _mm_storeu_ps(rows[2] + x, c2);
+        _mm_storeu_ps(rows[3] + x, c3);
+    }
+    _mm_storeu_ps(lanes, prev);
+    for (int r = 0; r < 4; r++)
+        domain_transform_pass(rows[r], x, n, 1, lanes[r], alpha, delta);
+
+    // 2. right to left.
+    prev = _mm_set_ps(rows[3][n - 1], rows[2][n - 1], rows[1][n - 1], rows[0][n - 1]);
+    x = n - 2;
+    for (; x - 3 >= 0; x -= 4)
+    {
+        __m128 c0 = _mm_loadu_ps(rows[0] + x - 3);
+        __m128 c1 = _mm_loadu_ps(rows[1] + x - 3);
+        __m128 c2 = _mm_loadu_ps(rows[2] + x - 3);
+        __m128 c3 = _mm_loadu_ps(rows[3] + x - 3);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        filter(prev, c3);
+        filter(prev, c2);
+        filter(prev, c1);
+        filter(prev, c0);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(rows[0] + x - 3, c0);
+        _mm_storeu_ps(rows[1] + x - 3, c1);
+        _mm_storeu_ps(rows[2] + x - 3, c2);
+        _mm_storeu_ps(rows[3] + x - 3, c3);
+    }
+    _mm_storeu_ps(lanes, prev);
+    for (int r = 0; r < 4; r++)
+        domain_transform_pass(rows[r], x, -1, -1, lanes[r], alpha, delta);
+#else
+    for (int r = 0; r < 4; r++)
+    {
+        domain_transform_pass(rows[r], 1, n, 1, rows[r][0], alpha, delta);
+        domain_transform_pass(rows[r], n - 2, -1, -1, rows[r][n - 1], alpha, delta);
+    }
+#endif
+}
+
+/**
+ * @brief Temporal smoothing of a row against the last filtered frame.
+ *
+ * @param cur current row, updated in place.
+ * @param last last filtered row, updated in place.
+ * @param history 8-frame validity history per pixel, bit 0 = last frame.
+ * @param n number of pixels.
+ * @param alpha weight of the current frame.
+ * @param delta max difference that is smoothed.
+ * @param persistence_map whether a hole is filled, per history.
+ */
+static void temporal_row(float *cur,
+                         float *last,
+                         uint8_t *history,
+                         const int &n,
+                         const float &alpha,
+                         const float &delta,
+                         const bool *persistence_map)
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128 va = _mm_set1_ps(alpha);
+    const __m128 vb = _mm_set1_ps(1.0f - alpha);
+    const __m128 vdelta = _mm_set1_ps(delta);
+    const __m128 vvalid = _mm_set1_ps(valid_threshold);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (; x + 4 <= n; x += 4)
+    {
+        __m128 c = _mm_loadu_ps(cur + x);
+        __m128 p = _mm_loadu_ps(last + x);
+        __m128 cvalid = _mm_cmpgt_ps(c, vvalid);
+        __m128 diff = _mm_andnot_ps(sign, _mm_sub_ps(c, p));
+        __m128 close = _mm_and_ps(_mm_and_ps(cvalid, _mm_cmpgt_ps(p, vvalid)),
+                                  _mm_cmplt_ps(diff, vdelta));
+        __m128 blend = _mm_add_ps(_mm_mul_ps(c, va), _mm_mul_ps(p, vb));
+        __m128 out = _mm_or_ps(_mm_and_ps(close, blend), _mm_andnot_ps(close, c));
+        _mm_storeu_ps(cur + x, out);
+        _mm_storeu_ps(last + x, _mm_or_ps(_mm_and_ps(cvalid, out), _mm_andnot_ps(cvalid, p)));
+
+        // holes are rare, they and the history are handled per pixel.
+        int valid_bits = _mm_movemask_ps(cvalid);
+        for (int i = 0; i < 4; i++)
+        {
+            uint8_t h = history[x + i];
+            if (valid_bits & (1 << i))
+            {
+                history[x + i] = (uint8_t)((h << 1) | 1);
+            }
+            else
+            {
+                if (last[x + i] > valid_threshold && persistence_map[h])
+                    cur[x + i] = last[x + i];
+                history[x + i] = (uint8_t)(h << 1);
+            }
+        }
+    }
+#endif
+
+    for (; x < n; x++)
+    {
+        float c = cur[x];
+        float p = last[x];
+        uint8_t h = history[x];
+        if (c > valid_threshold)
+        {
+            if (p > valid_threshold && std::fabs(c - p) < delta)
+                c = c * alpha + p * (1.0f - alpha);
+            cur[x] = c;
+            last[x] = c;
+            history[x] = (uint8_t)((h << 1) | 1);
+        }
+        else
+        {
+            if (p > valid_threshold && persistence_map[h])
+                cur[x] = p;
+            history[x] = (uint8_t)(h << 1);
+        }
+    }
+}
+
+/*******************************************************************************
+ * depthfilter
+ ******************************************************************************/
+depthfilter::depthfilter(const float &depth_unit,
+                         const float &baseline,
+                         const float &focal_length,
+                         workerpool *pool)
+    : depth_unit(depth_unit),
+      // same as the float disparity of rs2::disparity_transform.
+      d2d_factor(baseline * focal_length / depth_unit),
+      pool(pool)
+{
+    set_temporal(temporal_alpha, temporal_delta, 3);
+    disable_temporal();
+    std::fill(durations_ns, durations_ns + NUM_STAGES, 0);
+}
+
+void depthfilter::set_threshold(const float &min_distance, const float &max_distance)
+{
+    threshold_min = min_distance > 0
+                        ? (uint16_t)std::min(std::ceil(min_distance / depth_unit), 65535.0f)
+                        : 0;
+    threshold_max = max_distance > 0
+                        ? (uint16_t)std::min(std::floor(max_distance / depth_unit), 65535.0f)
+                        : 0xFFFF;
+}
+
+void depthfilter::set_decimation(const int &magnitude)
+{
+    decimation = std::max(1, std::min(magnitude, 8));
+}
+
+void depthfilter::set_spatial(const float &alpha, const float &delta, const int &iterations)
+{
+    spatial_alpha = std::max(0.25f, std::min(alpha, 1.0f));
+    spatial_delta = std::max(1.0f, delta);
+    spatial_iterations = std::max(0, std::min(iterations, 5));
+}
+
+void depthfilter::set_temporal(const float &alpha, const float &delta, const int &persistence)
+{
+    temporal_alpha = std::max(0.0f, std::min(alpha, 1.0f));
+    temporal_delta = std::max(1.0f, delta);
+    temporal_enabled = true;
+
+    int mode = std::max(0, std::min(persistence, 8));
+    int window = persistence_modes[mode][0];
+    int count = persistence_modes[mode][1];
+    for (int h = 0; h < 256; h++)
+    {
+        int bits = 0;
+        for (int i = 0; i < window; i++)
+            bits += (h >> i) & 1;
+        persistence_map[h] = bits >= count;
+    }
+}
+
+void depthfilter::disable_temporal()
+{
+    temporal_enabled = false;
+}
+
+void depthfilter::configure(const std::string &spec)
+{
+    threshold_min = 0;
+    threshold_max = 0xFFFF;
+    decimation = 1;
+    spatial_iterations = 0;
+    disable_temporal();
+    if (spec.empty() || spec == "none")
+        return;
+
+    std::stringstream filters(spec);
+    std::string filter;
+    while (std::getline(filters, filter, ','))
+    {
+        std::stringstream tokens(filter);
+        std::string token;
+        std::string name;
+        std::vector<float> params;
+        std::getline(tokens, name, ':');
+        while (std::getline(tokens, token, ':'))
+            params.push_back(std::stof(token));
+
+        // defaults are the ones of the rs2 filters.
+        auto param = [&params](const size_t &i, const float &value)
+        { return i < params.size() ? params[i] : value; };
+
+        if (name == "threshold")
+            set_threshold(param(0, 0.15f), param(1, 4.0f));
+        else if (name == "decimation")
+            set_decimation((int)param(0, 2));
+        else if (name == "spatial")
+            set_spatial(param(0, 0.5f), param(1, 20.0f), (int)param(2, 2));
+        else if (name == "temporal")
+            set_temporal(param(0, 0.4f), param(1, 20.0f), (int)param(2, 3));
+        else
+            throw std::invalid_argument("depth filter unknown : " + name);
+    }
+}
+
+bool depthfilter::enabled()
+{
+    return threshold_min > 0 || threshold_max < 0xFFFF || decimation > 1 ||
+           spatial_iterations > 0 || temporal_enabled;
+}
+
+void depthfilter::reset()
+{
+    std::fill(last_disparity.begin(), last_disparity.end(), 0.0f);
+    std::fill(history.begin(), history.end(), 0);
+}
+
+int depthfilter::out_width()
+{
+    return _out_width;
+}
+
+int depthfilter::out_height()
+{
+    return _out_height;
+}
+
+int depthfilter::get_decimation()
+{
+    return decimation;
+}
+
+int64_t depthfilter::stage_duration_ns(const stage &s)
+{
+    return durations_ns[s];
+}
+
+std::string depthfilter::stage_name(const stage &s)
+{
+    switch (s)
+    {
+    case THRESHOLD_DECIMATION:
+        return "threshold_decimation";
+    case DISPARITY:
+        return "disparity";
+    case SPATIAL:
+        return "spatial";
+    case TEMPORAL:
+        return "temporal";
+    case DEPTH:
+        return "depth";
+    default:
+        return "unknown";
+    }
+}
+
+void depthfilter::allocate(const int &width, const int &height)
+{
+    in_width = width;
+    in_height = height;
+    _out_width = width / decimation;
+    _out_height = height / decimation;
+    size_t n = (size_t)_out_width * _out_height;
+    disparity.assign(n, 0.0f);
+    last_disparity.assign(n, 0.0f);
+    history.assign(n, 0);
+}
+
+void depthfilter::process(const uint16_t *src,
+                          const int &width,
+                          const int &height,
+                          const int &stride,
+                          uint16_t *dst)
+{
+    if (width != in_width || height != in_height ||
+        width / decimation != _out_width || height / decimation != _out_height)
+        allocate(width, height);
+
+    bool use_disparity = spatial_iterations > 0 || temporal_enabled;
+    std::fill(durations_ns, durations_ns + NUM_STAGES, 0);
+    std::chrono::steady_clock::time_point t0, t1;
+
+    t0 = std::chrono::steady_clock::now();
+    threshold_decimation(src, stride, dst);
+    t1 = std::chrono::steady_clock::now();
+    durations_ns[THRESHOLD_DECIMATION] =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+    if (!use_disparity)
+        return;
+
+    t0 = t1;
+    to_disparity(dst);
+    t1 = std::chrono::steady_clock::now();
+    durations_ns[DISPARITY] =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+    if (spatial_iterations > 0)
+    {
+        t0 = t1;
+        spatial();
+        t1 = std::chrono::steady_clock::now();
+        durations_ns[SPATIAL] =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    }
+
+    if (temporal_enabled)
+    {
+        t0 = t1;
+        temporal();
+        t1 = std::chrono::steady_clock::now();
+        durations_ns[TEMPORAL] =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    }
+
+    t0 = t1;
+    to_depth(dst);
+    t1 = std::chrono::steady_clock::now();
+    durations_ns[DEPTH] =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+}
+
+void depthfilter::threshold_decimation(const uint16_t *src,
+                                       const int &stride,
+                                       uint16_t *dst)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(src);
+    const int w = _out_width;
+    const int s = decimation;
+    const uint16_t lo = threshold_min;
+    const uint16_t hi = threshold_max;
+
+    if (s == 1)
+    {
+        parallel_for(0, _out_height, [&](int y0, int y1)
+                     {
+            for (int y = y0; y < y1; y++)
+                threshold_row(reinterpret_cast<const uint16_t *>(bytes + (size_t)y * stride),
+                              dst + (size_t)y * w, w, lo, hi); });
+        return;
+    }
+
+    // The threshold is applied while gathering the blocks, the values out of
+    // range are ignored like holes.
+    parallel_for(0, _out_height, [&](int y0, int y1)
+                 {
+        uint16_t block[64];
+        for (int y = y0; y < y1; y++)
+        {
+            uint16_t *out = dst + (size_t)y * w;
+            for (int x = 0; x < w; x++)
+            {
+                int count = 0;
+                uint32_t sum = 0;
+                for (int j = 0; j < s; j++)
+                {
+                    const uint16_t *in = reinterpret_cast<const uint16_t *>(
+                        bytes + (size_t)(y * s + j) * stride) + x * s;
+                    for (int i = 0; i < s; i++)
+                    {
+                        uint16_t v = in[i];
+                        if (v == 0 || v < lo || v > hi)
+                            continue;
+                        block[count++] = v;
+                        sum += v;
+                    }
+                }
+                if (count == 0)
+                {
+                    out[x] = 0;
+                }
+                else if (s <= 3)
+                {
+                    // median of the valid values, insertion sort of <= 9 values.
+                    for (int i = 1; i < count; i++)
+                    {
+                        uint16_t v = block[i];
+                        int k = i - 1;
+                        for (; k >= 0 && block[k] > v; k--)
+                            block[k + 1] = block[k];
+                        block[k + 1] = v;
+                    }
+                    out[x] = block[count / 2];
+                }
+                else
+                {
+                    out[x] = (uint16_t)(sum / count);
+                }
+            }
+        } });
+}
+
+void depthfilter::to_disparity(const uint16_t *src)
+{
+    const int w = _out_width;
+    parallel_for(0, _out_height, [&](int y0, int y1)
+                 {
+        for (int y = y0; y < y1; y++)
+            disparity_row(src + (size_t)y * w, &disparity[(size_t)y * w], w, d2d_factor); });
+}
+
+void depthfilter::to_depth(uint16_t *dst)
+{
+    const int w = _out_width;
+    parallel_for(0, _out_height, [&](int y0, int y1)
+                 {
+        for (int y = y0; y < y1; y++)
+            depth_row(&disparity[(size_t)y * w], dst + (size_t)y * w, w, d2d_factor); });
+}
+
+void depthfilter::spatial()
+{
+    const int w = _out_width;
+    const int h = _out_height;
+    float *d = disparity.data();
+
+    for (int it = 0; it < spatial_iterations; it++)
+    {
+        // 1. horizontal, rows in groups of 4.
+        parallel_for(0, (h + 3) / 4, [&](int b0, int b1)
+                     {
+            for (int y = b0 * 4; y < std::min(h, b1 * 4); y += 4)
+            {
+                float *rows[4] = {d + (size_t)y * w,
+                                  d + (size_t)(y + 1) * w,
+                                  d + (size_t)(y + 2) * w,
+                                  d + (size_t)(y + 3) * w};
+                if (y + 4 <= h)
+                {
+                    domain_transform_horizontal(rows, w, spatial_alpha, spatial_delta);
+                    continue;
+                }
+                for (int r = 0; y + r < h; r++)
+                {
+                    domain_transform_pass(rows[r], 1, w, 1, rows[r][0],
+                                          spatial_alpha, spatial_delta);
+                    domain_transform_pass(rows[r], w - 2, -1, -1, rows[r][w - 1],
+                                          spatial_alpha, spatial_delta);
+                }
+            }
+        });
+
+        // 2. vertical, the recursion runs over the rows so the columns are
+        // split over the tasks (and SIMD lanes), top to bottom and back.
+        parallel_for(0, (w + 15) / 16, [&](int b0, int b1)
+                     {
+            int x0 = b0 * 16;
+            int n = std::min(w, b1 * 16) - x0;
+            for (int y = 1; y < h; y++)
+                domain_transform_row(d + (size_t)(y - 1) * w + x0,
+                                     d + (size_t)y * w + x0,
+                                     n, spatial_alpha, spatial_delta);
+            for (int y = h - 2; y >= 0; y--)
+                domain_transform_row(d + (size_t)(y + 1) * w + x0,
+                                     d + (size_t)y * w + x0,
+                                     n, spatial_alpha, spatial_delta); });
+    }
+}
+
+void depthfilter::temporal()
+{
+    const int w = _out_width;
+    parallel_for(0, _out_height, [&](int y0, int y1)
+                 {
+        for (int y = y0; y < y1; y++)
+            temporal_row(&disparity[(size_t)y * w],
+                         &last_disparity[(size_t)y * w],
+                         &history[(size_t)y * w],
+                         w, temporal_alpha, temporal_delta, persistence_map); });
+}
+
+void depthfilter::parallel_for(const int &begin,
+                               const int &end,
+                               const std::function<void(int, int)> &fn)
+{
+    if (pool != nullptr)
+        pool->parallel_for(begin, end, fn);
+    else
+        fn(begin, end);
+}
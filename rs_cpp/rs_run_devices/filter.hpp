@@ -0,0 +1,196 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "workerpool.hpp"
+
+/**
+ * @brief In-house depth post-processing of Z16 frames.
+ *
+ * Follows the flow of the rs2 processing blocks
+ * (librealsense/examples/post-processing):
+ * 1. threshold + decimation, fused into one pass over the input.
+ * 2. depth -> disparity (float), only if spatial/temporal are used.
+ * 3. spatial, domain transform (recursive edge preserving) smoothing.
+ * 4. temporal, with a persistent per-pixel state (last value + history).
+ * 5. disparity -> depth (Z16).
+ *
+ * All buffers are allocated once per resolution. The rows (columns for the
+ * vertical spatial pass) are split over a 'workerpool' and the per-pixel
+ * kernels use SSE2/NEON when available.
+ *
+ */
+class depthfilter
+{
+public:
+    enum stage
+    {
+        THRESHOLD_DECIMATION = 0,
+        DISPARITY = 1,
+        SPATIAL = 2,
+        TEMPORAL = 3,
+        DEPTH = 4,
+        NUM_STAGES = 5,
+    };
+
+    /**
+     * @brief Construct a new depthfilter object
+     *
+     * @param depth_unit Depth unit of the Z16 values in meters.
+     * @param baseline Stereo baseline in meters.
+     * @param focal_length Focal length (fx) of the depth stream in pixels.
+     * @param pool Pool used for the row parallel loops, nullptr runs inline.
+     */
+    depthfilter(const float &depth_unit,
+                const float &baseline,
+                const float &focal_length,
+                workerpool *pool = nullptr);
+
+    /**
+     * @brief Range in meters, values outside are set to 0.
+     *
+     * @param min_distance min distance, <= 0 disables the lower bound.
+     * @param max_distance max distance, <= 0 disables the upper bound.
+     */
+    void set_threshold(const float &min_distance, const float &max_distance);
+
+    /**
+     * @brief Downsampling factor. 2-3 use the median, > 3 the mean of the
+     * valid values of a block (same as rs2::decimation_filter).
+     *
+     * @param magnitude factor, 1 disables the decimation.
+     */
+    void set_decimation(const int &magnitude);
+
+    /**
+     * @brief Domain transform smoothing (same params as rs2::spatial_filter).
+     *
+     * @param alpha weight of the current pixel [0.25, 1].
+     * @param delta max step (disparity) that is smoothed.
+     * @param iterations number of horizontal + vertical passes, 0 disables it.
+     */
+    void set_spatial(const float &alpha, const float &delta, const int &iterations);
+
+    /**
+     * @brief Temporal smoothing (same params as rs2::temporal_filter).
+     *
+     * @param alpha weight of the current frame [0, 1].
+     * @param delta max step (disparity) that is smoothed.
+     * @param persistence hole filling mode [0, 8], see rs2::temporal_filter.
+     */
+    void set_temporal(const float &alpha, const float &delta, const int &persistence);
+    void disable_temporal();
+
+    /**
+     * @brief Configures the filters from a spec, e.g. "threshold:0.5:5,spatial".
+     *
+     * Comma separated filters with optional ':' separated params:
+     * - threshold[:min:max]
+     * - decimation[:magnitude]
+     * - spatial[:alpha:delta:iterations]
+     * - temporal[:alpha:delta:persistence]
+     * The filters always run in the order above. "none" disables all.
+     *
+     * @param spec filter spec.
+     */
+    void configure(const std::string &spec);
+
+    /**
+     * @brief Whether any filter is enabled.
+     *
+     * @return bool
+     */
+    bool enabled();
+
+    /**
+     * @brief Filters a Z16 frame.
+     *
+     * @param src input frame.
+     * @param width width of the input.
+     * @param height height of the input.
+     * @param stride row stride of the input in bytes.
+     * @param dst output frame, out_width() * out_height() values. Can be the
+     *            same buffer as src if there is no decimation.
+     */
+    void process(const uint16_t *src,
+                 const int &width,
+                 const int &height,
+                 const int &stride,
+                 uint16_t *dst);
+
+    /**
+     * @brief Clears the temporal state.
+     *
+     */
+    void reset();
+
+    int out_width();
+    int out_height();
+    int get_decimation();
+
+    /**
+     * @brief Duration of a stage during the last 'process' call, 0 if skipped.
+     *
+     * @param s stage.
+     * @return int64_t ns
+     */
+    int64_t stage_duration_ns(const stage &s);
+    static std::string stage_name(const stage &s);
+
+private:
+    void allocate(const int &width, const int &height);
+    void threshold_decimation(const uint16_t *src, const int &stride, uint16_t *dst);
+    void to_disparity(const uint16_t *src);
+    void to_depth(uint16_t *dst);
+    void spatial();
+    void temporal();
+    void parallel_for(const int &begin,
+                      const int &end,
+                      const std::function<void(int, int)> &fn);
+
+    float depth_unit = 0.001f;
+    float d2d_factor = 0.0f;
+    workerpool *pool = nullptr;
+
+    uint16_t threshold_min = 0;
+    uint16_t threshold_max = 0xFFFF;
+    int decimation = 1;
+    float spatial_alpha = 0.5f;
+    float spatial_delta = 20.0f;
+    int spatial_iterations = 0;
+    float temporal_alpha = 0.4f;
+    float temporal_delta = 20.0f;
+    bool temporal_enabled = false;
+    // hole filling per 8-frame history of valid pixels.
+    bool persistence_map[256];
+
+    int in_width = 0;
+    int in_height = 0;
+    int _out_width = 0;
+    int _out_height = 0;
+
+    // Preallocated working buffers.
+    std::vector<float> disparity;
+    std::vector<float> last_disparity;
+    std::vector<uint8_t> history;
+
+    int64_t durations_ns[NUM_STAGES];
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "fusion.hpp"
+
+// Points per block of the transform loop.
+static const size_t BLOCK_SIZE = 16384;
+
+cloudfusion::cloudfusion(const float &voxel_size, workerpool *pool)
+    : pool(pool)
+{
+    if (voxel_size > 0.0f)
+        grid = std::make_shared<voxelgrid>(voxel_size, voxelgrid::CENTROID, pool);
+}
+
+int cloudfusion::load_extrinsics(const std::string &filename)
+{
+    std::ifstream txt(filename);
+    if (!txt.is_open())
+        throw std::invalid_argument("extrinsics file not found : " + filename);
+
+    int num_cameras = 0;
+    std::string line;
+    while (std::getline(txt, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        std::string device_sn;
+        if (!(ss >> device_sn))
+            continue;
+        std::vector<double> values;
+        double value;
+        while (ss >> value)
+            values.push_back(value);
+
+        float rotation[9];
+        float translation[3];
+        if (values.size() == 12)
+        {
+            for (int i = 0; i < 9; i++)
+                rotation[i] = (float)values[i];
+            for (int i = 0; i < 3; i++)
+                translation[i] = (float)values[9 + i];
+        }
+        else if (values.size() == 6)
+        {
+            // Rodrigues, R = I cos(a) + (1 - cos(a)) k k^T + sin(a) [k]x
+            double a = std::sqrt(values[0] * values[0] +
+                                 values[1] * values[1] +
+                                 values[2] * values[2]);
+            double k[3] = {0.0, 0.0, 0.0};
+            if (a > 1e-12)
+                for (int i = 0; i < 3; i++)
+                    k[i] = values[i] / a;
+            double c = std::cos(a);
+            double s = std::sin(a);
+            double r[9] = {
+                c + (1 - c) * k[0] * k[0],
+                (1 - c) * k[0] * k[1] - s * k[2],
+                (1 - c) * k[0] * k[2] + s * k[1],
+                (1 - c) * k[1] * k[0] + s * k[2],
+                c + (1 - c) * k[1] * k[1],
+                (1 - c) * k[1] * k[2] - s * k[0],
+                (1 - c) * k[2] * k[0] - s * k[1],
+                (1 - c) * k[2] * k[1] + s * k[0],
+                c + (1 - c) * k[2] * k[2]};
+            // marker (world) -> camera, inverted : R^T, -R^T t
+            for (int i = 0; i < 3; i++)
+            {
+                translation[i] = 0.0f;
+                for (int j = 0; j < 3; j++)
+                {
+                    rotation[i * 3 + j] = (float)r[j * 3 + i];
+                    translation[i] -= (float)(r[j * 3 + i] * values[3 + j]);
+                }
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("extrinsics of " + device_sn +
+                                        " need 12 or 6 values");
+        }
+        set_extrinsics(device_sn, rotation, translation);
+        num_cameras++;
+    }
+    return num_cameras;
+}
+
+void cloudfusion::set_extrinsics(const std::string &device_sn,
+                                 const float *rotation,
+                                 const float *translation)
+{
+    transform t;
+    std::copy(rotation, rotation + 9, t.rotation);
+    std::copy(translation, translation + 3, t.translation);
+    transforms[device_sn] = t;
+}
+
+bool cloudfusion::has_extrinsics(const std::string &device_sn)
+{
+    return transforms.find(device_sn) != transforms.end();
+}
+
+size_t cloudfusion::process(const std::map<std::string, fusionframe> &frames)
+{
+    struct block
+    {
+        const fusionframe *frame;
+        const transform *t;
+        size_t begin;
+        size_t end;
+        size_t offset;
+    };
+
+    // 1. slices of the merged buffer + blocks.
+    std::vector<block> blocks;
+    size_t total = 0;
+    bool with_colors = true;
+    for (auto const &frame : frames)
+    {
+        auto t = transforms.find(frame.first);
+        if (t == transforms.end())
+            continue;
+        size_t n = frame.second.xyz.size() / 3;
+        with_colors = with_colors && frame.second.rgb.size() == n * 3;
+        for (size_t b = 0; b < n; b += BLOCK_SIZE)
+        {
+            block blk;
+            blk.frame = &frame.second;
+            blk.t = &t->second;
+            blk.begin = b;
+            blk.end = std::min(n, b + BLOCK_SIZE);
+            blk.offset = total + b;
+            blocks.push_back(blk);
+        }
+        total += n;
+    }
+    with_colors = with_colors && total > 0;
+    merged_xyz.resize(total * 3);
+    merged_rgb.resize(with_colors ? total * 3 : 0);
+
+    // 2. camera -> world, every block writes its own slice.
+    parallel_for(0, (int)blocks.size(), [&](int b0, int b1)
+                 {
+                     for (int b = b0; b < b1; b++)
+                     {
+                         const block &blk = blocks[b];
+                         const float *r = blk.t->rotation;
+                         const float *t = blk.t->translation;
+                         const float *src = blk.frame->xyz.data() + blk.begin * 3;
+                         float *dst = merged_xyz.data() + blk.offset * 3;
+                         for (size_t i = 0; i < blk.end - blk.begin; i++)
+                         {
+                             float x = src[i * 3 + 0];
+                             float y = src[i * 3 + 1];
+                             float z = src[i * 3 + 2];
+                             dst[i * 3 + 0] = r[0] * x + r[1] * y + r[2] * z + t[0];
+                             dst[i * 3 + 1] = r[3] * x + r[4] * y + r[5] * z + t[1];
+                             dst[i * 3 + 2] = r[6] * x + r[7] * y + r[8] * z + t[2];
+                         }
+                         if (with_colors)
+                             std::copy(blk.frame->rgb.begin() + blk.begin * 3,
+                                       blk.frame->rgb.begin() + blk.end * 3,
+                                       merged_rgb.begin() + blk.offset * 3);
+                     }
+                 });
+
+    // 3. removes the overlap.
+    if (grid)
+    {
+        num_points = grid->process(merged_xyz.data(), total, 3,
+                                   with_colors ? merged_rgb.data() : nullptr);
+        out_xyz = grid->points();
+        out_rgb = grid->colors();
+    }
+    else
+    {
+        num_points = total;
+        out_xyz = merged_xyz.data();
+        out_rgb = with_colors ? merged_rgb.data() : nullptr;
+    }
+    return num_points;
+}
+
+size_t cloudfusion::size()
+{
+    return num_points;
+}
+
+const float *cloudfusion::points()
+{
+    return out_xyz;
+}
+
+const uint8_t *cloudfusion::colors()
+{
+    return out_rgb;
+}
+
+void cloudfusion::parallel_for(const int &begin,
+                               const int &end,
+                               const std::function<void(int, int)> &fn)
+{
+    if (pool != nullptr)
+        pool->parallel_for(begin, end, fn);
+    else
+        fn(begin, end);
+}
@@ -0,0 +1,122 @@
+#ifndef FUSION_HPP
+#define FUSION_HPP
+
+#include <stdint.h>
+
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+#include "workerpool.hpp"
+#include "voxel.hpp"
+
+/**
+ * @brief Point cloud of one camera for a fusion tick, in the camera frame.
+ *
+ */
+struct fusionframe
+{
+    int64_t global_timestamp = -1;
+    std::vector<float> xyz;
+    std::vector<uint8_t> rgb;
+};
+
+/**
+ * @brief Merges the point clouds of several cameras into one cloud in a
+ * common world frame.
+ *
+ * The camera -> world transforms are read from a text file with one line
+ * per camera ('#' starts a comment):
+ * - <device_sn> r00 r01 r02 r10 r11 r12 r20 r21 r22 tx ty tz
+ *   rotation (row major) + translation (m) from the camera to the world.
+ * - <device_sn> rx ry rz tx ty tz
+ *   rvec/tvec of a marker in the camera frame, e.g. from
+ *   'estimate_pose' in rs_py/calibration/cv_aruco.py. The marker is the
+ *   world frame, so the pose is inverted.
+ *
+ * Every camera transforms its points into its own slice of the merged
+ * buffer (the slices are fixed by a prefix sum of the sizes), so the blocks
+ * of all cameras run on the pool without locks. The overlap between the
+ * cameras is removed by a voxel grid over the merged buffer.
+ *
+ */
+class cloudfusion
+{
+public:
+    /**
+     * @brief Construct a new cloudfusion object
+     *
+     * @param voxel_size voxel size of the deduplication, <= 0 disables it.
+     * @param pool Pool used for the transforms + voxel grid, nullptr runs inline.
+     */
+    explicit cloudfusion(const float &voxel_size, workerpool *pool = nullptr);
+
+    /**
+     * @brief Reads the camera -> world transforms (see class description).
+     *
+     * @param filename extrinsics file.
+     * @return int number of cameras read.
+     */
+    int load_extrinsics(const std::string &filename);
+
+    /**
+     * @brief Sets the camera -> world transform of a camera.
+     *
+     * @param device_sn device serial number.
+     * @param rotation 3x3 rotation, row major.
+     * @param translation translation in meters.
+     */
+    void set_extrinsics(const std::string &device_sn,
+                        const float *rotation,
+                        const float *translation);
+    bool has_extrinsics(const std::string &device_sn);
+
+    /**
+     * @brief Fuses the clouds of one tick. Cameras without a transform are
+     * skipped. The colors are kept if all used clouds have them.
+     *
+     * @param frames device_sn -> point cloud in the camera frame.
+     * @return size_t number of fused points.
+     */
+    size_t process(const std::map<std::string, fusionframe> &frames);
+
+    size_t size();
+
+    /**
+     * @brief Fused points (x,y,z in the world frame) and colors (r,g,b,
+     * nullptr if there are none) of the last tick.
+     *
+     */
+    const float *points();
+    const uint8_t *colors();
+
+private:
+    struct transform
+    {
+        float rotation[9];
+        float translation[3];
+    };
+
+    void parallel_for(const int &begin,
+                      const int &end,
+                      const std::function<void(int, int)> &fn);
+
+    workerpool *pool = nullptr;
+    std::map<std::string, transform> transforms;
+    std::shared_ptr<voxelgrid> grid;
+
+    std::vector<float> merged_xyz;
+    std::vector<uint8_t> merged_rgb;
+    const float *out_xyz = nullptr;
+    const uint8_t *out_rgb = nullptr;
+    size_t num_points = 0;
+};
+
+#endif
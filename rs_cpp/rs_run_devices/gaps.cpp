@@ -0,0 +1,83 @@
+#include "gaps.hpp"
+
+void gaptracker::update(const int64_t &frame_counter,
+                        const int64_t &timestamp_ns,
+                        const int &fps,
+                        int64_t &dropped,
+                        int64_t &jitter_ns)
+{
+    dropped = 0;
+    jitter_ns = 0;
+    int64_t period_ns = fps > 0 ? 1000000000 / fps : 0;
+
+    bool restarted = (frame_counter >= 0 && last_counter >= 0 && frame_counter <= last_counter) ||
+                     (timestamp_ns >= 0 && last_timestamp >= 0 && timestamp_ns <= last_timestamp);
+    if (!restarted && last_timestamp >= 0 && timestamp_ns >= 0)
+    {
+        int64_t interval_ns = timestamp_ns - last_timestamp;
+        if (frame_counter >= 0 && last_counter >= 0)
+            dropped = frame_counter - last_counter - 1;
+        else if (period_ns > 0)
+            dropped = std::max((int64_t)0, (int64_t)std::llround((double)interval_ns / period_ns) - 1);
+
+        if (period_ns > 0)
+        {
+            jitter_ns = interval_ns - period_ns * (dropped + 1);
+            jitter_count++;
+            jitter_sq_sum += (double)jitter_ns * (double)jitter_ns;
+            _jitter_max = std::max(_jitter_max, std::abs(jitter_ns));
+        }
+    }
+    else if (!restarted && frame_counter >= 0 && last_counter >= 0)
+    {
+        dropped = frame_counter - last_counter - 1;
+    }
+
+    if (frame_counter >= 0)
+        last_counter = frame_counter;
+    if (timestamp_ns >= 0)
+        last_timestamp = timestamp_ns;
+    _frames++;
+    _dropped += dropped;
+}
+
+void gaptracker::reset()
+{
+    last_counter = -1;
+    last_timestamp = -1;
+    _frames = 0;
+    _dropped = 0;
+    reset_jitter();
+}
+
+void gaptracker::reset_jitter()
+{
+    jitter_count = 0;
+    jitter_sq_sum = 0.0;
+    _jitter_max = 0;
+}
+
+int64_t gaptracker::frames()
+{
+    return _frames;
+}
+
+int64_t gaptracker::dropped()
+{
+    return _dropped;
+}
+
+double gaptracker::drop_rate()
+{
+    return _frames + _dropped > 0 ? (double)_dropped / (double)(_frames + _dropped) : 0.0;
+}
+
+double gaptracker::jitter_rms_ns()
+{
+    return jitter_count > 0 ? std::sqrt(jitter_sq_sum / jitter_count) : 0.0;
+}
+
+int64_t gaptracker::jitter_max_ns()
+{
+    return _jitter_max;
+}
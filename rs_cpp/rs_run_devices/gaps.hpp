@@ -0,0 +1,78 @@
+#ifndef GAPS_HPP
+#define GAPS_HPP
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Drops + jitter of the frames of a frameset, written into the
+ * timestamp journal.
+ *
+ */
+struct framegaps
+{
+    int64_t color_dropped = 0;
+    int64_t depth_dropped = 0;
+    // interval to the previous frame - nominal period(s), in us.
+    int64_t color_jitter_us = 0;
+    int64_t depth_jitter_us = 0;
+};
+
+/**
+ * @brief Tracks the frames librealsense dropped in a stream and the jitter
+ * of its timestamps.
+ *
+ * The frame counter (metadata) gives the frames dropped before a frame,
+ * without it they are estimated from the timestamp interval. The jitter is
+ * the interval to the previous frame minus the nominal period times the
+ * frames it spans. A counter or timestamp that goes back (stream restart)
+ * starts over without counting a gap.
+ *
+ */
+class gaptracker
+{
+public:
+    /**
+     * @brief Updates the stream with a frame.
+     *
+     * @param frame_counter frame counter metadata, -1 if unsupported.
+     * @param timestamp_ns timestamp of the frame in ns, -1 if unknown.
+     * @param fps nominal frame rate of the stream.
+     * @param dropped frames dropped before this frame.
+     * @param jitter_ns deviation of the interval from the nominal one.
+     */
+    void update(const int64_t &frame_counter,
+                const int64_t &timestamp_ns,
+                const int &fps,
+                int64_t &dropped,
+                int64_t &jitter_ns);
+
+    void reset();
+
+    int64_t frames();
+    int64_t dropped();
+    double drop_rate();
+    double jitter_rms_ns();
+    int64_t jitter_max_ns();
+
+    /**
+     * @brief Clears the jitter stats, e.g. after they are published, the
+     * drop counters keep running.
+     *
+     */
+    void reset_jitter();
+
+private:
+    int64_t last_counter = -1;
+    int64_t last_timestamp = -1;
+
+    int64_t _frames = 0;
+    int64_t _dropped = 0;
+    int64_t jitter_count = 0;
+    double jitter_sq_sum = 0.0;
+    int64_t _jitter_max = 0;
+};
+
+#endif
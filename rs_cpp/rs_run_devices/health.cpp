@@ -0,0 +1,209 @@
+#include "health.hpp"
+
+// Rates over fewer frames than this are noise.
+static const int MIN_WINDOW_FRAMES = 5;
+
+// Degrees below the max temperature before a device counts as cooled down.
+static const float TEMPERATURE_HYSTERESIS = 3.0f;
+
+static int64_t steady_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+resetscheduler::resetscheduler(const limits &l,
+                               const std::vector<std::vector<std::string>> &groups)
+    : l(l)
+{
+    for (auto const &group : groups)
+        for (auto const &device_sn : group)
+            for (auto const &peer : group)
+                if (peer != device_sn)
+                    peers[device_sn].push_back(peer);
+}
+
+std::vector<std::vector<std::string>> resetscheduler::parse_groups(
+    const std::string &groups,
+    const std::vector<std::string> &device_sns,
+    const bool &synced)
+{
+    std::vector<std::vector<std::string>> out;
+    if (groups == "auto")
+    {
+        if (synced)
+            out.push_back(device_sns);
+        else
+            for (auto const &device_sn : device_sns)
+                out.push_back({device_sn});
+        return out;
+    }
+
+    std::stringstream ss_groups(groups);
+    std::string group;
+    while (std::getline(ss_groups, group, ';'))
+    {
+        std::stringstream ss_group(group);
+        std::string device_sn;
+        std::vector<std::string> members;
+        while (std::getline(ss_group, device_sn, ','))
+            if (!device_sn.empty())
+                members.push_back(device_sn);
+        if (!members.empty())
+            out.push_back(members);
+    }
+    return out;
+}
+
+resetscheduler::health &resetscheduler::query(const std::string &device_sn,
+                                              const int64_t &now)
+{
+    auto itr = devices.find(device_sn);
+    if (itr == devices.end())
+    {
+        health &h = devices[device_sn];
+        h.last_arrival = now;
+        h.grace_until = now + l.grace_ns;
+        return h;
+    }
+    return itr->second;
+}
+
+void resetscheduler::push(health &h, const sample &s)
+{
+    h.window.push_back(s);
+    h.frames += s.frames;
+    h.drops += s.drops;
+    h.errors += s.errors;
+    while (!h.window.empty() && s.t - h.window.front().t > l.window_ns)
+    {
+        h.frames -= h.window.front().frames;
+        h.drops -= h.window.front().drops;
+        h.errors -= h.window.front().errors;
+        h.window.pop_front();
+    }
+}
+
+void resetscheduler::frame(const std::string &device_sn,
+                           const int64_t &sensor_timestamp,
+                           const bool &ok)
+{
+    int64_t now = steady_ns();
+    std::lock_guard<std::mutex> guard(mux);
+    health &h = query(device_sn, now);
+    h.last_arrival = now;
+
+    if (sensor_timestamp != -1 && sensor_timestamp == h.last_timestamp)
+        h.frozen++;
+    else
+        h.frozen = 0;
+    h.last_timestamp = sensor_timestamp;
+
+    sample s;
+    s.t = now;
+    s.frames = 1;
+    s.drops = 0;
+    s.errors = ok ? 0 : 1;
+    push(h, s);
+}
+
+void resetscheduler::dropped(const std::string &device_sn, const int64_t &count)
+{
+    int64_t now = steady_ns();
+    std::lock_guard<std::mutex> guard(mux);
+    health &h = query(device_sn, now);
+    sample s;
+    s.t = now;
+    s.frames = 0;
+    s.drops = count;
+    s.errors = 0;
+    push(h, s);
+}
+
+void resetscheduler::temperature(const std::string &device_sn, const float &celsius)
+{
+    if (l.max_temperature <= 0.0f)
+        return;
+
+    int64_t now = steady_ns();
+    std::lock_guard<std::mutex> guard(mux);
+    health &h = query(device_sn, now);
+    // a reset does not cool the device down, it is only reported. Once per
+    // crossing, the reading has to drop a few degrees to count again.
+    if (!h.hot && celsius > l.max_temperature)
+    {
+        h.hot = true;
+        metrics::instance().add(device_sn, "over_temperature", 1);
+        print(device_sn + " over temperature : " + std::to_string((int)celsius) + "C", 1);
+    }
+    else if (h.hot && celsius < l.max_temperature - TEMPERATURE_HYSTERESIS)
+    {
+        h.hot = false;
+    }
+}
+
+resetscheduler::action resetscheduler::decide(const std::string &device_sn,
+                                              std::string &reason)
+{
+    int64_t now = steady_ns();
+    std::lock_guard<std::mutex> guard(mux);
+    health &h = query(device_sn, now);
+    if (h.down || now < h.grace_until)
+        return NONE;
+
+    double drop_rate = h.frames + h.drops >= MIN_WINDOW_FRAMES
+                           ? (double)h.drops / (double)(h.frames + h.drops)
+                           : 0.0;
+    double error_rate = h.frames >= MIN_WINDOW_FRAMES
+                            ? (double)h.errors / (double)h.frames
+                            : 0.0;
+
+    reason = "";
+    if (now - h.last_arrival > l.max_empty_ns)
+        reason = "empty";
+    else if (h.frozen >= l.frozen_frames)
+        reason = "frozen";
+    else if (drop_rate > l.max_drop_rate)
+        reason = "drops";
+    else if (error_rate > l.max_error_rate)
+        reason = "errors";
+    if (reason.empty())
+        return NONE;
+
+    // staggered, one device of a group at a time.
+    metrics &m = metrics::instance();
+    for (auto const &peer : peers[device_sn])
+    {
+        auto itr = devices.find(peer);
+        if (itr != devices.end() && itr->second.down)
+        {
+            m.add(device_sn, "resets_deferred", 1);
+            return NONE;
+        }
+    }
+
+    action a = h.last_restart >= 0 && now - h.last_restart < l.escalate_ns
+                   ? HARDWARE_RESET
+                   : RESTART;
+    h.down = true;
+    h.last_restart = now;
+    m.add(device_sn, "resets_" + reason, 1);
+    m.set(device_sn, "health_drop_rate", drop_rate);
+    m.set(device_sn, "health_error_rate", error_rate);
+    return a;
+}
+
+void resetscheduler::done(const std::string &device_sn)
+{
+    int64_t now = steady_ns();
+    std::lock_guard<std::mutex> guard(mux);
+    health &h = query(device_sn, now);
+    int64_t last_restart = h.last_restart;
+    bool hot = h.hot;
+    h = health();
+    h.last_restart = last_restart;
+    h.hot = hot;
+    h.last_arrival = now;
+    h.grace_until = now + l.grace_ns;
+}
@@ -0,0 +1,163 @@
+#ifndef HEALTH_HPP
+#define HEALTH_HPP
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "metrics.hpp"
+
+/**
+ * @brief Decides the resets of the devices from their health instead of a
+ * fixed interval. A device is unhealthy when over the last window:
+ * - no frameset arrived for 'max_empty_ns' (empty polls),
+ * - its sensor timestamp stayed the same for 'frozen_frames' framesets,
+ * - the frame counter skipped more than 'max_drop_rate' of the frames,
+ * - or more than 'max_error_rate' of its framesets failed.
+ * A device hotter than 'max_temperature' is only reported (warning +
+ * 'over_temperature' metric), a reset does not cool it down.
+ * An unhealthy device gets a pipeline restart first, and a hardware reset
+ * if it is unhealthy again within 'escalate_ns' of the restart.
+ * Resets are staggered: a device of a group (e.g. the devices of the sync)
+ * is only reset while no other device of its group is down, otherwise it
+ * waits. After a reset a device has 'grace_ns' to settle.
+ *
+ * Shared by all threads, the health is in the metrics of each device.
+ *
+ */
+class resetscheduler
+{
+public:
+    enum action
+    {
+        NONE = 0,
+        RESTART = 1,
+        HARDWARE_RESET = 2,
+    };
+
+    struct limits
+    {
+        int64_t window_ns = 2000000000;
+        int64_t grace_ns = 2000000000;
+        int64_t escalate_ns = 30000000000;
+        int64_t max_empty_ns = 500000000;
+        int frozen_frames = 5;
+        double max_drop_rate = 0.2;
+        double max_error_rate = 0.5;
+        float max_temperature = 65.0f; // <= 0 disables the check.
+    };
+
+    /**
+     * @brief Construct a new resetscheduler object
+     *
+     * @param l health limits.
+     * @param groups devices that should not be down at the same time.
+     */
+    resetscheduler(const limits &l,
+                   const std::vector<std::vector<std::string>> &groups);
+
+    /**
+     * @brief Groups of the devices from a "sn,sn;sn,sn" list. "auto" puts all
+     * devices in one group if they are synced, else every device alone.
+     *
+     * @param groups list of the groups or "auto".
+     * @param device_sns all devices.
+     * @param synced whether the framesets of the devices are matched.
+     * @return std::vector<std::vector<std::string>>
+     */
+    static std::vector<std::vector<std::string>> parse_groups(
+        const std::string &groups,
+        const std::vector<std::string> &device_sns,
+        const bool &synced);
+
+    /**
+     * @brief Adds a frameset of a device.
+     *
+     * @param device_sn device serial number.
+     * @param sensor_timestamp sensor timestamp of the frameset, -1 if unknown.
+     * @param ok whether the frameset was processed without error.
+     */
+    void frame(const std::string &device_sn,
+               const int64_t &sensor_timestamp,
+               const bool &ok);
+
+    /**
+     * @brief Adds frames that were dropped, the frame counter gaps found by
+     * the gap trackers of the streams.
+     *
+     * @param device_sn device serial number.
+     * @param count number of dropped frames.
+     */
+    void dropped(const std::string &device_sn, const int64_t &count);
+
+    /**
+     * @brief Adds a temperature sample of a device, warns once when it gets
+     * hotter than 'max_temperature'.
+     *
+     * @param device_sn device serial number.
+     * @param celsius max of the ASIC/projector temperatures.
+     */
+    void temperature(const std::string &device_sn, const float &celsius);
+
+    /**
+     * @brief Checks the health of a device. If a reset is due and no other
+     * device of its group is down, the device is marked as down until
+     * 'done' is called.
+     *
+     * @param device_sn device serial number.
+     * @param reason why the device is reset.
+     * @return action reset to run, NONE if healthy or deferred.
+     */
+    action decide(const std::string &device_sn, std::string &reason);
+
+    /**
+     * @brief The device is back (or given up), the others of its group can
+     * be reset again. Its health starts over after the grace period.
+     *
+     * @param device_sn device serial number.
+     */
+    void done(const std::string &device_sn);
+
+private:
+    struct sample
+    {
+        int64_t t;
+        int frames;
+        int64_t drops;
+        int errors;
+    };
+
+    struct health
+    {
+        bool down = false;
+        int64_t grace_until = 0;
+        int64_t last_arrival = 0;
+        int64_t last_restart = -1;
+        int64_t last_timestamp = -1;
+        int frozen = 0;
+        bool hot = false;
+        std::deque<sample> window;
+        int frames = 0;
+        int64_t drops = 0;
+        int errors = 0;
+    };
+
+    // Must hold 'mux'.
+    health &query(const std::string &device_sn, const int64_t &now);
+    void push(health &h, const sample &s);
+
+    limits l;
+    std::map<std::string, std::vector<std::string>> peers;
+
+    std::mutex mux;
+    std::map<std::string, health> devices;
+};
+
+#endif
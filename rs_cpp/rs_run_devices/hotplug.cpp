@@ -0,0 +1,61 @@
+#include "hotplug.hpp"
+
+hotplugmonitor &hotplugmonitor::instance()
+{
+    static hotplugmonitor _monitor;
+    return _monitor;
+}
+
+void hotplugmonitor::attach(std::shared_ptr<rs2::context> ctx)
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        if (attached)
+            return;
+        attached = true;
+    }
+
+    ctx->set_devices_changed_callback(
+        [this](rs2::event_information &info)
+        {
+            deviceregistry &registry = deviceregistry::instance();
+            for (auto const &dev : registry.devices())
+            {
+                deviceregistry::entry e;
+                if (registry.find(dev[0], e) && info.was_removed(e.device))
+                    notify(dev[0], REMOVED);
+            }
+            for (auto &&dev : info.get_new_devices())
+                if (dev.supports(RS2_CAMERA_INFO_SERIAL_NUMBER))
+                    notify(dev.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER), ADDED);
+        });
+}
+
+hotplugmonitor::event hotplugmonitor::poll(const std::string &device_sn)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    auto itr = events.find(device_sn);
+    if (itr == events.end())
+        return NONE;
+    event e = itr->second;
+    events.erase(itr);
+    return e;
+}
+
+void hotplugmonitor::notify(const std::string &device_sn, const event &e)
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        auto itr = events.find(device_sn);
+        if (itr == events.end())
+            events[device_sn] = e;
+        else if (e == ADDED)
+            // the removal is not lost if the device is back before a poll.
+            itr->second = itr->second == ADDED ? ADDED : REATTACHED;
+        else
+            itr->second = e;
+    }
+    print(device_sn + (e == REMOVED ? " removed from the bus..." : " added to the bus..."),
+          e == REMOVED ? 1 : 0);
+    metrics::instance().add("hotplug", e == REMOVED ? "removed" : "added", 1);
+}
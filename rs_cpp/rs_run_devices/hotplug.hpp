@@ -0,0 +1,72 @@
+#ifndef HOTPLUG_HPP
+#define HOTPLUG_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "utils.hpp"
+#include "metrics.hpp"
+#include "registry.hpp"
+
+/**
+ * @brief Process wide hot-plug events of the local devices.
+ *
+ * A context has a single devices-changed callback, so one monitor is
+ * registered on the shared context and every wrapper polls the events of
+ * its own devices from its capture thread. Removed devices are recognized
+ * by their handle in the device registry.
+ * The events of a device before a poll are collapsed into one: removed +
+ * added gives 'REATTACHED' (the pipeline of the device is dead and it is
+ * back), added + removed gives 'REMOVED'.
+ *
+ */
+class hotplugmonitor
+{
+public:
+    enum event
+    {
+        NONE = 0,
+        REMOVED = 1,
+        ADDED = 2,
+        REATTACHED = 3, // removed and added again since the last poll
+    };
+
+    /**
+     * @brief Returns the global hot-plug monitor.
+     *
+     * @return hotplugmonitor&
+     */
+    static hotplugmonitor &instance();
+
+    /**
+     * @brief Registers the callback on the context, only once.
+     *
+     * @param ctx rs2 context shared by the wrappers.
+     */
+    void attach(std::shared_ptr<rs2::context> ctx);
+
+    /**
+     * @brief Takes the pending event of a device.
+     *
+     * @param device_sn device serial number.
+     * @return event NONE if nothing happened since the last poll.
+     */
+    event poll(const std::string &device_sn);
+
+    void notify(const std::string &device_sn, const event &e);
+
+private:
+    hotplugmonitor(){};
+    hotplugmonitor(const hotplugmonitor &) = delete;
+    hotplugmonitor &operator=(const hotplugmonitor &) = delete;
+
+    std::mutex mux;
+    bool attached = false;
+    std::map<std::string, event> events;
+};
+
+#endif
@@ -22,12 +22,19 @@
 
 // #include <tclap/CmdLine.h>
 #include "utils.hpp"
+#include "metrics.hpp"
+#include "retention.hpp"
+#include "rotation.hpp"
+#include "trigger.hpp"
+#include "sync.hpp"
+#include "startup.hpp"
+#include "registry.hpp"
+#include "config.hpp"
 #include "rs_wrapper.hpp"
 
 // GLOBAL PARAMETERS
 volatile sig_atomic_t stop = 0;
 const int num_zeros_to_pad = 16;
-std::mutex mux;
 
 /**
  * @brief A handler to detect when ctrl+c hotkey is pressed.
@@ -40,12 +47,80 @@ void inthand(int signum)
     print("ctrl + c detected", 1);
 }
 
+/**
+ * @brief A handler that triggers the recording (--record-mode trigger),
+ * e.g. with `kill -USR1 <pid>`.
+ *
+ * @param signum An atomic signal that can be used in multithreading.
+ */
+void trighand(int signum)
+{
+    eventtrigger::instance().fire_from_signal();
+}
+
+/**
+ * @brief Creates the frameset sync of all devices (--sync).
+ *
+ * The bundles are logged in <save_path>/_sync/<trial_idx>/sync.txt as
+ * <bundle timestamp>::<complete>::<device_sn>=<global timestamp>=<saved>::... ,
+ * the global timestamps being the filenames of the frames, that are only
+ * stored if 'saved' is 1 (motion gate / trigger).
+ *
+ * @param rs2_arg args.
+ * @param device_sns devices to be matched.
+ * @param rotator storage rotator, gives the current trial.
+ * @return std::shared_ptr<framesync> nullptr if --sync none.
+ */
+std::shared_ptr<framesync> create_framesync(rs2args &rs2_arg,
+                                            const std::vector<std::string> &device_sns,
+                                            std::shared_ptr<storagerotator> rotator)
+{
+    if (rs2_arg.sync() == "none")
+        return nullptr;
+
+    std::shared_ptr<framesync> sync = std::make_shared<framesync>(
+        device_sns,
+        (int64_t)(rs2_arg.sync_tolerance_ms() * 1e6),
+        (int64_t)(rs2_arg.sync_max_wait_ms() * 1e6),
+        rs2_arg.sync_queue());
+
+    // The consumer runs on the matcher thread only, the file stays open
+    // until the trial changes.
+    std::string sync_path = rs2_arg.save_path() + "/" + SYNC_FOLDER;
+    std::shared_ptr<std::ofstream> txt = std::make_shared<std::ofstream>();
+    std::shared_ptr<time_t> txt_trial_idx = std::make_shared<time_t>(-1);
+    sync->add_consumer(
+        [sync_path, rotator, txt, txt_trial_idx](const syncbundle &bundle)
+        {
+            std::shared_ptr<const storagepath> sp = rotator->current();
+            if (!sp)
+                return;
+            if (sp->trial_idx != *txt_trial_idx)
+            {
+                std::string path = sync_path + "/" + std::to_string(sp->trial_idx);
+                mkdir(sync_path.c_str(), 0777);
+                mkdir(path.c_str(), 0777);
+                txt->close();
+                txt->clear();
+                txt->open(path + "/sync.txt", std::ofstream::app);
+                *txt_trial_idx = sp->trial_idx;
+            }
+            *txt << bundle.timestamp << "::" << (bundle.complete ? 1 : 0);
+            for (auto const &frameset : bundle.framesets)
+                *txt << "::" << frameset.first << "=" << frameset.second.global_timestamp
+                     << "=" << (frameset.second.save ? 1 : 0);
+            *txt << "\n";
+        });
+    sync->start();
+    return sync;
+}
+
 /**
  * @brief Function to run per thread in multithreading.
  *
  * @param th_id Thread id.
- * @param argc From main.
- * @param argv From main.
+ * @param rs2_arg Arguments, parsed once in main.
+ * @param rs2_cfg Config parsed from the arguments.
  * @param context A rs::context object.
  * @param storagepaths A storagepath object. Used to create a set of
  *                     specific data storage paths.
@@ -53,68 +128,92 @@ void inthand(int signum)
  * @param num_devices Number of devices used in multithreading.
  * @param global_timestamp Steady clock time point to be used as the
  *                         initial time in the rs_wrapper.
+ * @param rotator Storage rotator shared by all threads.
+ * @param pool Worker pool of the depth filters shared by all threads.
+ * @param sync Frameset sync shared by all threads, can be nullptr.
+ * @param scheduler Initialization scheduler shared by all threads.
+ * @param resets Hardware reset service shared by all threads.
+ * @param health Reset scheduler shared by all threads.
+ * @param telemetry Telemetry sampler shared by all threads.
  */
 void multithreading_function(
     size_t th_id,
-    int argc,
-    char *argv[],
+    const rs2args &rs2_arg,
+    const rs2config &rs2_cfg,
     rs2::context context,
     std::string device_sn,
     size_t num_devices,
-    std::chrono::steady_clock::time_point global_timestamp)
+    std::chrono::steady_clock::time_point global_timestamp,
+    std::shared_ptr<storagerotator> rotator,
+    std::shared_ptr<workerpool> pool,
+    std::shared_ptr<framesync> sync,
+    std::shared_ptr<initscheduler> scheduler,
+    std::shared_ptr<resetservice> resets,
+    std::shared_ptr<resetscheduler> health,
+    std::shared_ptr<telemetrysampler> telemetry)
 {
-    std::this_thread::sleep_for(std::chrono::milliseconds(50 * (th_id + 1)));
-    rs2args rs2_arg = rs2args(argc, argv);
-
-    // if limit is given the stream needs to reset for it to take effect.
-    {
-        // Initializing RS devices in parallel can be problematic with libusb.
-        std::lock_guard<std::mutex> guard(mux);
-        rs2wrapper _rs2_dev(rs2_arg, false, context, device_sn);
-        _rs2_dev.initialize_depth_sensor_ae();
-    }
-
-    rs2wrapper rs2_dev(rs2_arg, context, device_sn);
-    rs2_dev.prepare_storage();
-
-    {
-        // Initializing RS devices in parallel can be problematic with libusb.
-        std::lock_guard<std::mutex> guard(mux);
-        rs2_dev.initialize(true);
-        rs2_dev.save_calib();
-        rs2_dev.flush_frames();
-    }
+    // The devices are initialized in parallel, a phase that collides with
+    // another device in libusb is retried by the scheduler.
+    rs2wrapper rs2_dev(rs2_arg, rs2_cfg, context, device_sn);
+    rs2_dev.set_storagerotator(rotator);
+    rs2_dev.set_workerpool(pool);
+    rs2_dev.set_framesync(sync);
+    rs2_dev.set_resetservice(resets);
+    rs2_dev.set_resetscheduler(health);
+    rs2_dev.set_telemetrysampler(telemetry);
+
+    scheduler->run(
+        device_sn,
+        "pipeline",
+        [&]
+        { rs2_dev.initialize(true); },
+        [&]
+        { rs2_dev.stop(); });
+    rs2_dev.save_calib();
+    scheduler->run(device_sn,
+                   "flush",
+                   [&]
+                   { rs2_dev.flush_frames(); });
+
+    metrics::instance().set(device_sn,
+                            "startup_ms",
+                            get_timestamp_duration_ns(global_timestamp) * 1e-6);
 
     // Uses the global timestamp as the initial time.
     rs2_dev.reset_global_timestamp(global_timestamp);
 
     // std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // The loop only reads the parsed config, the device steps at its own fps.
+    int fps = rs2_cfg.device(device_sn).fps();
+    int steps = rs2_cfg.steps();
     int i = 0;
-    int i_offset = rs2_arg.reset_interval() * th_id;
-    int i_range = rs2_arg.reset_interval() * num_devices;
+    int metrics_interval = fps * rs2_cfg.metrics_printout_interval();
+    bool reset_on_interval = rs2_cfg.reset_policy() == "interval";
+    int i_offset = rs2_cfg.reset_interval() * th_id;
+    int i_range = rs2_cfg.reset_interval() * num_devices;
     while (!stop)
     {
         std::string i_str = pad_zeros(std::to_string(i + 1), num_zeros_to_pad);
         std::string o_str = "";
 
-        // so that files are saved periodically (1hr) in different folders.
-        if (i % (rs2_arg.fps() * 60 * 60) == 0)
-            rs2_dev.prepare_storage();
-
         // Runs + collects frame data from realsense.
         rs2_dev.step();
         o_str += rs2_dev.get_output_msg();
         i++;
 
-        if (i % rs2_arg.fps() == 0)
+        if (i % fps == 0)
             print("Step " + i_str + "  " + o_str, 0);
 
-        // Occasionally resets the realsense device.
-        if ((i + i_offset) % i_range == 0)
+        // Only the first thread prints the metrics of the whole process.
+        if (th_id == 0 && metrics_interval > 0 && i % metrics_interval == 0)
+            metrics::instance().printout();
+
+        // Resets the devices one after the other (--reset-policy interval).
+        if (reset_on_interval && (i + i_offset) % i_range == 0)
             rs2_dev.reset(device_sn);
 
         // Runs + collects framne data from realsense.
-        if (i >= rs2_arg.steps())
+        if (i >= steps)
             break;
     }
 
@@ -125,12 +224,12 @@ void multithreading_function(
 /**
  * @brief Runs realsense in multithreading mo0de, 1 camera per thread.
  *
- * @param argc From main.
- * @param argv From main.
+ * @param rs2_arg Arguments, parsed once in main.
+ * @param rs2_cfg Config parsed from the arguments.
  * @return true
  * @return false If error occurs.
  */
-bool run_multithreading(int argc, char *argv[])
+bool run_multithreading(rs2args &rs2_arg, const rs2config &rs2_cfg)
 {
     try
     {
@@ -138,30 +237,121 @@ bool run_multithreading(int argc, char *argv[])
         std::vector<std::vector<std::string>> device_list;
         storagepath storagepaths;
 
+        // Local devices are enumerated once and cached for all threads.
+        if (rs2_cfg.network())
         {
-            rs2wrapper _rs2_dev = rs2wrapper(argc, argv, false, ctx, "-1");
+            rs2wrapper _rs2_dev = rs2wrapper(rs2_arg, rs2_cfg, false, ctx, "-1");
             device_list = _rs2_dev.get_available_devices();
             // _rs2_dev.prepare_storage();
             // storagepaths = _rs2_dev.get_storagepaths();
         }
+        else
+        {
+            deviceregistry::instance().enumerate(ctx);
+            device_list = deviceregistry::instance().devices();
+        }
 
         if (device_list.size() == 0)
             throw rs2::error("No RS device detected...");
 
         std::chrono::steady_clock::time_point global_timestamp = std::chrono::steady_clock::now();
 
+        // Evicts old trials in the background.
+        std::shared_ptr<storageretention> retention =
+            std::make_shared<storageretention>(
+                rs2_arg.save_path(),
+                (int64_t)rs2_arg.storage_max_mb() * 1024 * 1024,
+                (int64_t)rs2_arg.storage_min_free_mb() * 1024 * 1024,
+                rs2_arg.storage_check_interval());
+        retention->start();
+
+        // so that files are saved periodically (1hr) in different folders.
+        // The folders are created in the background, shared by all threads.
+        std::vector<std::string> device_sns;
+        for (auto const &device : device_list)
+            device_sns.push_back(device[0]);
+        std::shared_ptr<storagerotator> rotator =
+            std::make_shared<storagerotator>(
+                device_sns,
+                rs2_arg.save_path(),
+                rs2_arg.storage_rotation_interval(),
+                rs2_arg.storage_rotation_lead(),
+                rs2_cfg.save_paths());
+        rotator->add_rotation_callback(
+            [retention](const storagepath &sp)
+            {
+                for (auto const &device_sn : sp.device_sns)
+                    retention->set_active_trial(device_sn, sp.trial_idx);
+                retention->set_active_trial(SYNC_FOLDER, sp.trial_idx);
+                retention->set_active_trial(FUSION_FOLDER, sp.trial_idx);
+            });
+        std::set<std::string> filtered_sns;
+        for (auto const &device_sn : device_sns)
+            if (rs2_cfg.saves_filtered_depth(device_sn))
+                filtered_sns.insert(device_sn);
+        rotator->enable_depth_filtered(filtered_sns);
+        rotator->start();
+        for (auto const &device_sn : device_sns)
+            retention->set_active_trial(device_sn, rotator->current()->trial_idx);
+        retention->set_active_trial(SYNC_FOLDER, rotator->current()->trial_idx);
+        retention->set_active_trial(FUSION_FOLDER, rotator->current()->trial_idx);
+
+        // Depth filters + point clouds of all threads share the cores.
+        std::shared_ptr<workerpool> pool;
+        bool depth_filters = false;
+        for (auto const &device_sn : device_sns)
+            depth_filters |= rs2_cfg.device(device_sn).depth_filters != "none";
+        if (depth_filters || rs2_arg.pointcloud() != "none")
+            pool = std::make_shared<workerpool>(rs2_arg.filter_threads());
+
+        // Matches the framesets of the threads.
+        std::shared_ptr<framesync> sync = create_framesync(rs2_arg, device_sns, rotator);
+
+        // Initializes the devices in parallel.
+        std::shared_ptr<initscheduler> scheduler =
+            std::make_shared<initscheduler>(rs2_arg.init_concurrency(),
+                                            rs2_arg.init_retries(),
+                                            rs2_arg.init_backoff_ms());
+
+        // Hardware resets of all threads, limited to --reset-concurrency.
+        std::shared_ptr<resetservice> resets =
+            std::make_shared<resetservice>(std::make_shared<rs2::context>(ctx),
+                                           rs2_arg.reset_concurrency(),
+                                           rs2_arg.reset_timeout_ms(),
+                                           rs2_arg.usbip_bind_command());
+        if (rs2_arg.usbip_mapping() != "none")
+            resets->load_mapping(rs2_arg.usbip_mapping());
+
+        // Resets of unhealthy devices, staggered over all threads.
+        std::shared_ptr<resetscheduler> health =
+            rs2wrapper::create_resetscheduler(rs2_arg, device_sns);
+
+        // Samples the temperatures + options of all devices in the background.
+        std::shared_ptr<telemetrysampler> telemetry =
+            std::make_shared<telemetrysampler>(
+                rs2_arg.telemetry_interval_ms(),
+                rs2_arg.verbose() ? rs2_arg.camera_temperature_printout_interval() * 1000 : 0);
+
         size_t num_threads = device_list.size();
+        // The threads are joined before the args + config go out of scope.
         std::vector<std::thread> threads;
         for (size_t i = 0; i < num_threads; ++i)
             threads.push_back(
-                std::thread([=]
+                std::thread([=, &rs2_arg, &rs2_cfg]
                             { multithreading_function(i,
-                                                      argc,
-                                                      argv,
+                                                      rs2_arg,
+                                                      rs2_cfg,
                                                       ctx,
                                                       device_list[i][0],
                                                       num_threads,
-                                                      global_timestamp); }));
+                                                      global_timestamp,
+                                                      rotator,
+                                                      pool,
+                                                      sync,
+                                                      scheduler,
+                                                      resets,
+                                                      health,
+                                                      telemetry); }));
 
         for (int i = 0; i < num_threads; ++i)
         {
@@ -169,6 +359,13 @@ bool run_multithreading(int argc, char *argv[])
             std::cout << "joining t" << i << std::endl;
         }
 
+        telemetry->stop();
+        resets->stop();
+        if (sync)
+            sync->stop();
+        rotator->stop();
+        retention->stop();
+
         return EXIT_SUCCESS;
     }
     catch (const rs2::error &e)
@@ -190,39 +387,73 @@ bool run_multithreading(int argc, char *argv[])
 /**
  * @brief Runs realsense cameras in sequential mode.
  *
- * @param argc From main.
- * @param argv From main.
+ * @param rs2_arg Arguments, parsed once in main.
+ * @param rs2_cfg Config parsed from the arguments.
  * @return true
  * @return false If error occurs.
  */
-bool run(int argc, char *argv[])
+bool run(rs2args &rs2_arg, const rs2config &rs2_cfg)
 {
     try
     {
         rs2::context ctx;
-        rs2args rs2_arg = rs2args(argc, argv);
-
-        // if limit is given the stream needs to reset for it to take effect.
-        if (rs2_arg.depth_sensor_autoexposure_limit() !=
-            rs2_arg.default_depth_sensor_autoexposure_limit)
-        {
-            rs2wrapper _rs2_dev(rs2_arg, false, ctx, "-1");
-            _rs2_dev.initialize_depth_sensor_ae();
-        }
-
-        rs2wrapper rs2_dev(rs2_arg, ctx, "-1");
+        rs2wrapper rs2_dev(rs2_arg, rs2_cfg, ctx, "-1");
 
         auto available_devices = rs2_dev.get_available_devices();
         if (available_devices.size() == 0)
             throw rs2::error("No RS device detected...");
 
-        rs2_dev.prepare_storage();
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        // Evicts old trials in the background.
+        std::shared_ptr<storageretention> retention =
+            std::make_shared<storageretention>(
+                rs2_arg.save_path(),
+                (int64_t)rs2_arg.storage_max_mb() * 1024 * 1024,
+                (int64_t)rs2_arg.storage_min_free_mb() * 1024 * 1024,
+                rs2_arg.storage_check_interval());
+
+        // so that files are saved periodically (1hr) in different folders.
+        // The folders are created in the background.
+        std::vector<std::string> device_sns;
+        for (auto const &available_device : available_devices)
+            device_sns.push_back(available_device[0]);
+        std::shared_ptr<storagerotator> rotator =
+            std::make_shared<storagerotator>(
+                device_sns,
+                rs2_arg.save_path(),
+                rs2_arg.storage_rotation_interval(),
+                rs2_arg.storage_rotation_lead(),
+                rs2_cfg.save_paths());
+        rotator->add_rotation_callback(
+            [retention](const storagepath &sp)
+            {
+                for (auto const &device_sn : sp.device_sns)
+                    retention->set_active_trial(device_sn, sp.trial_idx);
+                retention->set_active_trial(SYNC_FOLDER, sp.trial_idx);
+                retention->set_active_trial(FUSION_FOLDER, sp.trial_idx);
+            });
+        std::set<std::string> filtered_sns;
+        for (auto const &device_sn : device_sns)
+            if (rs2_cfg.saves_filtered_depth(device_sn))
+                filtered_sns.insert(device_sn);
+        rotator->enable_depth_filtered(filtered_sns);
+        if (rs2_arg.fusion_extrinsics() != "none")
+            rotator->enable_fusion();
+        rotator->start();
+        for (auto const &device_sn : device_sns)
+            retention->set_active_trial(device_sn, rotator->current()->trial_idx);
+        retention->set_active_trial(SYNC_FOLDER, rotator->current()->trial_idx);
+        retention->set_active_trial(FUSION_FOLDER, rotator->current()->trial_idx);
+        retention->start();
+
+        rs2_dev.set_storagerotator(rotator);
+        std::shared_ptr<framesync> sync = create_framesync(rs2_arg, device_sns, rotator);
+        rs2_dev.set_framesync(sync);
 
         rs2_dev.initialize(true);
         rs2_dev.save_calib();
         rs2_dev.flush_frames();
 
+        bool reset_on_interval = rs2_cfg.reset_policy() == "interval";
         size_t dev_reset_loop = 0;
         size_t num_dev = rs2_dev.get_enabled_devices().size();
 
@@ -230,34 +461,40 @@ bool run(int argc, char *argv[])
         rs2_dev.reset_global_timestamp();
 
         int i = 0;
+        int steps = rs2_cfg.steps();
+        int reset_interval = rs2_cfg.reset_interval();
+        int metrics_interval = rs2_cfg.fps() * rs2_cfg.metrics_printout_interval();
         while (!stop)
         {
             std::string i_str = pad_zeros(std::to_string(i + 1), num_zeros_to_pad);
             std::string o_str = "";
 
-            // so that files are saved periodically (1hr) in different folders.
-            if ((i % (rs2_arg.fps() * 60 * 60) == 0) && (i > 0))
-                rs2_dev.prepare_storage();
-
             // Runs + collects frame data from realsense.
             rs2_dev.step();
             o_str += rs2_dev.get_output_msg();
             i++;
 
-            if (i % rs2_arg.fps() == 0)
+            if (i % rs2_cfg.fps() == 0)
                 print("Step " + i_str + "  " + o_str, 0);
 
-            // Occasionally resets the realsense device.
-            if (i % rs2_arg.reset_interval() == 0)
+            if (metrics_interval > 0 && i % metrics_interval == 0)
+                metrics::instance().printout();
+
+            // Resets the devices one after the other (--reset-policy interval).
+            if (reset_on_interval && i % reset_interval == 0)
             {
                 rs2_dev.reset(available_devices[dev_reset_loop][0]);
                 dev_reset_loop = (dev_reset_loop + 1) % num_dev;
             }
 
-            if (i >= rs2_arg.steps())
+            if (i >= steps)
                 break;
         }
         rs2_dev.stop();
+        if (sync)
+            sync->stop();
+        rotator->stop();
+        retention->stop();
         return EXIT_SUCCESS;
     }
     catch (const rs2::error &e)
@@ -280,14 +517,41 @@ int main(int argc, char *argv[])
 {
     signal(SIGINT, inthand);
 
-    rs2args args(argc, argv);
-    args.print_args();
+    rs2args args;
+    rs2config rs2_cfg;
+    try
+    {
+        args = rs2args(argc, argv);
+        args.print_args();
+
+        if (args.check_rs2args() == EXIT_FAILURE)
+            return EXIT_FAILURE;
+
+        // Validates all the arguments + devices of the config file upfront.
+        rs2_cfg = rs2config(args);
+    }
+    catch (const std::exception &e)
+    {
+        print(e.what(), 2);
+        return EXIT_FAILURE;
+    }
 
-    if (args.check_rs2args() == EXIT_FAILURE)
+    // Creates the trigger source before the handler can use it.
+    eventtrigger &trigger = eventtrigger::instance();
+    signal(SIGUSR1, trighand);
+    if (rs2_cfg.record_mode() == "trigger" && args.trigger_socket() != "none" &&
+        !trigger.start_socket(args.trigger_socket()))
+    {
+        print("no trigger can be received, exiting...", 2);
         return EXIT_FAILURE;
+    }
 
+    int status;
     if (args.multithreading())
-        return run_multithreading(argc, argv);
+        status = run_multithreading(args, rs2_cfg);
     else
-        return run(argc, argv);
+        status = run(args, rs2_cfg);
+
+    trigger.stop_socket();
+    return status;
 }
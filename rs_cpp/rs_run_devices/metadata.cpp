@@ -0,0 +1,118 @@
+#include "metadata.hpp"
+
+/**
+ * @brief "<field>," of every metadata field.
+ *
+ */
+static const std::vector<std::string> &field_names()
+{
+    static const std::vector<std::string> names = []
+    {
+        std::vector<std::string> _names(RS2_FRAME_METADATA_COUNT);
+        for (int i = 0; i < RS2_FRAME_METADATA_COUNT; i++)
+            _names[i] = std::string(rs2_frame_metadata_to_string((rs2_frame_metadata_value)i)) + ",";
+        return _names;
+    }();
+    return names;
+}
+
+metadatamask::metadatamask(const rs2::frame &frm)
+{
+    for (int w = 0; w < NUM_WORDS; w++)
+        bits[w] = 0;
+    for (int i = 0; i < RS2_FRAME_METADATA_COUNT; i++)
+    {
+        rs2_frame_metadata_value field = (rs2_frame_metadata_value)i;
+        if (frm.supports_frame_metadata(field))
+        {
+            bits[i / 64] |= (uint64_t)1 << (i % 64);
+            fields.push_back(field);
+        }
+    }
+    header = std::string("Stream,") +
+             rs2_stream_to_string(frm.get_profile().stream_type()) +
+             "\nAttribute,Value\n";
+}
+
+bool metadatamask::supports(const rs2_frame_metadata_value &field) const
+{
+    return (bits[field / 64] >> (field % 64)) & 1;
+}
+
+int metadatamask::size() const
+{
+    return fields.size();
+}
+
+bool metadatamask::extract(const rs2::frame &frm, metadatarecord &record) const
+{
+    try
+    {
+        int n = fields.size();
+        for (int i = 0; i < n; i++)
+        {
+            record.fields[i] = fields[i];
+            record.values[i] = frm.get_frame_metadata(fields[i]);
+        }
+        record.count = n;
+        return true;
+    }
+    catch (const rs2::error &)
+    {
+        // e.g. a frame from before the metadata was enabled.
+    }
+
+    record.count = 0;
+    for (auto const &field : fields)
+    {
+        if (!frm.supports_frame_metadata(field))
+            continue;
+        record.fields[record.count] = field;
+        record.values[record.count] = frm.get_frame_metadata(field);
+        record.count++;
+    }
+    return false;
+}
+
+void metadatamask::format(const metadatarecord &record, std::string &csv) const
+{
+    const std::vector<std::string> &names = field_names();
+    csv += header;
+    char value[24];
+    for (int i = 0; i < record.count; i++)
+    {
+        csv += names[record.fields[i]];
+        int len = snprintf(value, sizeof(value), "%lld\n", (long long)record.values[i]);
+        csv.append(value, len);
+    }
+}
+
+void metadatamask::to_csv(const metadatarecord &record, const std::string &filename) const
+{
+    std::string csv;
+    csv.reserve(header.size() + record.count * 40);
+    format(record, csv);
+    std::ofstream file(filename, std::ofstream::binary);
+    file.write(csv.data(), csv.size());
+}
+
+const metadatamask &metadatacache::query(const rs2::frame &frm)
+{
+    int id = frm.get_profile().unique_id();
+    if (last != nullptr && id == last_id)
+        return *last;
+
+    auto itr = masks.find(id);
+    if (itr == masks.end())
+        itr = masks.emplace(id, std::unique_ptr<metadatamask>(new metadatamask(frm))).first;
+    last_id = id;
+    last = itr->second.get();
+    return *last;
+}
+
+void metadatacache::clear()
+{
+    masks.clear();
+    last_id = -1;
+    last = nullptr;
+}
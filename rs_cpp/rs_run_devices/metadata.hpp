@@ -0,0 +1,101 @@
+#ifndef METADATA_HPP
+#define METADATA_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Metadata values of a frame, in the order of the fields of its
+ * 'metadatamask'.
+ *
+ */
+struct metadatarecord
+{
+    int count = 0;
+    rs2_frame_metadata_value fields[RS2_FRAME_METADATA_COUNT];
+    rs2_metadata_type values[RS2_FRAME_METADATA_COUNT];
+};
+
+/**
+ * @brief Metadata fields supported by a stream profile, as a bitmask + the
+ * list of the fields with their csv names.
+ *
+ * 'supports_frame_metadata' is called for every field once per profile,
+ * the frames of the profile then only read the supported fields.
+ *
+ */
+class metadatamask
+{
+public:
+    /**
+     * @brief Construct a new metadatamask object from the first frame of a
+     * stream profile.
+     *
+     * @param frm the frame.
+     */
+    explicit metadatamask(const rs2::frame &frm);
+
+    bool supports(const rs2_frame_metadata_value &field) const;
+    int size() const;
+
+    /**
+     * @brief Reads the supported fields of a frame into a record. A field
+     * that the frame is missing falls back to the checked, slow path.
+     *
+     * @param frm the frame.
+     * @param record the values.
+     * @return bool false if the slow path was needed.
+     */
+    bool extract(const rs2::frame &frm, metadatarecord &record) const;
+
+    /**
+     * @brief Writes a record as csv ("Stream,<stream>", "Attribute,Value"
+     * and one "<field>,<value>" line per field).
+     *
+     * @param record the values.
+     * @param filename name of file to save to.
+     */
+    void to_csv(const metadatarecord &record, const std::string &filename) const;
+
+    /**
+     * @brief Appends the csv of a record to a string.
+     *
+     * @param record the values.
+     * @param csv the string.
+     */
+    void format(const metadatarecord &record, std::string &csv) const;
+
+private:
+    static const int NUM_WORDS = (RS2_FRAME_METADATA_COUNT + 63) / 64;
+
+    uint64_t bits[NUM_WORDS];
+    std::vector<rs2_frame_metadata_value> fields;
+    std::string header;
+};
+
+/**
+ * @brief 'metadatamask' of every stream profile, computed on the first
+ * frame of the profile. Not thread safe, one per capture thread.
+ *
+ */
+class metadatacache
+{
+public:
+    const metadatamask &query(const rs2::frame &frm);
+    void clear();
+
+private:
+    int last_id = -1;
+    const metadatamask *last = nullptr;
+    std::map<int, std::unique_ptr<metadatamask>> masks;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "metrics.hpp"
+
+metrics &metrics::instance()
+{
+    static metrics _metrics;
+    return _metrics;
+}
+
+void metrics::set(const std::string &scope,
+                  const std::string &name,
+                  const double &value)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    values[scope][name] = value;
+}
+
+void metrics::add(const std::string &scope,
+                  const std::string &name,
+                  const double &value)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    values[scope][name] += value;
+}
+
+double metrics::get(const std::string &scope,
+                    const std::string &name)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    auto scope_itr = values.find(scope);
+    if (scope_itr == values.end())
+        return 0.0;
+    auto name_itr = scope_itr->second.find(name);
+    if (name_itr == scope_itr->second.end())
+        return 0.0;
+    return name_itr->second;
+}
+
+void metrics::clear(const std::string &scope)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    values.erase(scope);
+}
+
+std::map<std::string, std::map<std::string, double>> metrics::snapshot()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    return values;
+}
+
+void metrics::printout()
+{
+    // Copy first so that the lock is not held while printing.
+    auto _values = snapshot();
+    for (auto const &scope : _values)
+    {
+        std::ostringstream ss;
+        ss.precision(12);
+        ss << "[metrics] " << scope.first << " :";
+        for (auto const &value : scope.second)
+            ss << " " << value.first << "=" << value.second;
+        print(ss.str(), 0);
+    }
+}
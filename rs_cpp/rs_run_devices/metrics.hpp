@@ -0,0 +1,91 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <sstream>
+
+#include "utils.hpp"
+
+/**
+ * @brief Process wide registry of numeric metrics.
+ *
+ * Metrics are grouped by scope (e.g. a device serial number or a subsystem
+ * name like "storage") and identified by name. Every call only holds the
+ * internal lock for a map update, so it is safe to publish from the capture
+ * threads as well as from background workers.
+ *
+ */
+class metrics
+{
+public:
+    /**
+     * @brief Returns the global metrics registry.
+     *
+     * @return metrics&
+     */
+    static metrics &instance();
+
+    /**
+     * @brief Sets a metric to a value (gauge).
+     *
+     * @param scope group of the metric, e.g. device serial number.
+     * @param name name of the metric.
+     * @param value new value.
+     */
+    void set(const std::string &scope,
+             const std::string &name,
+             const double &value);
+
+    /**
+     * @brief Adds a value to a metric (counter).
+     *
+     * @param scope group of the metric, e.g. device serial number.
+     * @param name name of the metric.
+     * @param value value to add.
+     */
+    void add(const std::string &scope,
+             const std::string &name,
+             const double &value);
+
+    /**
+     * @brief Gets the current value of a metric, 0 if it does not exist.
+     *
+     * @param scope group of the metric.
+     * @param name name of the metric.
+     * @return double
+     */
+    double get(const std::string &scope,
+               const std::string &name);
+
+    /**
+     * @brief Removes all metrics of a scope.
+     *
+     * @param scope group of the metrics.
+     */
+    void clear(const std::string &scope);
+
+    /**
+     * @brief Copy of all metrics, scope > name > value.
+     *
+     * @return std::map<std::string, std::map<std::string, double>>
+     */
+    std::map<std::string, std::map<std::string, double>> snapshot();
+
+    /**
+     * @brief Prints out all metrics, one line per scope.
+     *
+     */
+    void printout();
+
+private:
+    metrics(){};
+    metrics(const metrics &) = delete;
+    metrics &operator=(const metrics &) = delete;
+
+    std::mutex mux;
+    std::map<std::string, std::map<std::string, double>> values;
+};
+
+#endif
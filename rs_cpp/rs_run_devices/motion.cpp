@@ -0,0 +1,296 @@
+#include "motion.hpp"
+
+/*******************************************************************************
+ * ROW KERNELS
+ ******************************************************************************/
+
+/**
+ * @brief Compares a Z16 row with its reference and blends it into the reference.
+ *
+ * @param cur current row.
+ * @param ref reference row, updated in place.
+ * @param n number of pixels.
+ * @param delta min change of a pixel.
+ * @param changed number of valid pixels that changed by more than delta.
+ * @param valid number of pixels that are valid in both rows.
+ */
+static void compare_depth_row(const uint16_t *cur,
+                              uint16_t *ref,
+                              const int &n,
+                              const uint16_t &delta,
+                              int64_t &changed,
+                              int64_t &valid)
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(-1);
+    const __m128i vdelta = _mm_set1_epi16((short)delta);
+    __m128i acc_changed = zero;
+    __m128i acc_valid = zero;
+    for (; x + 8 <= n; x += 8)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(cur + x));
+        __m128i r = _mm_loadu_si128((const __m128i *)(ref + x));
+        __m128i c0 = _mm_cmpeq_epi16(c, zero);
+        __m128i r0 = _mm_cmpeq_epi16(r, zero);
+        __m128i v = _mm_andnot_si128(_mm_or_si128(c0, r0), ones);
+        __m128i diff = _mm_or_si128(_mm_subs_epu16(c, r), _mm_subs_epu16(r, c));
+        __m128i over = _mm_subs_epu16(diff, vdelta);
+        __m128i ch = _mm_andnot_si128(_mm_cmpeq_epi16(over, zero), v);
+        // masks are -1, subtracting them counts per lane.
+        acc_changed = _mm_sub_epi16(acc_changed, ch);
+        acc_valid = _mm_sub_epi16(acc_valid, v);
+        // ref = (ref == 0) ? cur : (cur == 0) ? ref : avg(ref, cur)
+        __m128i upd = _mm_avg_epu16(c, r);
+        upd = _mm_or_si128(_mm_and_si128(r0, c), _mm_andnot_si128(r0, upd));
+        upd = _mm_or_si128(_mm_and_si128(c0, r), _mm_andnot_si128(c0, upd));
+        _mm_storeu_si128((__m128i *)(ref + x), upd);
+    }
+    uint16_t lanes_changed[8];
+    uint16_t lanes_valid[8];
+    _mm_storeu_si128((__m128i *)lanes_changed, acc_changed);
+    _mm_storeu_si128((__m128i *)lanes_valid, acc_valid);
+    for (int i = 0; i < 8; i++)
+    {
+        changed += lanes_changed[i];
+        valid += lanes_valid[i];
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint16x8_t zero = vdupq_n_u16(0);
+    const uint16x8_t vdelta = vdupq_n_u16(delta);
+    uint16x8_t acc_changed = zero;
+    uint16x8_t acc_valid = zero;
+    for (; x + 8 <= n; x += 8)
+    {
+        uint16x8_t c = vld1q_u16(cur + x);
+        uint16x8_t r = vld1q_u16(ref + x);
+        uint16x8_t c0 = vceqq_u16(c, zero);
+        uint16x8_t r0 = vceqq_u16(r, zero);
+        uint16x8_t v = vmvnq_u16(vorrq_u16(c0, r0));
+        uint16x8_t ch = vandq_u16(vcgtq_u16(vabdq_u16(c, r), vdelta), v);
+        acc_changed = vsubq_u16(acc_changed, ch);
+        acc_valid = vsubq_u16(acc_valid, v);
+        uint16x8_t upd = vrhaddq_u16(c, r);
+        upd = vbslq_u16(r0, c, upd);
+        upd = vbslq_u16(c0, r, upd);
+        vst1q_u16(ref + x, upd);
+    }
+    uint64x2_t sum_changed = vpaddlq_u32(vpaddlq_u16(acc_changed));
+    uint64x2_t sum_valid = vpaddlq_u32(vpaddlq_u16(acc_valid));
+    changed += vgetq_lane_u64(sum_changed, 0) + vgetq_lane_u64(sum_changed, 1);
+    valid += vgetq_lane_u64(sum_valid, 0) + vgetq_lane_u64(sum_valid, 1);
+#endif
+
+    for (; x < n; x++)
+    {
+        uint16_t c = cur[x];
+        uint16_t r = ref[x];
+        if (c != 0 && r != 0)
+        {
+            valid += 1;
+            if ((c > r ? c - r : r - c) > delta)
+                changed += 1;
+            ref[x] = (uint16_t)((c + r + 1) >> 1);
+        }
+        else if (r == 0)
+        {
+            ref[x] = c;
+        }
+    }
+}
+
+/**
+ * @brief Compares an 8-bit row with its reference and blends it into the reference.
+ *
+ * @param cur current row.
+ * @param ref reference row, updated in place.
+ * @param n number of bytes.
+ * @param delta min change of a byte.
+ * @param changed number of bytes that changed by more than delta.
+ */
+static void compare_color_row(const uint8_t *cur,
+                              uint8_t *ref,
+                              const int &n,
+                              const uint8_t &delta,
+                              int64_t &changed)
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i vdelta = _mm_set1_epi8((char)delta);
+    __m128i acc = zero;
+    for (; x + 16 <= n; x += 16)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(cur + x));
+        __m128i r = _mm_loadu_si128((const __m128i *)(ref + x));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(c, r), _mm_subs_epu8(r, c));
+        __m128i over = _mm_subs_epu8(diff, vdelta);
+        __m128i bits = _mm_andnot_si128(_mm_cmpeq_epi8(over, zero), one);
+        // sum of absolute differences against 0 = horizontal sum of the bits.
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(bits, zero));
+        _mm_storeu_si128((__m128i *)(ref + x), _mm_avg_epu8(c, r));
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    changed += lanes[0] + lanes[1];
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t one = vdupq_n_u8(1);
+    const uint8x16_t vdelta = vdupq_n_u8(delta);
+    uint16x8_t acc = vdupq_n_u16(0);
+    for (; x + 16 <= n; x += 16)
+    {
+        uint8x16_t c = vld1q_u8(cur + x);
+        uint8x16_t r = vld1q_u8(ref + x);
+        uint8x16_t bits = vandq_u8(vcgtq_u8(vabdq_u8(c, r), vdelta), one);
+        acc = vpadalq_u8(acc, bits);
+        vst1q_u8(ref + x, vrhaddq_u8(c, r));
+    }
+    uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(acc));
+    changed += vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+#endif
+
+    for (; x < n; x++)
+    {
+        uint8_t c = cur[x];
+        uint8_t r = ref[x];
+        if ((c > r ? c - r : r - c) > delta)
+            changed += 1;
+        ref[x] = (uint8_t)((c + r + 1) >> 1);
+    }
+}
+
+/*******************************************************************************
+ * motiongate
+ ******************************************************************************/
+motiongate::motiongate(const float &on_threshold,
+                       const float &off_threshold,
+                       const int &depth_delta,
+                       const int &color_delta,
+                       const int &downsample,
+                       const int &pre_roll,
+                       const int &post_roll,
+                       const float &idle_fps)
+    : on_threshold(on_threshold),
+      off_threshold(std::min(off_threshold, on_threshold)),
+      depth_delta((uint16_t)std::max(0, std::min(depth_delta, 65535))),
+      color_delta((uint8_t)std::max(0, std::min(color_delta, 255))),
+      downsample(std::max(1, downsample)),
+      _pre_roll(std::max(0, pre_roll)),
+      post_roll(std::max(0, post_roll))
+{
+    if (idle_fps > 0)
+        idle_interval_ns = (int64_t)(1e9 / idle_fps);
+    else
+        idle_interval_ns = -1;
+}
+
+float motiongate::score_depth(const uint16_t *data,
+                              const int &width,
+                              const int &height,
+                              const int &stride)
+{
+    int rows = (height + downsample - 1) / downsample;
+    bool first = depth_reference.size() != (size_t)(rows * width);
+    if (first)
+        depth_reference.assign(rows * width, 0);
+
+    int64_t changed = 0;
+    int64_t valid = 0;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    for (int row = 0; row < rows; row++)
+    {
+        const uint16_t *cur = reinterpret_cast<const uint16_t *>(
+            bytes + (size_t)row * downsample * stride);
+        compare_depth_row(cur, &depth_reference[row * width], width,
+                          depth_delta, changed, valid);
+    }
+
+    // Without a reference nothing can be compared yet.
+    if (first || valid == 0)
+        return 0.0f;
+    return (float)changed / (float)valid;
+}
+
+float motiongate::score_color(const uint8_t *data,
+                              const int &width_bytes,
+                              const int &height,
+                              const int &stride)
+{
+    int rows = (height + downsample - 1) / downsample;
+    bool first = color_reference.size() != (size_t)(rows * width_bytes);
+    if (first)
+        color_reference.assign(rows * width_bytes, 0);
+
+    // Without a reference nothing can be compared yet.
+    if (first)
+    {
+        for (int row = 0; row < rows; row++)
+            std::copy(data + (size_t)row * downsample * stride,
+                      data + (size_t)row * downsample * stride + width_bytes,
+                      color_reference.begin() + row * width_bytes);
+        return 0.0f;
+    }
+
+    int64_t changed = 0;
+    for (int row = 0; row < rows; row++)
+        compare_color_row(data + (size_t)row * downsample * stride,
+                          &color_reference[row * width_bytes], width_bytes,
+                          color_delta, changed);
+    return (float)changed / (float)(rows * width_bytes);
+}
+
+motiongate::decision motiongate::update(const float &score,
+                                        const int64_t &global_timestamp)
+{
+    _last_score = score;
+
+    if (!_active)
+    {
+        if (score >= on_threshold)
+        {
+            _active = true;
+            post_roll_counter = post_roll;
+            return STORE_WITH_PRE_ROLL;
+        }
+        // Idle, stores frames at a lower rate.
+        if (idle_interval_ns >= 0 &&
+            (last_idle_store < 0 ||
+             global_timestamp - last_idle_store >= idle_interval_ns))
+        {
+            last_idle_store = global_timestamp;
+            return STORE;
+        }
+        return SKIP;
+    }
+
+    if (score >= off_threshold)
+        post_roll_counter = post_roll;
+    else
+        post_roll_counter -= 1;
+
+    if (post_roll_counter < 0)
+    {
+        _active = false;
+        last_idle_store = global_timestamp;
+    }
+    return STORE;
+}
+
+bool motiongate::active()
+{
+    return _active;
+}
+
+int motiongate::pre_roll()
+{
+    return _pre_roll;
+}
+
+float motiongate::last_score()
+{
+    return _last_score;
+}
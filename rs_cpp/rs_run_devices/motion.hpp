@@ -0,0 +1,124 @@
+#ifndef MOTION_HPP
+#define MOTION_HPP
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/**
+ * @brief Change detection used to gate the recording of frames.
+ *
+ * Every 'downsample'-th row of a frame is compared against a running
+ * reference (the reference is blended 50/50 with every new frame). The score
+ * is the fraction of compared pixels (depth) or bytes (color) that changed
+ * by more than a delta. The comparison uses SSE2/NEON when available.
+ *
+ * The recording state switches with hysteresis:
+ * - idle   -> active : score >= on_threshold.
+ * - active -> idle   : score < off_threshold for 'post_roll' frames.
+ * While idle only 'idle_fps' frames per second are stored. When becoming
+ * active the caller should also store the last 'pre_roll' skipped frames.
+ *
+ */
+class motiongate
+{
+public:
+    enum decision
+    {
+        SKIP = 0,
+        STORE = 1,
+        STORE_WITH_PRE_ROLL = 2,
+    };
+
+    /**
+     * @brief Construct a new motiongate object
+     *
+     * @param on_threshold Score that switches to active recording.
+     * @param off_threshold Score below which the post-roll counts down.
+     * @param depth_delta Min depth change (in depth units) of a pixel.
+     * @param color_delta Min color change of a byte.
+     * @param downsample Only every n-th row is compared.
+     * @param pre_roll Number of skipped frames to store when becoming active.
+     * @param post_roll Number of quiet frames before becoming idle.
+     * @param idle_fps Frames per second stored while idle, 0 stores none.
+     */
+    motiongate(const float &on_threshold,
+               const float &off_threshold,
+               const int &depth_delta,
+               const int &color_delta,
+               const int &downsample,
+               const int &pre_roll,
+               const int &post_roll,
+               const float &idle_fps);
+
+    /**
+     * @brief Change score of a Z16 frame against its reference.
+     *
+     * Pixels that are 0 (no depth) in the frame or the reference are ignored.
+     *
+     * @param data frame data.
+     * @param width width in pixels.
+     * @param height height in pixels.
+     * @param stride row stride in bytes.
+     * @return float fraction of changed pixels [0, 1].
+     */
+    float score_depth(const uint16_t *data,
+                      const int &width,
+                      const int &height,
+                      const int &stride);
+
+    /**
+     * @brief Change score of an 8-bit (per channel) frame against its reference.
+     *
+     * @param data frame data.
+     * @param width_bytes width of a row in bytes (width * bpp).
+     * @param height height in pixels.
+     * @param stride row stride in bytes.
+     * @return float fraction of changed bytes [0, 1].
+     */
+    float score_color(const uint8_t *data,
+                      const int &width_bytes,
+                      const int &height,
+                      const int &stride);
+
+    /**
+     * @brief Updates the recording state with the score of the current frame.
+     *
+     * @param score max score of the streams of the current frame.
+     * @param global_timestamp timestamp of the frame in ns.
+     * @return decision whether to store the current frame.
+     */
+    decision update(const float &score, const int64_t &global_timestamp);
+
+    bool active();
+    int pre_roll();
+    float last_score();
+
+private:
+    float on_threshold = 0.02f;
+    float off_threshold = 0.01f;
+    uint16_t depth_delta = 50;
+    uint8_t color_delta = 20;
+    int downsample = 4;
+    int _pre_roll = 0;
+    int post_roll = 30;
+    int64_t idle_interval_ns = 1000000000;
+
+    bool _active = false;
+    int post_roll_counter = 0;
+    int64_t last_idle_store = -1;
+    float _last_score = 0.0f;
+
+    // Reference rows, only the compared rows are kept.
+    std::vector<uint16_t> depth_reference;
+    std::vector<uint8_t> color_reference;
+};
+
+#endif
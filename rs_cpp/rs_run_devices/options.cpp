@@ -0,0 +1,85 @@
+#include "options.hpp"
+
+void sensoroptions::set(const std::string &sensor_name,
+                        const rs2_option &option,
+                        const float &value)
+{
+    for (auto &&e : entries)
+    {
+        if (e.sensor_name == sensor_name && e.option == option)
+        {
+            e.value = value;
+            return;
+        }
+    }
+    entry e;
+    e.sensor_name = sensor_name;
+    e.option = option;
+    e.value = value;
+    entries.push_back(e);
+}
+
+void sensoroptions::clear()
+{
+    entries.clear();
+}
+
+size_t sensoroptions::size()
+{
+    return entries.size();
+}
+
+int sensoroptions::apply(const rs2::device &device, const std::string &device_sn)
+{
+    int failed = 0;
+    for (auto &&sensor : device.query_sensors())
+    {
+        if (sensor.is<rs2::color_sensor>())
+            failed += apply(sensor, "color", device_sn);
+        else if (sensor.is<rs2::depth_stereo_sensor>())
+            failed += apply(sensor, "depth", device_sn);
+    }
+    return failed;
+}
+
+int sensoroptions::apply(const rs2::sensor &sensor,
+                         const std::string &sensor_name,
+                         const std::string &device_sn)
+{
+    int failed = 0;
+    for (auto const &e : entries)
+    {
+        if (e.sensor_name != sensor_name)
+            continue;
+        std::string name = device_sn + " " + sensor_name + " sensor " +
+                           rs2_option_to_string(e.option);
+        if (!sensor.supports(e.option))
+        {
+            print(name + " not supported...", 1);
+            failed++;
+            continue;
+        }
+        try
+        {
+            rs2::option_range range = sensor.get_option_range(e.option);
+            float value = std::max(range.min, std::min(range.max, e.value));
+            float tolerance = std::max(range.step * 0.5f, 1e-3f);
+            if (std::abs(sensor.get_option(e.option) - value) > tolerance)
+                sensor.set_option(e.option, value);
+            float actual = sensor.get_option(e.option);
+            if (std::abs(actual - value) > tolerance)
+            {
+                print(name + " is " + std::to_string(actual) +
+                          " instead of " + std::to_string(value) + "...",
+                      1);
+                failed++;
+            }
+        }
+        catch (const rs2::error &err)
+        {
+            print(name + " : " + err.what(), 1);
+            failed++;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,74 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+
+/**
+ * @brief Cache of the options of the sensors of a device.
+ *
+ * The options are set once (in order, e.g. the AE toggle before the AE
+ * limit) and applied whenever needed: before the pipeline starts, live
+ * while streaming, or again after a reset. Every option is clamped to its
+ * range, only written if the sensor has another value and read back to
+ * verify that it took effect.
+ * The sensors are named "color" (rs2::color_sensor) and "depth"
+ * (rs2::depth_stereo_sensor).
+ *
+ */
+class sensoroptions
+{
+public:
+    /**
+     * @brief Sets the value of an option, replaces a previous value.
+     *
+     * @param sensor_name "color" or "depth".
+     * @param option the option.
+     * @param value the value, clamped to the range of the option when applied.
+     */
+    void set(const std::string &sensor_name,
+             const rs2_option &option,
+             const float &value);
+
+    void clear();
+    size_t size();
+
+    /**
+     * @brief Applies the options to all sensors of a device.
+     *
+     * @param device rs2 device.
+     * @param device_sn device serial number, for the messages.
+     * @return int number of options that are not supported or did not take effect.
+     */
+    int apply(const rs2::device &device, const std::string &device_sn);
+
+    /**
+     * @brief Applies the options of one sensor.
+     *
+     * @param sensor rs2 sensor.
+     * @param sensor_name "color" or "depth".
+     * @param device_sn device serial number, for the messages.
+     * @return int number of options that are not supported or did not take effect.
+     */
+    int apply(const rs2::sensor &sensor,
+              const std::string &sensor_name,
+              const std::string &device_sn);
+
+private:
+    struct entry
+    {
+        std::string sensor_name;
+        rs2_option option;
+        float value;
+    };
+
+    std::vector<entry> entries;
+};
+
+#endif
@@ -0,0 +1,280 @@
+#include "pointcloud.hpp"
+
+/**
+ * @brief Multiplies the rays of a row with its depth.
+ *
+ * @param depth Z16 row.
+ * @param ray_x x/z of the pixels.
+ * @param ray_y y/z of the pixels.
+ * @param out x,y,z per pixel (also for pixels without depth).
+ * @param n number of pixels.
+ * @param depth_unit depth unit in meters.
+ * @return int number of pixels with depth.
+ */
+static int deproject_row(const uint16_t *depth,
+                         const float *ray_x,
+                         const float *ray_y,
+                         float *out,
+                         const int &n,
+                         const float &depth_unit)
+{
+    int x = 0;
+    int valid = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 unit = _mm_set1_ps(depth_unit);
+    for (; x + 4 <= n; x += 4)
+    {
+        __m128i d = _mm_loadl_epi64((const __m128i *)(depth + x));
+        __m128i d32 = _mm_unpacklo_epi16(d, zero);
+        __m128 z = _mm_mul_ps(_mm_cvtepi32_ps(d32), unit);
+        __m128 px = _mm_mul_ps(_mm_loadu_ps(ray_x + x), z);
+        __m128 py = _mm_mul_ps(_mm_loadu_ps(ray_y + x), z);
+        // x,y,z planes -> interleaved x,y,z.
+        __m128 xy_lo = _mm_unpacklo_ps(px, py); // x0 y0 x1 y1
+        __m128 xy_hi = _mm_unpackhi_ps(px, py); // x2 y2 x3 y3
+        float *o = out + 3 * x;
+        _mm_storel_pi((__m64 *)(o + 0), xy_lo);
+        _mm_storeh_pi((__m64 *)(o + 3), xy_lo);
+        _mm_storel_pi((__m64 *)(o + 6), xy_hi);
+        _mm_storeh_pi((__m64 *)(o + 9), xy_hi);
+        float zs[4];
+        _mm_storeu_ps(zs, z);
+        o[2] = zs[0];
+        o[5] = zs[1];
+        o[8] = zs[2];
+        o[11] = zs[3];
+        int zero_bits = _mm_movemask_epi8(_mm_cmpeq_epi32(d32, zero));
+        valid += 4 - ((zero_bits & 0x1) + ((zero_bits >> 4) & 0x1) +
+                      ((zero_bits >> 8) & 0x1) + ((zero_bits >> 12) & 0x1));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const float32x4_t unit = vdupq_n_f32(depth_unit);
+    const uint32x4_t one = vdupq_n_u32(1);
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; x + 4 <= n; x += 4)
+    {
+        uint32x4_t d32 = vmovl_u16(vld1_u16(depth + x));
+        float32x4x3_t p;
+        p.val[2] = vmulq_f32(vcvtq_f32_u32(d32), unit);
+        p.val[0] = vmulq_f32(vld1q_f32(ray_x + x), p.val[2]);
+        p.val[1] = vmulq_f32(vld1q_f32(ray_y + x), p.val[2]);
+        vst3q_f32(out + 3 * x, p);
+        acc = vaddq_u32(acc, vandq_u32(vtstq_u32(d32, d32), one));
+    }
+    valid += vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+             vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+
+    for (; x < n; x++)
+    {
+        float z = depth[x] * depth_unit;
+        out[3 * x + 0] = ray_x[x] * z;
+        out[3 * x + 1] = ray_y[x] * z;
+        out[3 * x + 2] = z;
+        valid += depth[x] != 0;
+    }
+    return valid;
+}
+
+pointcloud::pointcloud(workerpool *pool)
+    : pool(pool)
+{
+}
+
+void pointcloud::set_intrinsics(const rs2_intrinsics &intrinsics)
+{
+    this->intrinsics = intrinsics;
+    has_intrinsics = true;
+    // rebuilt on the next frame.
+    ray_width = 0;
+    ray_height = 0;
+}
+
+void pointcloud::build_rays(const int &width, const int &height)
+{
+    rs2_intrinsics intr = intrinsics;
+    if (width != intr.width || height != intr.height)
+    {
+        float sx = (float)width / (float)intr.width;
+        float sy = (float)height / (float)intr.height;
+        intr.fx *= sx;
+        intr.fy *= sy;
+        intr.ppx = (intr.ppx + 0.5f) * sx - 0.5f;
+        intr.ppy = (intr.ppy + 0.5f) * sy - 0.5f;
+        intr.width = width;
+        intr.height = height;
+    }
+
+    ray_x.resize((size_t)width * height);
+    ray_y.resize((size_t)width * height);
+    parallel_for(0, height, [&](int y0, int y1)
+                 {
+        for (int y = y0; y < y1; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                float pixel[2] = {(float)x, (float)y};
+                float point[3];
+                rs2_deproject_pixel_to_point(point, &intr, pixel, 1.0f);
+                ray_x[(size_t)y * width + x] = point[0];
+                ray_y[(size_t)y * width + x] = point[1];
+            }
+        } });
+
+    dense.resize((size_t)width * height * 3);
+    row_offsets.resize(height + 1);
+    ray_width = width;
+    ray_height = height;
+}
+
+size_t pointcloud::process(const uint16_t *depth,
+                           const int &width,
+                           const int &height,
+                           const int &stride,
+                           const float &depth_unit,
+                           const uint8_t *color,
+                           const int &color_width,
+                           const int &color_height,
+                           const int &color_stride,
+                           const int &color_bpp,
+                           const bool &color_bgr)
+{
+    num_points = 0;
+    if (!has_intrinsics || width <= 0 || height <= 0)
+        return 0;
+    if (width != ray_width || height != ray_height)
+        build_rays(width, height);
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(depth);
+
+    // 1. dense points + number of valid points per row.
+    parallel_for(0, height, [&](int y0, int y1)
+                 {
+        for (int y = y0; y < y1; y++)
+            row_offsets[y + 1] = deproject_row(
+                reinterpret_cast<const uint16_t *>(bytes + (size_t)y * stride),
+                &ray_x[(size_t)y * width],
+                &ray_y[(size_t)y * width],
+                &dense[(size_t)y * width * 3],
+                width,
+                depth_unit); });
+
+    row_offsets[0] = 0;
+    for (int y = 0; y < height; y++)
+        row_offsets[y + 1] += row_offsets[y];
+    num_points = row_offsets[height];
+
+    has_colors = color != nullptr && (color_bpp == 3 || color_bpp == 4) &&
+                 color_width >= width && color_height >= height;
+    xyz.resize(num_points * 3);
+    rgb.resize(has_colors ? num_points * 3 : 0);
+
+    // 2. compaction, every row knows where its points start.
+    int r = color_bgr ? 2 : 0;
+    int b = color_bgr ? 0 : 2;
+    parallel_for(0, height, [&](int y0, int y1)
+                 {
+        for (int y = y0; y < y1; y++)
+        {
+            const uint16_t *d = reinterpret_cast<const uint16_t *>(bytes + (size_t)y * stride);
+            const float *p = &dense[(size_t)y * width * 3];
+            size_t i = row_offsets[y];
+            const uint8_t *c = has_colors
+                                   ? color + (size_t)(y * color_height / height) * color_stride
+                                   : nullptr;
+            for (int x = 0; x < width; x++)
+            {
+                if (d[x] == 0)
+                    continue;
+                std::copy(p + 3 * x, p + 3 * x + 3, &xyz[3 * i]);
+                if (c != nullptr)
+                {
+                    const uint8_t *px = c + (size_t)(x * color_width / width) * color_bpp;
+                    rgb[3 * i + 0] = px[r];
+                    rgb[3 * i + 1] = px[1];
+                    rgb[3 * i + 2] = px[b];
+                }
+                i++;
+            }
+        } });
+
+    return num_points;
+}
+
+size_t pointcloud::size()
+{
+    return num_points;
+}
+
+const float *pointcloud::points()
+{
+    return xyz.data();
+}
+
+const uint8_t *pointcloud::colors()
+{
+    return has_colors ? rgb.data() : nullptr;
+}
+
+void pointcloud::parallel_for(const int &begin,
+                              const int &end,
+                              const std::function<void(int, int)> &fn)
+{
+    if (pool != nullptr)
+        pool->parallel_for(begin, end, fn);
+    else
+        fn(begin, end);
+}
+
+bool points_to_ply(const std::string &filename,
+                   const float *xyz,
+                   const uint8_t *rgb,
+                   const size_t &num_points)
+{
+    std::ofstream out(filename, std::ofstream::binary);
+    if (!out.is_open())
+        return false;
+
+    out << "ply\n";
+    out << "format binary_little_endian 1.0\n";
+    out << "comment pointcloud saved from rs_run_devices\n";
+    out << "element vertex " << num_points << "\n";
+    out << "property float32 x\n";
+    out << "property float32 y\n";
+    out << "property float32 z\n";
+    if (rgb != nullptr)
+    {
+        out << "property uchar red\n";
+        out << "property uchar green\n";
+        out << "property uchar blue\n";
+    }
+    out << "end_header\n";
+
+    if (rgb == nullptr)
+    {
+        out.write(reinterpret_cast<const char *>(xyz), num_points * 3 * sizeof(float));
+        return out.good();
+    }
+
+    // Interleaves the points with their colors chunk by chunk.
+    const size_t vertex_size = 3 * sizeof(float) + 3;
+    const size_t chunk = 4096;
+    std::vector<char> buffer(chunk * vertex_size);
+    for (size_t start = 0; start < num_points; start += chunk)
+    {
+        size_t n = std::min(chunk, num_points - start);
+        char *o = buffer.data();
+        for (size_t i = start; i < start + n; i++)
+        {
+            std::copy(reinterpret_cast<const char *>(xyz + 3 * i),
+                      reinterpret_cast<const char *>(xyz + 3 * i + 3),
+                      o);
+            std::copy(rgb + 3 * i, rgb + 3 * i + 3, o + 3 * sizeof(float));
+            o += vertex_size;
+        }
+        out.write(buffer.data(), n * vertex_size);
+    }
+    return out.good();
+}
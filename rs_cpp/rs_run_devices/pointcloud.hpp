@@ -0,0 +1,138 @@
+#ifndef POINTCLOUD_HPP
+#define POINTCLOUD_HPP
+
+#include <librealsense2/rs.hpp>
+#include <librealsense2/rsutil.h>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "workerpool.hpp"
+
+/**
+ * @brief Deprojection of Z16 frames into point clouds.
+ *
+ * The ray (x/z, y/z) of every pixel is computed once per intrinsics with
+ * rs2_deproject_pixel_to_point, so that the deprojection of a frame is only
+ * a multiplication of the rays with the depth (SSE2/NEON when available).
+ * Pixels without depth are dropped. The rows are split over a 'workerpool'.
+ *
+ */
+class pointcloud
+{
+public:
+    /**
+     * @brief Construct a new pointcloud object
+     *
+     * @param pool Pool used for the row parallel loops, nullptr runs inline.
+     */
+    explicit pointcloud(workerpool *pool = nullptr);
+
+    /**
+     * @brief Intrinsics of the depth frames (color intrinsics if the depth
+     * is aligned to color). Frames with another size (e.g. decimated) use
+     * scaled intrinsics.
+     *
+     * @param intrinsics rs2 intrinsics.
+     */
+    void set_intrinsics(const rs2_intrinsics &intrinsics);
+
+    /**
+     * @brief Deprojects a Z16 frame.
+     *
+     * @param depth depth data.
+     * @param width width of the depth.
+     * @param height height of the depth.
+     * @param stride row stride of the depth in bytes.
+     * @param depth_unit depth unit in meters.
+     * @param color optional color aligned to the depth, rgb8/bgr8/rgba8/bgra8.
+     *              Its size can be a multiple of the depth size.
+     * @param color_width width of the color.
+     * @param color_height height of the color.
+     * @param color_stride row stride of the color in bytes.
+     * @param color_bpp bytes per pixel of the color (3 or 4).
+     * @param color_bgr whether the color is in bgr order.
+     * @return size_t number of points.
+     */
+    size_t process(const uint16_t *depth,
+                   const int &width,
+                   const int &height,
+                   const int &stride,
+                   const float &depth_unit,
+                   const uint8_t *color = nullptr,
+                   const int &color_width = 0,
+                   const int &color_height = 0,
+                   const int &color_stride = 0,
+                   const int &color_bpp = 3,
+                   const bool &color_bgr = false);
+
+    size_t size();
+
+    /**
+     * @brief Points of the last frame, x,y,z per point in meters.
+     *
+     * @return const float*
+     */
+    const float *points();
+
+    /**
+     * @brief Colors of the last frame, r,g,b per point, nullptr if no color
+     * was given.
+     *
+     * @return const uint8_t*
+     */
+    const uint8_t *colors();
+
+private:
+    void build_rays(const int &width, const int &height);
+    void parallel_for(const int &begin,
+                      const int &end,
+                      const std::function<void(int, int)> &fn);
+
+    workerpool *pool = nullptr;
+    rs2_intrinsics intrinsics;
+    bool has_intrinsics = false;
+
+    // ray table of the current frame size.
+    int ray_width = 0;
+    int ray_height = 0;
+    std::vector<float> ray_x;
+    std::vector<float> ray_y;
+
+    // dense per pixel points, compacted into 'xyz' / 'rgb'.
+    std::vector<float> dense;
+    std::vector<int> row_offsets;
+    std::vector<float> xyz;
+    std::vector<uint8_t> rgb;
+    size_t num_points = 0;
+    bool has_colors = false;
+};
+
+/**
+ * @brief Writes points into a binary (little endian) PLY file.
+ *
+ * The points are streamed in chunks, they are not copied as a whole.
+ *
+ * @param filename output file.
+ * @param xyz x,y,z per point.
+ * @param rgb optional r,g,b per point, nullptr writes no colors.
+ * @param num_points number of points.
+ * @return bool whether the file could be written.
+ */
+bool points_to_ply(const std::string &filename,
+                   const float *xyz,
+                   const uint8_t *rgb,
+                   const size_t &num_points);
+
+#endif
@@ -0,0 +1,251 @@
+#include "recording.hpp"
+
+/**
+ * @brief Splits a line of calib.csv.
+ *
+ * @param line csv line.
+ * @return std::vector<std::string>
+ */
+static std::vector<std::string> split_csv(const std::string &line)
+{
+    std::vector<std::string> values;
+    std::stringstream ss(line);
+    std::string value;
+    while (std::getline(ss, value, ','))
+        if (!value.empty())
+            values.push_back(value);
+    return values;
+}
+
+/**
+ * @brief Parses an intrinsics row of calib.csv
+ * (w,h,ppx,ppy,fx,fy,model,5 coeffs,format,fps).
+ *
+ * @param values row values.
+ * @param intrinsics parsed intrinsics.
+ * @param format parsed stream format.
+ * @param fps parsed fps.
+ * @return bool whether the row is complete.
+ */
+static bool parse_intrinsics(const std::vector<std::string> &values,
+                             rs2_intrinsics &intrinsics,
+                             rs2_format &format,
+                             int &fps)
+{
+    if (values.size() < 14)
+        return false;
+    intrinsics.width = std::stoi(values[0]);
+    intrinsics.height = std::stoi(values[1]);
+    intrinsics.ppx = std::stof(values[2]);
+    intrinsics.ppy = std::stof(values[3]);
+    intrinsics.fx = std::stof(values[4]);
+    intrinsics.fy = std::stof(values[5]);
+    intrinsics.model = RS2_DISTORTION_NONE;
+    for (int i = 0; i < RS2_DISTORTION_COUNT; i++)
+        if (values[6] == rs2_distortion_to_string((rs2_distortion)i))
+            intrinsics.model = (rs2_distortion)i;
+    for (int i = 0; i < 5; i++)
+        intrinsics.coeffs[i] = std::stof(values[7 + i]);
+    // written as the enum value by rs2wrapper::save_calib.
+    format = (rs2_format)std::stoi(values[12]);
+    fps = std::stoi(values[13]);
+    return true;
+}
+
+recordingreader::recordingreader(const std::string &trial_path)
+    : trial_path(trial_path)
+{
+    std::fill(rotation, rotation + 9, 0.0f);
+    rotation[0] = rotation[4] = rotation[8] = 1.0f;
+    std::fill(translation, translation + 3, 0.0f);
+}
+
+bool recordingreader::open()
+{
+    if (!parse_calib(trial_path + "/calib/calib.csv"))
+    {
+        print("could not read the calibration of " + trial_path, 2);
+        return false;
+    }
+    if (!parse_journal(trial_path + "/timestamp/timestamp.txt"))
+    {
+        print("could not read the timestamps of " + trial_path, 2);
+        return false;
+    }
+
+    std::map<int64_t, std::string> color_files;
+    std::map<int64_t, std::string> depth_files;
+    std::map<int64_t, std::string> depth_filtered_files;
+    index_files(trial_path + "/color", color_files);
+    index_files(trial_path + "/depth", depth_files);
+    index_files(trial_path + "/depth_filtered", depth_filtered_files);
+
+    for (auto &&frame : _frames)
+    {
+        auto itr = color_files.find(frame.global_timestamp);
+        if (itr != color_files.end())
+            frame.color_file = itr->second;
+        itr = depth_files.find(frame.global_timestamp);
+        if (itr != depth_files.end())
+            frame.depth_file = itr->second;
+        itr = depth_filtered_files.find(frame.global_timestamp);
+        if (itr != depth_filtered_files.end())
+            frame.depth_filtered_file = itr->second;
+    }
+    return true;
+}
+
+const std::vector<recordingframe> &recordingreader::frames()
+{
+    return _frames;
+}
+
+bool recordingreader::read(const std::string &filename, std::vector<uint8_t> &data)
+{
+    std::ifstream input(filename, std::ios::binary | std::ios::ate);
+    if (!input.is_open())
+        return false;
+    std::streamsize size = input.tellg();
+    input.seekg(0, std::ios::beg);
+    data.resize(size);
+    return (bool)input.read(reinterpret_cast<char *>(data.data()), size);
+}
+
+int recordingreader::color_bpp()
+{
+    switch (color_format)
+    {
+    case RS2_FORMAT_RGB8:
+    case RS2_FORMAT_BGR8:
+        return 3;
+    case RS2_FORMAT_RGBA8:
+    case RS2_FORMAT_BGRA8:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+std::string recordingreader::get_trial_path()
+{
+    return trial_path;
+}
+
+bool recordingreader::parse_calib(const std::string &filename)
+{
+    std::ifstream csv(filename);
+    if (!csv.is_open())
+        return false;
+
+    std::string line;
+    std::vector<std::vector<std::string>> rows;
+    while (std::getline(csv, line))
+        rows.push_back(split_csv(line));
+    if (rows.size() < 3)
+        return false;
+
+    if (!parse_intrinsics(rows[0], color_intrinsics, color_format, color_fps))
+        return false;
+    if (!parse_intrinsics(rows[1], depth_intrinsics, depth_format, depth_fps))
+        return false;
+    fps = std::max(color_fps, depth_fps);
+    if (rows[2].size() >= 12)
+    {
+        for (int i = 0; i < 9; i++)
+            rotation[i] = std::stof(rows[2][i]);
+        for (int i = 0; i < 3; i++)
+            translation[i] = std::stof(rows[2][9 + i]);
+    }
+    if (rows.size() > 3 && rows[3].size() >= 2)
+    {
+        depth_scale = std::stof(rows[3][0]);
+        baseline = std::stof(rows[3][1]);
+    }
+    if (rows.size() > 4 && rows[4].size() >= 2)
+    {
+        filtered_width = std::stoi(rows[4][0]);
+        filtered_height = std::stoi(rows[4][1]);
+    }
+    if (rows.size() > 4 && rows[4].size() >= 3)
+        depth_aligned = rows[4][2] != "0";
+    return true;
+}
+
+bool recordingreader::parse_journal(const std::string &filename)
+{
+    std::ifstream txt(filename);
+    if (!txt.is_open())
+        return false;
+
+    // g::c::d, g::c::d::stored or g::c::d::stored::corrected
+    std::string line;
+    while (std::getline(txt, line))
+    {
+        std::vector<int64_t> values;
+        size_t start = 0;
+        while (start <= line.size())
+        {
+            size_t end = line.find("::", start);
+            std::string value = line.substr(start, end - start);
+            if (!value.empty())
+                values.push_back(std::stoll(value));
+            if (end == std::string::npos)
+                break;
+            start = end + 2;
+        }
+        if (values.size() < 3)
+            continue;
+
+        recordingframe frame;
+        frame.global_timestamp = values[0];
+        frame.color_timestamp = values[1];
+        frame.depth_timestamp = values[2];
+        frame.stored = values.size() < 4 || values[3] != 0;
+        if (values.size() > 4)
+            frame.corrected_timestamp = values[4];
+        if (values.size() > 8)
+        {
+            frame.color_dropped = values[5];
+            frame.depth_dropped = values[6];
+            frame.color_jitter_us = values[7];
+            frame.depth_jitter_us = values[8];
+        }
+        _frames.push_back(frame);
+    }
+    return true;
+}
+
+void recordingreader::index_files(const std::string &path,
+                                  std::map<int64_t, std::string> &files)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+        return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (strcmp(".", ent->d_name) == 0 || strcmp("..", ent->d_name) == 0)
+            continue;
+        std::string name(ent->d_name);
+        std::string filepath = path + "/" + name;
+        // the fan-out shards are folders.
+        if (ent->d_type == DT_DIR)
+        {
+            index_files(filepath, files);
+            continue;
+        }
+        size_t dot = name.find('.');
+        if (dot == 0 || name.substr(dot) != ".bin")
+            continue;
+        try
+        {
+            files[std::stoll(name.substr(0, dot))] = filepath;
+        }
+        catch (const std::exception &e)
+        {
+            continue;
+        }
+    }
+    closedir(dir);
+}
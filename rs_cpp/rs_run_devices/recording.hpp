@@ -0,0 +1,125 @@
+#ifndef RECORDING_HPP
+#define RECORDING_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <dirent.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+
+/**
+ * @brief One entry of the timestamp journal of a recording.
+ *
+ */
+struct recordingframe
+{
+    int64_t global_timestamp = 0;
+    // -1 if the frameset has no frame of the stream (slower stream).
+    int64_t color_timestamp = 0;
+    int64_t depth_timestamp = 0;
+    bool stored = true;
+    // color timestamp in the host domain (clock model), -1 if none, in ns.
+    int64_t corrected_timestamp = -1;
+    // frames dropped before this one + interval deviation from the nominal
+    // period in us, 0 in older journals.
+    int64_t color_dropped = 0;
+    int64_t depth_dropped = 0;
+    int64_t color_jitter_us = 0;
+    int64_t depth_jitter_us = 0;
+    // empty if the file does not exist.
+    std::string color_file;
+    std::string depth_file;
+    std::string depth_filtered_file;
+};
+
+/**
+ * @brief Reads a trial recorded by rs_run_devices
+ * (<save_path>/<device_sn>/<trial_idx>).
+ *
+ * Parses calib/calib.csv and timestamp/timestamp.txt, and indexes the frame
+ * files by their timestamp, so fanned out folders (--storage-fanout) are
+ * handled transparently.
+ * Note that the saved depth is aligned to color (it uses the color
+ * intrinsics) unless the streams have different resolutions, see
+ * 'depth_aligned'.
+ *
+ */
+class recordingreader
+{
+public:
+    rs2_intrinsics color_intrinsics;
+    rs2_intrinsics depth_intrinsics;
+    rs2_format color_format = RS2_FORMAT_ANY;
+    rs2_format depth_format = RS2_FORMAT_ANY;
+    // frame rate of the steps, the faster stream.
+    int fps = 0;
+    int color_fps = 0;
+    int depth_fps = 0;
+    float rotation[9];
+    float translation[3];
+    float depth_scale = 0.001f;
+    float baseline = 0.0f;
+    // size of the filtered depth, 0 in older recordings.
+    int filtered_width = 0;
+    int filtered_height = 0;
+    // whether the depth is aligned to color, always in older recordings.
+    bool depth_aligned = true;
+
+    /**
+     * @brief Construct a new recordingreader object
+     *
+     * @param trial_path path of the trial folder.
+     */
+    explicit recordingreader(const std::string &trial_path);
+
+    /**
+     * @brief Parses the calibration + journal and indexes the files.
+     *
+     * @return bool whether the calibration and journal could be read.
+     */
+    bool open();
+
+    /**
+     * @brief Frames in the journal, in recording order.
+     *
+     * @return const std::vector<recordingframe>&
+     */
+    const std::vector<recordingframe> &frames();
+
+    /**
+     * @brief Reads a raw frame file.
+     *
+     * @param filename path of the .bin file.
+     * @param data file content.
+     * @return bool whether the file could be read.
+     */
+    bool read(const std::string &filename, std::vector<uint8_t> &data);
+
+    /**
+     * @brief Bytes per pixel of the color frames.
+     *
+     * @return int 0 if the format is not supported.
+     */
+    int color_bpp();
+
+    std::string get_trial_path();
+
+private:
+    bool parse_calib(const std::string &filename);
+    bool parse_journal(const std::string &filename);
+    void index_files(const std::string &path, std::map<int64_t, std::string> &files);
+
+    std::string trial_path;
+    std::vector<recordingframe> _frames;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "registry.hpp"
+
+deviceregistry &deviceregistry::instance()
+{
+    static deviceregistry _registry;
+    return _registry;
+}
+
+void deviceregistry::enumerate(const rs2::context &ctx)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    if (!_enumerated)
+        query(ctx);
+}
+
+void deviceregistry::refresh(const rs2::context &ctx)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    query(ctx);
+}
+
+bool deviceregistry::enumerated()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    return _enumerated;
+}
+
+void deviceregistry::query(const rs2::context &ctx)
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    std::map<std::string, entry> _entries;
+    for (auto &&dev : ctx.query_devices())
+    {
+        entry e;
+        e.sn = dev.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER);
+        e.product_line = dev.supports(RS2_CAMERA_INFO_PRODUCT_LINE)
+                             ? dev.get_info(RS2_CAMERA_INFO_PRODUCT_LINE)
+                             : "";
+        e.device = dev;
+        e.sensors = dev.query_sensors();
+        for (auto &&sensor : e.sensors)
+        {
+            for (auto &&sp : sensor.get_stream_profiles())
+            {
+                if (!sp.is<rs2::video_stream_profile>())
+                    continue;
+                rs2::video_stream_profile vsp = sp.as<rs2::video_stream_profile>();
+                profile p;
+                p.stream = vsp.stream_type();
+                p.width = vsp.width();
+                p.height = vsp.height();
+                p.format = vsp.format();
+                p.fps = vsp.fps();
+                e.profiles.push_back(p);
+            }
+        }
+        _entries[e.sn] = e;
+    }
+    entries = _entries;
+    _enumerated = true;
+
+    metrics &m = metrics::instance();
+    m.set("registry", "devices", entries.size());
+    m.set("registry", "enumerate_ms",
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - t0)
+              .count());
+    m.add("registry", "enumerations", 1);
+}
+
+std::vector<std::vector<std::string>> deviceregistry::devices()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    // the map is sorted by serial number.
+    std::vector<std::vector<std::string>> _devices;
+    for (auto const &e : entries)
+        _devices.push_back(std::vector<std::string>{e.second.sn, e.second.product_line});
+    return _devices;
+}
+
+bool deviceregistry::find(const std::string &device_sn, entry &e)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    auto itr = entries.find(device_sn);
+    if (itr == entries.end())
+        return false;
+    e = itr->second;
+    return true;
+}
+
+int deviceregistry::supports(const std::string &device_sn,
+                             const rs2_stream &stream,
+                             const int &width,
+                             const int &height,
+                             const rs2_format &format,
+                             const int &fps)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    auto itr = entries.find(device_sn);
+    if (itr == entries.end())
+        return -1;
+    for (auto const &p : itr->second.profiles)
+        if (p.stream == stream && p.width == width && p.height == height &&
+            p.format == format && p.fps == fps)
+            return 1;
+    return 0;
+}
@@ -0,0 +1,111 @@
+#ifndef REGISTRY_HPP
+#define REGISTRY_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+#include "metrics.hpp"
+
+/**
+ * @brief Process wide registry of the local devices.
+ *
+ * The devices are enumerated once per context, and their rs2::device
+ * handles, sensors and supported video stream profiles are cached so that
+ * every wrapper (and thread) gets them without querying the USB bus again.
+ * 'refresh' enumerates again, e.g. after a hardware reset when the cached
+ * handles are stale.
+ *
+ */
+class deviceregistry
+{
+public:
+    struct profile
+    {
+        rs2_stream stream;
+        int width;
+        int height;
+        rs2_format format;
+        int fps;
+    };
+
+    struct entry
+    {
+        std::string sn;
+        std::string product_line;
+        rs2::device device;
+        std::vector<rs2::sensor> sensors;
+        std::vector<profile> profiles;
+    };
+
+    /**
+     * @brief Returns the global device registry.
+     *
+     * @return deviceregistry&
+     */
+    static deviceregistry &instance();
+
+    /**
+     * @brief Enumerates the devices of the context, only the first call
+     * queries the devices.
+     *
+     * @param ctx rs2 context shared by the wrappers.
+     */
+    void enumerate(const rs2::context &ctx);
+
+    /**
+     * @brief Enumerates the devices of the context again.
+     *
+     * @param ctx rs2 context shared by the wrappers.
+     */
+    void refresh(const rs2::context &ctx);
+
+    bool enumerated();
+
+    /**
+     * @brief Enumerated devices sorted by serial number.
+     *
+     * @return std::vector<std::vector<std::string>> [serial + product line]
+     */
+    std::vector<std::vector<std::string>> devices();
+
+    /**
+     * @brief Gets the cached entry of a device.
+     *
+     * @param device_sn device serial number.
+     * @param e the entry, if found.
+     * @return bool whether the device is enumerated.
+     */
+    bool find(const std::string &device_sn, entry &e);
+
+    /**
+     * @brief Whether the device supports a video stream profile.
+     *
+     * @return int 1 supported, 0 not supported, -1 device not enumerated.
+     */
+    int supports(const std::string &device_sn,
+                 const rs2_stream &stream,
+                 const int &width,
+                 const int &height,
+                 const rs2_format &format,
+                 const int &fps);
+
+private:
+    deviceregistry(){};
+    deviceregistry(const deviceregistry &) = delete;
+    deviceregistry &operator=(const deviceregistry &) = delete;
+
+    void query(const rs2::context &ctx);
+
+    std::mutex mux;
+    bool _enumerated = false;
+    std::map<std::string, entry> entries;
+};
+
+#endif
@@ -0,0 +1,313 @@
+#include "reset.hpp"
+
+extern char **environ;
+
+// Polling interval of the running resets.
+static const int TICK_MS = 20;
+
+resetservice::resetservice(std::shared_ptr<rs2::context> ctx,
+                           const int &max_concurrent,
+                           const int &timeout_ms,
+                           const std::string &bind_command)
+    : ctx(ctx),
+      max_concurrent(std::max(1, max_concurrent)),
+      timeout(timeout_ms),
+      bind_command(bind_command)
+{
+}
+
+resetservice::~resetservice()
+{
+    stop();
+}
+
+int resetservice::load_mapping(const std::string &filename)
+{
+    std::ifstream txt(filename);
+    if (!txt.is_open())
+        throw std::invalid_argument("usbip mapping file not found : " + filename);
+
+    std::string line;
+    while (std::getline(txt, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        std::string device_sn;
+        std::string address;
+        if (ss >> device_sn >> address)
+            mapping[device_sn] = address;
+    }
+    return mapping.size();
+}
+
+bool resetservice::request(const std::string &device_sn, const rs2::device &dev)
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        job &j = jobs[device_sn];
+        if (j.s != IDLE && j.s != DONE && j.s != FAILED)
+            return false;
+        j = job();
+        j.s = QUEUED;
+        j.dev = dev;
+        queue.push_back(device_sn);
+    }
+    metrics::instance().add(device_sn, "hardware_resets", 1);
+    cv.notify_one();
+    return true;
+}
+
+resetservice::state resetservice::take(const std::string &device_sn)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    auto itr = jobs.find(device_sn);
+    if (itr == jobs.end())
+        return IDLE;
+    state s = itr->second.s;
+    if (s == DONE || s == FAILED)
+        itr->second.s = IDLE;
+    return s;
+}
+
+bool resetservice::busy(const std::string &device_sn)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    auto itr = jobs.find(device_sn);
+    return itr != jobs.end() &&
+           (itr->second.s == QUEUED ||
+            itr->second.s == REBINDING ||
+            itr->second.s == ENUMERATING);
+}
+
+void resetservice::start()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    if (running)
+        return;
+    running = true;
+    th = std::thread(&resetservice::run, this);
+}
+
+void resetservice::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        if (!running)
+            return;
+        running = false;
+    }
+    cv.notify_all();
+    th.join();
+}
+
+void resetservice::run()
+{
+    std::unique_lock<std::mutex> lock(mux);
+    while (running)
+    {
+        // 1. queued resets take the free slots, the resets are sent without
+        // the lock as they block until the device answers.
+        std::vector<std::pair<std::string, rs2::device>> sends;
+        while (!queue.empty() && num_running < max_concurrent)
+        {
+            std::string device_sn = queue.front();
+            queue.pop_front();
+            num_running++;
+            sends.emplace_back(device_sn, jobs[device_sn].dev);
+        }
+        std::map<std::string, std::string> errors;
+        if (!sends.empty())
+        {
+            lock.unlock();
+            for (auto &&send : sends)
+            {
+                try
+                {
+                    send.second.hardware_reset();
+                    print(send.first + " hardware reset...", 0);
+                }
+                catch (const rs2::error &e)
+                {
+                    errors[send.first] = e.what();
+                }
+            }
+            lock.lock();
+        }
+        for (auto &&send : sends)
+        {
+            const std::string &device_sn = send.first;
+            job &j = jobs[device_sn];
+            if (errors.count(device_sn) > 0)
+            {
+                print(device_sn + " hardware reset : " + errors[device_sn], 2);
+                finish(device_sn, j, false);
+                continue;
+            }
+            // the durations do not include the time spent in the queue.
+            j.sent = std::chrono::steady_clock::now();
+            j.deadline = j.sent + timeout;
+
+            // 2. the bind command of the device, not waited for.
+            j.s = REBINDING;
+            auto address = mapping.find(device_sn);
+            if (bind_command != "none" && address != mapping.end())
+            {
+                // in its own process group, so that a kill reaches the
+                // children of the shell too.
+                std::string cmd = bind_command + " " + address->second;
+                const char *argv[] = {"/bin/sh", "-c", cmd.c_str(), NULL};
+                posix_spawnattr_t attr;
+                posix_spawnattr_init(&attr);
+                posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+                posix_spawnattr_setpgroup(&attr, 0);
+                if (posix_spawn(&j.pid, "/bin/sh", NULL, &attr,
+                                const_cast<char *const *>(argv), environ) != 0)
+                {
+                    print(device_sn + " bind command failed to start : " + cmd, 2);
+                    j.pid = -1;
+                }
+                posix_spawnattr_destroy(&attr);
+            }
+        }
+
+        // 3. the running resets are polled, the enumeration can take a
+        // while so the capture threads are not locked out meanwhile.
+        std::set<std::string> present;
+        bool enumerated = false;
+        if (num_running > 0)
+        {
+            lock.unlock();
+            enumerated = enumerate(present);
+            lock.lock();
+        }
+        int active = 0;
+        std::map<std::string, bool> finished;
+        for (auto &&entry : jobs)
+        {
+            if (entry.second.s == REBINDING || entry.second.s == ENUMERATING)
+            {
+                state s = advance(entry.first,
+                                  entry.second,
+                                  enumerated ? &present : nullptr);
+                if (s == DONE || s == FAILED)
+                    finished[entry.first] = s == DONE;
+                active++;
+            }
+        }
+
+        // 4. the cached handles of the reset devices are stale, they are
+        // refreshed before the capture threads can take the result.
+        if (!finished.empty())
+        {
+            bool refresh = false;
+            for (auto &&entry : finished)
+                refresh = refresh || entry.second;
+            if (refresh)
+            {
+                lock.unlock();
+                deviceregistry::instance().refresh(*ctx);
+                lock.lock();
+            }
+            for (auto &&entry : finished)
+                finish(entry.first, jobs[entry.first], entry.second);
+        }
+
+        if (active > 0)
+            cv.wait_for(lock, std::chrono::milliseconds(TICK_MS));
+        else
+            cv.wait(lock);
+    }
+
+    // the bind commands are not left behind.
+    for (auto &&entry : jobs)
+        if (entry.second.pid > 0)
+        {
+            kill(-entry.second.pid, SIGKILL);
+            waitpid(entry.second.pid, NULL, 0);
+        }
+}
+
+resetservice::state resetservice::advance(const std::string &device_sn,
+                                          job &j,
+                                          const std::set<std::string> *present)
+{
+    bool timed_out = std::chrono::steady_clock::now() >= j.deadline;
+
+    if (j.s == REBINDING)
+    {
+        if (j.pid > 0)
+        {
+            int status = 0;
+            pid_t r = waitpid(j.pid, &status, WNOHANG);
+            if (r == 0 && !timed_out)
+                return j.s;
+            if (r == 0)
+            {
+                kill(-j.pid, SIGKILL);
+                waitpid(j.pid, NULL, 0);
+                print(device_sn + " bind command killed after the timeout...", 2);
+            }
+            else if (r > 0 && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))
+            {
+                print(device_sn + " bind command failed...", 1);
+            }
+            j.pid = -1;
+        }
+        j.s = ENUMERATING;
+    }
+
+    // the device has to drop off the bus before it is back, a device that
+    // is still enumerated has not reset yet.
+    if (present && present->count(device_sn) == 0)
+        j.gone = true;
+    else if (present && j.gone)
+        return DONE;
+    if (timed_out)
+    {
+        print(device_sn + (j.gone ? " did not come back" : " did not drop off the bus") +
+                  " after its hardware reset...",
+              2);
+        return FAILED;
+    }
+    return j.s;
+}
+
+void resetservice::finish(const std::string &device_sn, job &j, const bool &success)
+{
+    if (j.s == DONE || j.s == FAILED)
+        return;
+    j.s = success ? DONE : FAILED;
+    j.dev = rs2::device();
+    num_running--;
+
+    metrics &m = metrics::instance();
+    if (success)
+    {
+        m.set(device_sn, "hardware_reset_ms",
+              std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - j.sent)
+                  .count());
+    }
+    else
+    {
+        m.add(device_sn, "hardware_resets_failed", 1);
+        print(device_sn + " hardware reset failed...", 2);
+    }
+}
+
+bool resetservice::enumerate(std::set<std::string> &device_sns)
+{
+    try
+    {
+        for (auto &&dev : ctx->query_devices())
+            if (dev.supports(RS2_CAMERA_INFO_SERIAL_NUMBER))
+                device_sns.insert(dev.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER));
+    }
+    catch (const rs2::error &)
+    {
+        // enumeration fails while the bus changes, a missing device does
+        // not count as gone then.
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,157 @@
+#ifndef RESET_HPP
+#define RESET_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+#include "metrics.hpp"
+#include "registry.hpp"
+
+/**
+ * @brief Hardware resets of the devices, in the background.
+ *
+ * A reset is requested by a capture thread, which treats the device as
+ * unavailable until the reset is done. One worker thread moves every
+ * requested device through its states without blocking on any of them:
+ * - QUEUED      : waits for one of the 'max_concurrent' slots.
+ * - REBINDING   : hardware_reset() was sent, the bind command of the device
+ *                 (usbip, from the mapping file) runs as a child process.
+ * - ENUMERATING : waits for the device to drop off the bus and come back,
+ *                 both have to be seen.
+ * - DONE/FAILED : until the capture thread takes the result.
+ * Every state has the 'timeout_ms' of the reset, a bind command that hangs
+ * is killed with its process group.
+ * The reset durations and failures are in the metrics of the device.
+ *
+ */
+class resetservice
+{
+public:
+    enum state
+    {
+        IDLE = 0,
+        QUEUED = 1,
+        REBINDING = 2,
+        ENUMERATING = 3,
+        DONE = 4,
+        FAILED = 5,
+    };
+
+    /**
+     * @brief Construct a new resetservice object
+     *
+     * @param ctx rs2 context shared by the wrappers.
+     * @param max_concurrent max devices resetting at once.
+     * @param timeout_ms max duration of a reset.
+     * @param bind_command command run with the mapped address of a device
+     *                     after its reset, "none" to disable.
+     */
+    resetservice(std::shared_ptr<rs2::context> ctx,
+                 const int &max_concurrent,
+                 const int &timeout_ms,
+                 const std::string &bind_command);
+    ~resetservice();
+
+    /**
+     * @brief Loads the addresses of the devices for the bind command,
+     * one "<device_sn> <address>" per line, '#' starts a comment.
+     *
+     * @param filename mapping file.
+     * @return int number of devices mapped.
+     */
+    int load_mapping(const std::string &filename);
+
+    /**
+     * @brief Queues the reset of a device.
+     *
+     * @param device_sn device serial number.
+     * @param dev rs2 device handle, the pipeline should be stopped.
+     * @return bool false if the device is already resetting.
+     */
+    bool request(const std::string &device_sn, const rs2::device &dev);
+
+    /**
+     * @brief State of the reset of a device, DONE and FAILED are taken
+     * (the device goes back to IDLE).
+     *
+     * @param device_sn device serial number.
+     * @return state
+     */
+    state take(const std::string &device_sn);
+
+    /**
+     * @brief Whether a reset of the device is queued or running.
+     *
+     * @param device_sn device serial number.
+     * @return bool
+     */
+    bool busy(const std::string &device_sn);
+
+    void start();
+    void stop();
+
+private:
+    struct job
+    {
+        state s = IDLE;
+        rs2::device dev;
+        pid_t pid = -1;
+        bool gone = false;
+        std::chrono::steady_clock::time_point sent;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void run();
+
+    /**
+     * @brief Moves a job to its next state if it can. Must hold 'mux'.
+     * A job that is over is not finished here, the registry is refreshed
+     * first without the lock.
+     *
+     * @param device_sn device serial number.
+     * @param j the job.
+     * @param present serial numbers enumerated by the context, nullptr if
+     *                the enumeration failed.
+     * @return state DONE/FAILED if the job is over, its state otherwise.
+     */
+    state advance(const std::string &device_sn,
+                  job &j,
+                  const std::set<std::string> *present);
+    void finish(const std::string &device_sn, job &j, const bool &success);
+    bool enumerate(std::set<std::string> &device_sns);
+
+    std::shared_ptr<rs2::context> ctx;
+    int max_concurrent;
+    std::chrono::milliseconds timeout;
+    std::string bind_command;
+    std::map<std::string, std::string> mapping;
+
+    std::mutex mux;
+    std::condition_variable cv;
+    std::thread th;
+    bool running = false;
+    int num_running = 0;
+    std::deque<std::string> queue;
+    std::map<std::string, job> jobs;
+};
+
+#endif
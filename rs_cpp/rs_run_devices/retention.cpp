@@ -0,0 +1,292 @@
+#include "retention.hpp"
+
+storageretention::storageretention(const std::string &base_path,
+                                   const int64_t &max_bytes,
+                                   const int64_t &min_free_bytes,
+                                   const int &check_interval_sec)
+    : base_path(base_path),
+      max_bytes(max_bytes),
+      min_free_bytes(min_free_bytes),
+      check_interval_sec(std::max(1, check_interval_sec)),
+      running(false),
+      triggered(false)
+{
+}
+
+storageretention::~storageretention()
+{
+    stop();
+}
+
+void storageretention::start()
+{
+    if (running || !enabled())
+        return;
+    running = true;
+    worker = std::thread(&storageretention::run, this);
+    print("storage retention started, max bytes : " + std::to_string(max_bytes) +
+              ", min free bytes : " + std::to_string(min_free_bytes),
+          0);
+}
+
+void storageretention::stop()
+{
+    if (!running)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        running = false;
+    }
+    cv.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void storageretention::set_active_trial(const std::string &device_sn,
+                                        const time_t &trial_idx)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    active_trials[device_sn] = trial_idx;
+}
+
+void storageretention::trigger()
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        triggered = true;
+    }
+    cv.notify_all();
+}
+
+bool storageretention::enabled()
+{
+    return max_bytes > 0 || min_free_bytes > 0;
+}
+
+void storageretention::run()
+{
+    while (running)
+    {
+        std::vector<trial> trials;
+        scan(trials);
+        evict(trials);
+        publish(trials);
+
+        std::unique_lock<std::mutex> lock(mux);
+        cv.wait_for(lock,
+                    std::chrono::seconds(check_interval_sec),
+                    [this]
+                    { return !running || triggered; });
+        triggered = false;
+    }
+}
+
+void storageretention::scan(std::vector<trial> &trials)
+{
+    std::map<std::string, time_t> _active_trials;
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        _active_trials = active_trials;
+    }
+
+    DIR *base_dir = opendir(base_path.c_str());
+    if (base_dir == NULL)
+        return;
+
+    struct dirent *dev_ent;
+    while ((dev_ent = readdir(base_dir)) != NULL)
+    {
+        std::string device_sn(dev_ent->d_name);
+        if (device_sn == "." || device_sn == "..")
+            continue;
+        std::string device_path = base_path + "/" + device_sn;
+        DIR *device_dir = opendir(device_path.c_str());
+        if (device_dir == NULL)
+            continue;
+
+        std::vector<trial> device_trials;
+        struct dirent *trial_ent;
+        while ((trial_ent = readdir(device_dir)) != NULL)
+        {
+            std::string name(trial_ent->d_name);
+            if (name.empty() ||
+                name.find_first_not_of("0123456789") != std::string::npos)
+                continue;
+            trial t;
+            t.device_sn = device_sn;
+            t.trial_idx = (time_t)std::stoll(name);
+            t.path = device_path + "/" + name;
+            device_trials.push_back(t);
+        }
+        closedir(device_dir);
+
+        if (device_trials.size() == 0)
+            continue;
+
+        std::sort(device_trials.begin(), device_trials.end(),
+                  [](const trial &a, const trial &b)
+                  { return a.trial_idx < b.trial_idx; });
+
+        // Without a registered active trial the newest one is assumed active.
+        time_t active_idx = device_trials.back().trial_idx;
+        if (_active_trials.find(device_sn) != _active_trials.end())
+            active_idx = _active_trials[device_sn];
+
+        for (auto &&t : device_trials)
+        {
+            t.completed = t.trial_idx < active_idx;
+            if (t.completed &&
+                completed_trial_bytes.find(t.path) != completed_trial_bytes.end())
+            {
+                t.bytes = completed_trial_bytes[t.path];
+            }
+            else
+            {
+                t.bytes = query_dir_bytes(t.path);
+                if (t.completed)
+                    completed_trial_bytes[t.path] = t.bytes;
+            }
+            trials.push_back(t);
+        }
+    }
+    closedir(base_dir);
+
+    // oldest first over all devices.
+    std::sort(trials.begin(), trials.end(),
+              [](const trial &a, const trial &b)
+              { return a.trial_idx < b.trial_idx; });
+}
+
+void storageretention::evict(std::vector<trial> &trials)
+{
+    int64_t total_bytes = 0;
+    for (auto const &t : trials)
+        total_bytes += t.bytes;
+    int64_t free_bytes = query_free_bytes();
+
+    auto over_quota = [&]()
+    {
+        if (max_bytes > 0 && total_bytes > max_bytes)
+            return true;
+        if (min_free_bytes > 0 && free_bytes >= 0 && free_bytes < min_free_bytes)
+            return true;
+        return false;
+    };
+
+    std::vector<trial> remaining;
+    for (auto &&t : trials)
+    {
+        if (t.completed && over_quota())
+        {
+            if (remove_dir(t.path))
+            {
+                print("storage retention evicted " + t.path + " (" +
+                          std::to_string(t.bytes) + " bytes)",
+                      1);
+                total_bytes -= t.bytes;
+                if (free_bytes >= 0)
+                    free_bytes += t.bytes;
+                evicted_trials += 1;
+                evicted_bytes += t.bytes;
+                completed_trial_bytes.erase(t.path);
+                continue;
+            }
+        }
+        remaining.push_back(t);
+    }
+    trials.swap(remaining);
+
+    if (over_quota())
+        print("storage retention : quota still exceeded, no completed trials left to evict", 1);
+}
+
+void storageretention::publish(const std::vector<trial> &trials)
+{
+    std::map<std::string, int64_t> device_bytes;
+    std::map<std::string, int64_t> device_trials;
+    std::map<std::string, int64_t> device_active_bytes;
+    int64_t total_bytes = 0;
+    for (auto const &t : trials)
+    {
+        device_bytes[t.device_sn] += t.bytes;
+        device_trials[t.device_sn] += 1;
+        if (!t.completed)
+            device_active_bytes[t.device_sn] += t.bytes;
+        total_bytes += t.bytes;
+    }
+
+    metrics &m = metrics::instance();
+    m.clear("storage");
+    m.set("storage", "total_bytes", (double)total_bytes);
+    m.set("storage", "free_bytes", (double)query_free_bytes());
+    m.set("storage", "evicted_trials", (double)evicted_trials);
+    m.set("storage", "evicted_bytes", (double)evicted_bytes);
+    for (auto const &db : device_bytes)
+    {
+        m.set("storage", db.first + "_bytes", (double)db.second);
+        m.set("storage", db.first + "_trials", (double)device_trials[db.first]);
+        m.set("storage", db.first + "_active_bytes",
+              (double)device_active_bytes[db.first]);
+    }
+}
+
+int64_t storageretention::query_free_bytes()
+{
+    struct statvfs stat;
+    if (statvfs(base_path.c_str(), &stat) != 0)
+        return -1;
+    return (int64_t)stat.f_bavail * (int64_t)stat.f_frsize;
+}
+
+int64_t storageretention::query_dir_bytes(const std::string &path)
+{
+    int64_t bytes = 0;
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+        return 0;
+    struct dirent *ent;
+    struct stat st;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (strcmp(".", ent->d_name) == 0 || strcmp("..", ent->d_name) == 0)
+            continue;
+        std::string entry_path = path + "/" + ent->d_name;
+        if (lstat(entry_path.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            bytes += query_dir_bytes(entry_path);
+        else
+            bytes += (int64_t)st.st_size;
+    }
+    closedir(dir);
+    return bytes;
+}
+
+bool storageretention::remove_dir(const std::string &path)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+        return false;
+    bool ok = true;
+    struct dirent *ent;
+    struct stat st;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (strcmp(".", ent->d_name) == 0 || strcmp("..", ent->d_name) == 0)
+            continue;
+        std::string entry_path = path + "/" + ent->d_name;
+        if (lstat(entry_path.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            ok = remove_dir(entry_path) && ok;
+        else if (unlink(entry_path.c_str()) != 0)
+            ok = false;
+    }
+    closedir(dir);
+    if (rmdir(path.c_str()) != 0)
+    {
+        print(std::string(std::strerror(errno)) + " : " + path, 2);
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,129 @@
+#ifndef RETENTION_HPP
+#define RETENTION_HPP
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+#include "metrics.hpp"
+
+/**
+ * @brief Background storage retention manager.
+ *
+ * Watches the storage layout created by 'storagepath'
+ * (<base_path>/<device_sn>/<trial_idx>/...) and evicts the oldest completed
+ * trials once a quota is exceeded. The folders of all devices (_sync, _fusion)
+ * have the same layout and are handled like a device, their active trial
+ * is set by the storage rotator too. The quota is either a maximum number of
+ * bytes used under base_path, a minimum free space on the filesystem, or both.
+ *
+ * All scanning and deleting happens in an own thread, the capture/writer
+ * threads only publish the trial they are currently writing to.
+ * The state is published to the 'metrics' registry under the "storage" scope.
+ *
+ */
+class storageretention
+{
+public:
+    /**
+     * @brief Construct a new storageretention object
+     *
+     * @param base_path Root of the storage layout (--save-path).
+     * @param max_bytes Max bytes used under base_path, 0 disables it.
+     * @param min_free_bytes Min free bytes on the filesystem, 0 disables it.
+     * @param check_interval_sec Interval between two scans in sec.
+     */
+    storageretention(const std::string &base_path,
+                     const int64_t &max_bytes,
+                     const int64_t &min_free_bytes,
+                     const int &check_interval_sec);
+    ~storageretention();
+
+    /**
+     * @brief Starts/stops the background thread.
+     *
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief Marks the trial a device is currently writing to.
+     *
+     * The trial and all newer ones are never evicted for that device.
+     *
+     * @param device_sn device serial number.
+     * @param trial_idx trial index, see 'storagepath::trial_idx'.
+     */
+    void set_active_trial(const std::string &device_sn,
+                          const time_t &trial_idx);
+
+    /**
+     * @brief Wakes up the background thread for an immediate scan.
+     *
+     */
+    void trigger();
+
+    /**
+     * @brief Checks whether any quota is configured.
+     *
+     * @return true
+     * @return false
+     */
+    bool enabled();
+
+private:
+    struct trial
+    {
+        std::string device_sn;
+        time_t trial_idx = 0;
+        std::string path;
+        int64_t bytes = 0;
+        bool completed = false;
+    };
+
+    void run();
+    void scan(std::vector<trial> &trials);
+    void evict(std::vector<trial> &trials);
+    void publish(const std::vector<trial> &trials);
+    int64_t query_free_bytes();
+    static int64_t query_dir_bytes(const std::string &path);
+    static bool remove_dir(const std::string &path);
+
+    std::string base_path;
+    int64_t max_bytes = 0;
+    int64_t min_free_bytes = 0;
+    int check_interval_sec = 60;
+
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<bool> triggered;
+    std::mutex mux;
+    std::condition_variable cv;
+
+    // device_sn > active trial index, guarded by 'mux'.
+    std::map<std::string, time_t> active_trials;
+
+    // Completed trials do not change anymore, so their size is cached.
+    // Only accessed from the worker thread.
+    std::map<std::string, int64_t> completed_trial_bytes;
+
+    int64_t evicted_trials = 0;
+    int64_t evicted_bytes = 0;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "ring.hpp"
+
+framesetring::framesetring(const int &max_frames,
+                           const int64_t &max_age_ns,
+                           const int64_t &max_bytes)
+    : max_frames(max_frames),
+      max_age_ns(max_age_ns),
+      max_bytes(max_bytes)
+{
+}
+
+void framesetring::push(frameset_record &record)
+{
+    // Moves the frames out of the librealsense frame pool,
+    // otherwise the pool runs dry while we hold on to them.
+    record.frameset.keep();
+
+    int64_t _bytes = 0;
+    for (size_t i = 0; i < record.frameset.size(); i++)
+        _bytes += record.frameset[i].get_data_size();
+
+    records.push_back(record);
+    record_bytes.push_back(_bytes);
+    total_bytes += _bytes;
+}
+
+void framesetring::mark_for_saving(const int64_t &global_timestamp)
+{
+    for (auto &&record : records)
+        if (max_age_ns < 0 ||
+            global_timestamp - record.global_timestamp <= max_age_ns)
+            record.save = true;
+}
+
+frameset_record &framesetring::front()
+{
+    return records.front();
+}
+
+void framesetring::pop()
+{
+    total_bytes -= record_bytes.front();
+    records.pop_front();
+    record_bytes.pop_front();
+}
+
+bool framesetring::expired(const int64_t &global_timestamp)
+{
+    if (records.empty() || max_age_ns < 0)
+        return false;
+    return global_timestamp - records.front().global_timestamp > max_age_ns;
+}
+
+bool framesetring::over_budget()
+{
+    if (max_frames >= 0 && (int)records.size() > max_frames)
+        return true;
+    if (max_bytes >= 0 && total_bytes > max_bytes)
+        return true;
+    return false;
+}
+
+bool framesetring::empty()
+{
+    return records.empty();
+}
+
+size_t framesetring::size()
+{
+    return records.size();
+}
+
+int64_t framesetring::bytes()
+{
+    return total_bytes;
+}
@@ -0,0 +1,81 @@
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <stdint.h>
+
+#include <deque>
+
+#include "rs_utils.hpp"
+
+/**
+ * @brief Memory budgeted ring of framesets that are not saved (yet).
+ *
+ * The framesets are kept (moved out of the librealsense frame pool) so that
+ * they can still be written once an event happens. A frameset leaves the
+ * ring either by being written (record.save) or by being logged as skipped
+ * once it is too old or the ring is over its budget. The budget is a number
+ * of framesets, a max age in ns and a max number of frame data bytes.
+ * A negative limit is ignored.
+ *
+ */
+class framesetring
+{
+public:
+    /**
+     * @brief Construct a new framesetring object
+     *
+     * @param max_frames Max number of framesets kept.
+     * @param max_age_ns Max age of the framesets kept.
+     * @param max_bytes Max frame data bytes kept.
+     */
+    framesetring(const int &max_frames,
+                 const int64_t &max_age_ns,
+                 const int64_t &max_bytes);
+
+    /**
+     * @brief Keeps the frameset and adds it to the ring.
+     *
+     * @param record frameset with its timestamps.
+     */
+    void push(frameset_record &record);
+
+    /**
+     * @brief Marks the framesets that are not expired to be saved.
+     *
+     * @param global_timestamp current timestamp in ns.
+     */
+    void mark_for_saving(const int64_t &global_timestamp);
+
+    frameset_record &front();
+    void pop();
+
+    /**
+     * @brief Whether the oldest frameset is older than the max age.
+     *
+     * @param global_timestamp current timestamp in ns.
+     * @return bool
+     */
+    bool expired(const int64_t &global_timestamp);
+
+    /**
+     * @brief Whether the ring holds more than its budget.
+     *
+     * @return bool
+     */
+    bool over_budget();
+
+    bool empty();
+    size_t size();
+    int64_t bytes();
+
+private:
+    int max_frames = -1;
+    int64_t max_age_ns = -1;
+    int64_t max_bytes = -1;
+
+    std::deque<frameset_record> records;
+    std::deque<int64_t> record_bytes;
+    int64_t total_bytes = 0;
+};
+
+#endif
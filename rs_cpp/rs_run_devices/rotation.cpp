@@ -0,0 +1,153 @@
+#include "rotation.hpp"
+
+storagerotator::storagerotator(const std::vector<std::string> &device_sns,
+                               const std::string &base_path,
+                               const int &interval_sec,
+                               const int &lead_sec,
+                               const std::map<std::string, std::string> &base_paths)
+    : device_sns(device_sns),
+      base_path(base_path),
+      base_paths(base_paths),
+      interval_sec(std::max(1, interval_sec)),
+      lead_sec(std::max(0, std::min(lead_sec, interval_sec - 1))),
+      running(false),
+      _generation(0)
+{
+}
+
+storagerotator::~storagerotator()
+{
+    stop();
+}
+
+void storagerotator::start()
+{
+    if (running)
+        return;
+
+    time_t trial_idx;
+    time(&trial_idx);
+    std::shared_ptr<storagepath> sp = create(trial_idx);
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        _current = sp;
+    }
+    _generation++;
+
+    running = true;
+    worker = std::thread(&storagerotator::run, this);
+}
+
+void storagerotator::stop()
+{
+    if (!running)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        running = false;
+    }
+    cv.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+std::shared_ptr<const storagepath> storagerotator::current()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    return _current;
+}
+
+int storagerotator::generation()
+{
+    return _generation;
+}
+
+void storagerotator::set_calib(const std::string &device_sn,
+                               const std::string &calib_csv)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    calib_csvs[device_sn] = calib_csv;
+}
+
+void storagerotator::enable_fusion()
+{
+    fusion = true;
+}
+
+void storagerotator::enable_depth_filtered(const std::set<std::string> &device_sns)
+{
+    filtered_devices = device_sns;
+}
+
+void storagerotator::add_rotation_callback(
+    const std::function<void(const storagepath &)> &callback)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    rotation_callbacks.push_back(callback);
+}
+
+void storagerotator::run()
+{
+    time_t window_start = current()->trial_idx;
+
+    while (running)
+    {
+        time_t next_start = window_start + interval_sec;
+
+        // 1. Creates the folders of the next window ahead of time.
+        {
+            std::unique_lock<std::mutex> lock(mux);
+            cv.wait_until(lock,
+                          std::chrono::system_clock::from_time_t(next_start - lead_sec),
+                          [this]
+                          { return !running; });
+        }
+        if (!running)
+            break;
+        std::shared_ptr<storagepath> next = create(next_start);
+
+        // 2. Publishes them once the window starts.
+        std::vector<std::function<void(const storagepath &)>> callbacks;
+        {
+            std::unique_lock<std::mutex> lock(mux);
+            cv.wait_until(lock,
+                          std::chrono::system_clock::from_time_t(next_start),
+                          [this]
+                          { return !running; });
+            if (!running)
+                break;
+            _current = next;
+            callbacks = rotation_callbacks;
+        }
+        _generation++;
+        print("storage rotated to trial " + std::to_string(next_start), 0);
+
+        for (auto const &callback : callbacks)
+            callback(*next);
+
+        window_start = next_start;
+    }
+}
+
+std::shared_ptr<storagepath> storagerotator::create(const time_t &trial_idx)
+{
+    std::shared_ptr<storagepath> sp = std::make_shared<storagepath>();
+    sp->filtered_devices = filtered_devices;
+    sp->create(device_sns, base_path, trial_idx, base_paths);
+    if (fusion)
+        sp->create_fusion(base_path);
+
+    std::map<std::string, std::string> _calib_csvs;
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        _calib_csvs = calib_csvs;
+    }
+    for (auto const &calib_csv : _calib_csvs)
+    {
+        if (sp->calib.find(calib_csv.first) == sp->calib.end())
+            continue;
+        std::ofstream csv(sp->calib[calib_csv.first] + "/calib.csv");
+        csv << calib_csv.second;
+    }
+    return sp;
+}
@@ -0,0 +1,133 @@
+#ifndef ROTATION_HPP
+#define ROTATION_HPP
+
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+#include "rs_utils.hpp"
+
+/**
+ * @brief Time based rotation of the storage paths.
+ *
+ * Every 'interval_sec' the data is saved into a new trial folder.
+ * The folders of the next window are created by a background thread
+ * 'lead_sec' before the window starts, and the switch to the new paths is
+ * published through a generation counter. The capture threads therefore
+ * only compare an integer per step and copy the new paths once per window.
+ *
+ * One rotator can be shared by multiple rs2wrapper instances, so that all
+ * devices use the same trial index.
+ *
+ */
+class storagerotator
+{
+public:
+    /**
+     * @brief Construct a new storagerotator object
+     *
+     * @param device_sns Devices to create the storage paths for.
+     * @param base_path Root of the storage layout (--save-path).
+     * @param interval_sec Length of a window in sec.
+     * @param lead_sec How long before the window starts its folders are created.
+     * @param base_paths Devices saved outside of 'base_path' (device_sn > path).
+     */
+    storagerotator(const std::vector<std::string> &device_sns,
+                   const std::string &base_path,
+                   const int &interval_sec,
+                   const int &lead_sec,
+                   const std::map<std::string, std::string> &base_paths =
+                       std::map<std::string, std::string>());
+    ~storagerotator();
+
+    /**
+     * @brief Creates the storage of the first window (blocking) and starts
+     * the background thread.
+     *
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief Storage paths of the current window.
+     *
+     * @return std::shared_ptr<const storagepath>
+     */
+    std::shared_ptr<const storagepath> current();
+
+    /**
+     * @brief Increases every time 'current()' changes.
+     *
+     * @return int
+     */
+    int generation();
+
+    /**
+     * @brief Calibration data that is written into every new window.
+     *
+     * @param device_sn device serial number.
+     * @param calib_csv content of the calib.csv file.
+     */
+    void set_calib(const std::string &device_sn,
+                   const std::string &calib_csv);
+
+    /**
+     * @brief Also creates the folder of the fused point clouds of every
+     * window (--fusion-extrinsics), called before 'start'.
+     *
+     */
+    void enable_fusion();
+
+    /**
+     * @brief Devices whose 'depth_filtered' folder is created in every
+     * window, called before 'start'.
+     *
+     * @param device_sns device serial numbers.
+     */
+    void enable_depth_filtered(const std::set<std::string> &device_sns);
+
+    /**
+     * @brief Function called (from the background thread) after a rotation.
+     *
+     * @param callback receives the storage paths of the new window.
+     */
+    void add_rotation_callback(
+        const std::function<void(const storagepath &)> &callback);
+
+private:
+    void run();
+    std::shared_ptr<storagepath> create(const time_t &trial_idx);
+
+    std::vector<std::string> device_sns;
+    std::string base_path;
+    std::map<std::string, std::string> base_paths;
+    bool fusion = false;
+    std::set<std::string> filtered_devices;
+    int interval_sec = 3600;
+    int lead_sec = 60;
+
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<int> _generation;
+    std::mutex mux;
+    std::condition_variable cv;
+
+    // guarded by 'mux'.
+    std::shared_ptr<storagepath> _current;
+    std::map<std::string, std::string> calib_csvs;
+    std::vector<std::function<void(const storagepath &)>> rotation_callbacks;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define RS_ARGS_HPP
 
 #include <librealsense2/rs.hpp> // Include RealSense Cross Platform API
+#include <fstream>
 #include <map>
 #include "utils.hpp"
 
@@ -43,8 +44,92 @@ public:
         {"--ir-emitter-power", "150"},
         {"--camera-temperature-printout-interval", "60"},
         {"--max-reset-counter", "500"},
+        {"--storage-max-mb", "0"},
+        {"--storage-min-free-mb", "0"},
+        {"--storage-check-interval", "60"},
+        {"--storage-rotation-interval", "3600"},
+        {"--storage-rotation-lead", "60"},
+        {"--storage-fanout", "none"},
+        {"--metrics-printout-interval", "60"},
+        {"--motion-gate", "none"},
+        {"--motion-on-threshold", "0.02"},
+        {"--motion-off-threshold", "0.01"},
+        {"--motion-depth-delta", "50"},
+        {"--motion-color-delta", "20"},
+        {"--motion-downsample", "4"},
+        {"--motion-idle-fps", "1"},
+        {"--motion-pre-roll", "15"},
+        {"--motion-post-roll", "30"},
+        {"--record-mode", "continuous"},
+        {"--trigger-pre-sec", "10"},
+        {"--trigger-post-sec", "10"},
+        {"--trigger-socket", "none"},
+        {"--ring-max-mb", "1024"},
+        {"--ring-total-mb", "1024"},
+        {"--depth-filters", "none"},
+        {"--depth-output", "filtered"},
+        {"--filter-threads", "0"},
+        {"--pointcloud", "none"},
+        {"--voxel-size", "0"},
+        {"--voxel-reduction", "centroid"},
+        {"--fusion-extrinsics", "none"},
+        {"--fusion-voxel-size", "0.005"},
+        {"--sync", "none"},
+        {"--sync-tolerance-ms", "10"},
+        {"--sync-max-wait-ms", "50"},
+        {"--sync-queue", "4"},
+        {"--init-concurrency", "0"},
+        {"--init-retries", "3"},
+        {"--init-backoff-ms", "200"},
+        {"--ready-timeout-ms", "5000"},
+        {"--ae-tolerance", "0.02"},
+        {"--ae-stable-frames", "3"},
+        {"--ae-max-wait-ms", "3000"},
+        {"--hotplug", "true"},
+        {"--reset-concurrency", "1"},
+        {"--reset-timeout-ms", "10000"},
+        {"--usbip-mapping", "none"},
+        {"--usbip-bind-command", "~/realsense-simple-wrapper/scripts/pi4_client_bind.sh"},
+        {"--reset-policy", "health"},
+        {"--reset-groups", "auto"},
+        {"--health-window-ms", "2000"},
+        {"--health-grace-ms", "2000"},
+        {"--health-escalate-ms", "30000"},
+        {"--health-max-empty-ms", "500"},
+        {"--health-frozen-frames", "5"},
+        {"--health-max-drop-rate", "0.2"},
+        {"--health-max-error-rate", "0.5"},
+        {"--health-max-temperature", "65"},
+        {"--telemetry-interval-ms", "1000"},
+        {"--config", "none"},
+        {"--color-width", "0"},
+        {"--color-height", "0"},
+        {"--color-fps", "0"},
+        {"--depth-width", "0"},
+        {"--depth-height", "0"},
+        {"--depth-fps", "0"},
     };
 
+    // options that can be set per device in the config file.
+    std::vector<std::string> _DEVICE_KEYS{
+        "width",
+        "height",
+        "fps",
+        "color-width",
+        "color-height",
+        "color-fps",
+        "depth-width",
+        "depth-height",
+        "depth-fps",
+        "color-format",
+        "depth-format",
+        "depth-filters",
+        "save-path",
+    };
+
+    // device_sn > key > value, from the [device <sn>] sections of --config.
+    std::map<std::string, std::map<std::string, std::string>> _DEVICE_ARGS;
+
     /**
      * @brief Construct a new rs2args object (empty)
      *
@@ -57,7 +142,11 @@ public:
      * @param argc Number of arguments.
      * @param argv Arguments in an array of char*.
      */
-    rs2args(int argc, char *argv[]) : argparser(argc, argv){};
+    rs2args(int argc, char *argv[]) : argparser(argc, argv)
+    {
+        if (config() != "none")
+            load_config(config());
+    };
 
     /**
      * @brief Destroy the rs2args object
@@ -167,7 +256,8 @@ public:
     };
 
     /**
-     * @brief steps to flush initial frames.
+     * @brief steps to flush initial frames when the AE convergence is off
+     * (--ae-max-wait-ms 0).
      *
      * @return int
      */
@@ -178,7 +268,7 @@ public:
     };
 
     /**
-     * @brief interval to reset pipeline.
+     * @brief interval to reset pipeline, used with --reset-policy interval.
      *
      * @return int
      */
@@ -282,6 +372,846 @@ public:
         return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
     };
 
+    /**
+     * @brief Max storage used under the save path in MB, 0 = unlimited.
+     *
+     * @return int
+     */
+    int storage_max_mb()
+    {
+        auto _arg = "--storage-max-mb";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Min free space on the storage filesystem in MB, 0 = disabled.
+     *
+     * @return int
+     */
+    int storage_min_free_mb()
+    {
+        auto _arg = "--storage-min-free-mb";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Interval for checking the storage quota in sec.
+     *
+     * @return int
+     */
+    int storage_check_interval()
+    {
+        auto _arg = "--storage-check-interval";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Interval for saving data into a new trial folder in sec.
+     *
+     * @return int
+     */
+    int storage_rotation_interval()
+    {
+        auto _arg = "--storage-rotation-interval";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief How long before a rotation the next trial folders are created in sec.
+     *
+     * @return int
+     */
+    int storage_rotation_lead()
+    {
+        auto _arg = "--storage-rotation-lead";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Fan-out of the per-frame folders: none, time:<sec> or frames:<N>.
+     *
+     * @return std::string
+     */
+    std::string storage_fanout()
+    {
+        auto _arg = "--storage-fanout";
+        return checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+    };
+
+    /**
+     * @brief Interval for printing the metrics in sec, 0 = never.
+     *
+     * @return int
+     */
+    int metrics_printout_interval()
+    {
+        auto _arg = "--metrics-printout-interval";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Streams used to gate the recording: none, depth, color or both.
+     *
+     * @return std::string
+     */
+    std::string motion_gate()
+    {
+        auto _arg = "--motion-gate";
+        auto f = checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+        if (f == "none" || f == "depth" || f == "color" || f == "both")
+            return f;
+        else
+            throw std::invalid_argument("motion gate unknown");
+    };
+
+    /**
+     * @brief Fraction of changed pixels that starts the full rate recording.
+     *
+     * @return float
+     */
+    float motion_on_threshold()
+    {
+        auto _arg = "--motion-on-threshold";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Fraction of changed pixels below which the post-roll counts down.
+     *
+     * @return float
+     */
+    float motion_off_threshold()
+    {
+        auto _arg = "--motion-off-threshold";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Min change of a depth pixel (depth units) to count as changed.
+     *
+     * @return int
+     */
+    int motion_depth_delta()
+    {
+        auto _arg = "--motion-depth-delta";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Min change of a color byte to count as changed.
+     *
+     * @return int
+     */
+    int motion_color_delta()
+    {
+        auto _arg = "--motion-color-delta";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Only every n-th row is used for the change detection.
+     *
+     * @return int
+     */
+    int motion_downsample()
+    {
+        auto _arg = "--motion-downsample";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Frames per second saved while the scene is static.
+     *
+     * @return float
+     */
+    float motion_idle_fps()
+    {
+        auto _arg = "--motion-idle-fps";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Number of skipped frames saved when the scene starts changing.
+     *
+     * @return int
+     */
+    int motion_pre_roll()
+    {
+        auto _arg = "--motion-pre-roll";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Number of static frames still saved at full rate after a change.
+     *
+     * @return int
+     */
+    int motion_post_roll()
+    {
+        auto _arg = "--motion-post-roll";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Recording mode: continuous or trigger.
+     *
+     * @return std::string
+     */
+    std::string record_mode()
+    {
+        auto _arg = "--record-mode";
+        auto f = checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+        if (f == "continuous" || f == "trigger")
+            return f;
+        else
+            throw std::invalid_argument("record mode unknown");
+    };
+
+    /**
+     * @brief Seconds of frames before a trigger that are saved.
+     *
+     * @return float
+     */
+    float trigger_pre_sec()
+    {
+        auto _arg = "--trigger-pre-sec";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Seconds of frames after a trigger that are saved.
+     *
+     * @return float
+     */
+    float trigger_post_sec()
+    {
+        auto _arg = "--trigger-post-sec";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Unix socket that receives triggers, none = disabled.
+     *
+     * @return std::string
+     */
+    std::string trigger_socket()
+    {
+        auto _arg = "--trigger-socket";
+        return checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+    };
+
+    /**
+     * @brief Max memory in MB of the frames buffered per device.
+     *
+     * @return int
+     */
+    int ring_max_mb()
+    {
+        auto _arg = "--ring-max-mb";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max memory in MB of the frames buffered by all devices, split
+     * evenly across the devices (capped by --ring-max-mb).
+     *
+     * @return int
+     */
+    int ring_total_mb()
+    {
+        auto _arg = "--ring-total-mb";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Depth filters applied before saving, e.g. threshold:0.5:5,spatial.
+     *
+     * @return std::string
+     */
+    std::string depth_filters()
+    {
+        auto _arg = "--depth-filters";
+        return checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+    };
+
+    /**
+     * @brief Depth saved when filters are used: raw, filtered or both.
+     *
+     * @return std::string
+     */
+    std::string depth_output()
+    {
+        auto _arg = "--depth-output";
+        auto f = checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+        if (f == "raw" || f == "filtered" || f == "both")
+            return f;
+        else
+            throw std::invalid_argument("depth output unknown");
+    };
+
+    /**
+     * @brief Number of threads used by the depth filters, 0 = number of cores.
+     *
+     * @return int
+     */
+    int filter_threads()
+    {
+        auto _arg = "--filter-threads";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Point cloud saved per frameset: none, xyz or xyzrgb.
+     *
+     * @return std::string
+     */
+    std::string pointcloud()
+    {
+        auto _arg = "--pointcloud";
+        auto f = checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+        if (f == "none" || f == "xyz" || f == "xyzrgb")
+            return f;
+        else
+            throw std::invalid_argument("pointcloud unknown");
+    };
+
+    /**
+     * @brief Voxel size in meters of the point cloud downsampling, 0 disables it.
+     *
+     * @return float
+     */
+    float voxel_size()
+    {
+        auto _arg = "--voxel-size";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Point per voxel: centroid or first.
+     *
+     * @return std::string
+     */
+    std::string voxel_reduction()
+    {
+        auto _arg = "--voxel-reduction";
+        auto f = checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+        if (f == "centroid" || f == "first")
+            return f;
+        else
+            throw std::invalid_argument("voxel reduction unknown");
+    };
+
+    /**
+     * @brief Camera -> world transforms of the point cloud fusion, none
+     * disables the fusion. See fusion.hpp for the file format.
+     *
+     * @return std::string
+     */
+    std::string fusion_extrinsics()
+    {
+        auto _arg = "--fusion-extrinsics";
+        return checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+    };
+
+    /**
+     * @brief Voxel size in meters that removes the overlap of the fused
+     * cameras, 0 keeps all points.
+     *
+     * @return float
+     */
+    float fusion_voxel_size()
+    {
+        auto _arg = "--fusion-voxel-size";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Timestamp used to match the framesets of the devices:
+     * none (disabled), host (arrival time) or sensor (sensor timestamp
+     * corrected by the clock model).
+     *
+     * @return std::string
+     */
+    std::string sync()
+    {
+        auto _arg = "--sync";
+        auto f = checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+        if (f == "none" || f == "host" || f == "sensor")
+            return f;
+        else
+            throw std::invalid_argument("sync mode unknown");
+    };
+
+    /**
+     * @brief Max distance of a frameset to the timestamp of its bundle.
+     *
+     * @return float
+     */
+    float sync_tolerance_ms()
+    {
+        auto _arg = "--sync-tolerance-ms";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max wait for the framesets of the other devices of a bundle.
+     *
+     * @return float
+     */
+    float sync_max_wait_ms()
+    {
+        auto _arg = "--sync-max-wait-ms";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max framesets queued per device for the matching.
+     *
+     * @return int
+     */
+    int sync_queue()
+    {
+        auto _arg = "--sync-queue";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max devices initialized at once in multithreading mode,
+     * 0 = all at once.
+     *
+     * @return int
+     */
+    int init_concurrency()
+    {
+        auto _arg = "--init-concurrency";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Retries of a failed device initialization.
+     *
+     * @return int
+     */
+    int init_retries()
+    {
+        auto _arg = "--init-retries";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Wait before the first retry of a device initialization in ms,
+     * doubled every retry.
+     *
+     * @return int
+     */
+    int init_backoff_ms()
+    {
+        auto _arg = "--init-backoff-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max wait for a device to be ready (started, options readable,
+     * first frameset) after a start or reset in ms.
+     *
+     * @return int
+     */
+    int ready_timeout_ms()
+    {
+        auto _arg = "--ready-timeout-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max relative change of exposure, gain and brightness between
+     * 2 frames for the AE to count as settled.
+     *
+     * @return float
+     */
+    float ae_tolerance()
+    {
+        auto _arg = "--ae-tolerance";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Frames in a row within --ae-tolerance for the AE to converge.
+     *
+     * @return int
+     */
+    int ae_stable_frames()
+    {
+        auto _arg = "--ae-stable-frames";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max wait in ms for the AE to converge when flushing, 0 = a
+     * fixed --flush-steps frames are flushed instead.
+     *
+     * @return int
+     */
+    int ae_max_wait_ms()
+    {
+        auto _arg = "--ae-max-wait-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Whether devices that drop off the bus are restarted when they
+     * come back, while the others keep streaming.
+     *
+     * @return true
+     * @return false
+     */
+    bool hotplug()
+    {
+        auto _arg = "--hotplug";
+        return checkarg(_arg) ? getargb(_arg) : stob(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max devices in a hardware reset at the same time.
+     *
+     * @return int
+     */
+    int reset_concurrency()
+    {
+        auto _arg = "--reset-concurrency";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max duration of a hardware reset (bind + enumeration) in ms,
+     * the device stays unavailable if it is not back by then.
+     *
+     * @return int
+     */
+    int reset_timeout_ms()
+    {
+        auto _arg = "--reset-timeout-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief File with the usbip address of every device, one
+     * "<device_sn> <address>" per line. "none" skips the bind after a reset.
+     *
+     * @return std::string
+     */
+    std::string usbip_mapping()
+    {
+        auto _arg = "--usbip-mapping";
+        return checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+    };
+
+    /**
+     * @brief Command run with the usbip address of a device after its
+     * hardware reset.
+     *
+     * @return std::string
+     */
+    std::string usbip_bind_command()
+    {
+        auto _arg = "--usbip-bind-command";
+        return checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+    };
+
+    /**
+     * @brief When the devices are reset: health (when they are unhealthy),
+     * interval (every --reset-interval steps, one device after the other)
+     * or none.
+     *
+     * @return std::string
+     */
+    std::string reset_policy()
+    {
+        auto _arg = "--reset-policy";
+        auto f = checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+        if (f == "health" || f == "interval" || f == "none")
+            return f;
+        else
+            throw std::invalid_argument("reset policy unknown");
+    };
+
+    /**
+     * @brief Devices that are not reset at the same time, "sn,sn;sn,sn".
+     * auto : all devices if --sync is used, else none.
+     *
+     * @return std::string
+     */
+    std::string reset_groups()
+    {
+        auto _arg = "--reset-groups";
+        return checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+    };
+
+    /**
+     * @brief Window in ms of the drop and error rates of a device.
+     *
+     * @return int
+     */
+    int health_window_ms()
+    {
+        auto _arg = "--health-window-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Time in ms a device has to settle after a reset.
+     *
+     * @return int
+     */
+    int health_grace_ms()
+    {
+        auto _arg = "--health-grace-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief A device that is unhealthy again within this time (ms) after a
+     * pipeline restart gets a hardware reset.
+     *
+     * @return int
+     */
+    int health_escalate_ms()
+    {
+        auto _arg = "--health-escalate-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max time in ms without any frameset.
+     *
+     * @return int
+     */
+    int health_max_empty_ms()
+    {
+        auto _arg = "--health-max-empty-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max framesets in a row with the same sensor timestamp.
+     *
+     * @return int
+     */
+    int health_frozen_frames()
+    {
+        auto _arg = "--health-frozen-frames";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max ratio of frames dropped (frame counter gaps) in the window.
+     *
+     * @return float
+     */
+    float health_max_drop_rate()
+    {
+        auto _arg = "--health-max-drop-rate";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max ratio of framesets with an error in the window.
+     *
+     * @return float
+     */
+    float health_max_error_rate()
+    {
+        auto _arg = "--health-max-error-rate";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Max ASIC/projector temperature in C before a warning (no
+     * reset), 0 = unchecked.
+     *
+     * @return float
+     */
+    float health_max_temperature()
+    {
+        auto _arg = "--health-max-temperature";
+        return checkarg(_arg) ? getargf(_arg) : std::stof(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Interval in ms between 2 telemetry samples (temperatures,
+     * laser power, exposure, gain) of a device.
+     *
+     * @return int
+     */
+    int telemetry_interval_ms()
+    {
+        auto _arg = "--telemetry-interval-ms";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Config file with the arguments, see load_config().
+     *
+     * @return std::string
+     */
+    std::string config()
+    {
+        auto _arg = "--config";
+        return checkarg(_arg) ? getarg(_arg) : _OPTIONAL_ARGS[_arg];
+    };
+
+    /**
+     * @brief Reads a config file. Lines are 'key = value' with the option
+     * names without '--', e.g. 'fps = 30', '#' starts a comment.
+     * The keys after a '[device <sn>]' line only apply to that device and
+     * are limited to _DEVICE_KEYS. The command line has the priority over
+     * the global keys of the file.
+     *
+     * @param filename path to the config file.
+     */
+    void load_config(const std::string &filename)
+    {
+        std::ifstream file(filename);
+        if (!file.is_open())
+            throw std::invalid_argument("config file not found : " + filename);
+
+        auto trim = [](const std::string &x)
+        {
+            size_t begin = x.find_first_not_of(" \t\r");
+            size_t end = x.find_last_not_of(" \t\r");
+            return begin == std::string::npos ? std::string() : x.substr(begin, end - begin + 1);
+        };
+
+        std::string line;
+        std::string device_sn;
+        int line_idx = 0;
+        while (std::getline(file, line))
+        {
+            line_idx++;
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+
+            std::string where = filename + ":" + std::to_string(line_idx);
+            if (line.front() == '[')
+            {
+                std::istringstream section(trim(line.substr(1, line.find(']') - 1)));
+                std::string section_type;
+                section >> section_type >> device_sn;
+                if (line.back() != ']' || section_type != "device" || device_sn.empty())
+                    throw std::invalid_argument(where + " : expected '[device <sn>]'");
+                _DEVICE_ARGS[device_sn];
+                continue;
+            }
+
+            size_t eq = line.find('=');
+            if (eq == std::string::npos)
+                throw std::invalid_argument(where + " : expected 'key = value'");
+            std::string key = trim(line.substr(0, eq));
+            std::string value = trim(line.substr(eq + 1));
+
+            if (!device_sn.empty())
+            {
+                if (std::find(_DEVICE_KEYS.begin(), _DEVICE_KEYS.end(), key) == _DEVICE_KEYS.end())
+                    throw std::invalid_argument(where + " : '" + key + "' can not be set per device");
+                _DEVICE_ARGS[device_sn][key] = value;
+            }
+            else
+            {
+                std::string option = "--" + key;
+                if (option == "--config" ||
+                    (_OPTIONAL_ARGS.count(option) == 0 &&
+                     std::find(_REQUIRED_ARGS.begin(), _REQUIRED_ARGS.end(), option) == _REQUIRED_ARGS.end()))
+                    throw std::invalid_argument(where + " : unknown option '" + key + "'");
+                setdefault(option, value);
+            }
+        }
+    };
+
+    /**
+     * @brief Value of a per device option, the global one if the device
+     * does not override it.
+     *
+     * @param device_sn device serial number.
+     * @param key option name without '--', one of _DEVICE_KEYS.
+     * @return std::string
+     */
+    std::string device_arg(const std::string &device_sn, const std::string &key)
+    {
+        auto device = _DEVICE_ARGS.find(device_sn);
+        if (device != _DEVICE_ARGS.end() && device->second.count(key) > 0)
+            return device->second.at(key);
+        std::string option = "--" + key;
+        if (checkarg(option) || _OPTIONAL_ARGS.count(option) == 0)
+            return getarg(option);
+        return _OPTIONAL_ARGS[option];
+    };
+
+    /**
+     * @brief Width of the color stream, 0 = --width.
+     *
+     * @return int
+     */
+    int color_width()
+    {
+        auto _arg = "--color-width";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Height of the color stream, 0 = --height.
+     *
+     * @return int
+     */
+    int color_height()
+    {
+        auto _arg = "--color-height";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief FPS of the color stream, 0 = --fps.
+     *
+     * @return int
+     */
+    int color_fps()
+    {
+        auto _arg = "--color-fps";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Width of the depth stream, 0 = --width.
+     *
+     * @return int
+     */
+    int depth_width()
+    {
+        auto _arg = "--depth-width";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief Height of the depth stream, 0 = --height.
+     *
+     * @return int
+     */
+    int depth_height()
+    {
+        auto _arg = "--depth-height";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
+    /**
+     * @brief FPS of the depth stream, 0 = --fps.
+     *
+     * @return int
+     */
+    int depth_fps()
+    {
+        auto _arg = "--depth-fps";
+        return checkarg(_arg) ? getargi(_arg) : std::stoi(_OPTIONAL_ARGS[_arg]);
+    };
+
     /**
      * @brief prints out the raw arguments.
      *
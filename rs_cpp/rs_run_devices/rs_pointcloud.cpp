@@ -0,0 +1,156 @@
+// Offline point cloud generation from a trial recorded by rs_run_devices.
+//
+// Usage :
+// rs_pointcloud --trial <save_path>/<device_sn>/<trial_idx>
+//               [--color true] [--filtered false] [--step 1] [--threads 0]
+//               [--voxel-size 0] [--voxel-reduction centroid]
+//
+// The point clouds are saved as <trial>/pointcloud/<timestamp>.ply .
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+#include "workerpool.hpp"
+#include "recording.hpp"
+#include "pointcloud.hpp"
+#include "voxel.hpp"
+
+/**
+ * @brief Returns the value of an option, or its default if not given.
+ *
+ * @param parser argparser.
+ * @param option option name.
+ * @param default_value default value.
+ * @return std::string
+ */
+std::string getarg_or(argparser &parser,
+                      const std::string &option,
+                      const std::string &default_value)
+{
+    return parser.checkarg(option) ? parser.getarg(option) : default_value;
+}
+
+int main(int argc, char *argv[])
+{
+    argparser parser(argc, argv);
+    if (!parser.checkarg("--trial"))
+    {
+        print("usage : rs_pointcloud --trial <path> [--color true] "
+              "[--filtered false] [--step 1] [--threads 0] "
+              "[--voxel-size 0] [--voxel-reduction centroid]",
+              2);
+        return EXIT_FAILURE;
+    }
+
+    std::string trial_path = parser.getarg("--trial");
+    bool use_color = stob(getarg_or(parser, "--color", "true"));
+    bool use_filtered = stob(getarg_or(parser, "--filtered", "false"));
+    int step = std::max(1, std::stoi(getarg_or(parser, "--step", "1")));
+    int num_threads = std::stoi(getarg_or(parser, "--threads", "0"));
+    float voxel_size = std::stof(getarg_or(parser, "--voxel-size", "0"));
+    std::string voxel_reduction = getarg_or(parser, "--voxel-reduction", "centroid");
+
+    recordingreader reader(trial_path);
+    if (!reader.open())
+        return EXIT_FAILURE;
+
+    int color_bpp = reader.color_bpp();
+    bool color_bgr = reader.color_format == RS2_FORMAT_BGR8 ||
+                     reader.color_format == RS2_FORMAT_BGRA8;
+    if (use_color && color_bpp == 0)
+    {
+        print("color format not supported, saving xyz only", 1);
+        use_color = false;
+    }
+    if (use_color && !reader.depth_aligned)
+    {
+        print("depth is not aligned to color, saving xyz only", 1);
+        use_color = false;
+    }
+
+    std::string output_path = trial_path + "/pointcloud";
+    mkdir(output_path.c_str(), 0777);
+
+    workerpool pool(num_threads);
+    pointcloud pc(&pool);
+    std::shared_ptr<voxelgrid> grid;
+    if (voxel_size > 0.0f)
+        grid = std::make_shared<voxelgrid>(
+            voxel_size, voxelgrid::reduction_from_string(voxel_reduction), &pool);
+    // the depth is saved aligned to color if both have the same resolution.
+    const rs2_intrinsics &intrinsics =
+        reader.depth_aligned ? reader.color_intrinsics : reader.depth_intrinsics;
+    pc.set_intrinsics(intrinsics);
+    int width = intrinsics.width;
+    int height = intrinsics.height;
+    float depth_unit = reader.depth_scale;
+
+    std::vector<uint8_t> depth;
+    std::vector<uint8_t> color;
+    size_t num_saved = 0;
+    const std::vector<recordingframe> &frames = reader.frames();
+    for (size_t i = 0; i < frames.size(); i += step)
+    {
+        const recordingframe &frame = frames[i];
+        const std::string &depth_file =
+            use_filtered ? frame.depth_filtered_file : frame.depth_file;
+        if (!frame.stored || depth_file.empty())
+            continue;
+        if (!reader.read(depth_file, depth))
+        {
+            print("could not read " + depth_file, 1);
+            continue;
+        }
+
+        // the filtered depth can be decimated, its size is in calib.csv.
+        int depth_width = width;
+        int depth_height = height;
+        if (use_filtered && reader.filtered_width > 0 && reader.filtered_height > 0)
+        {
+            depth_width = reader.filtered_width;
+            depth_height = reader.filtered_height;
+        }
+        if (depth.size() != (size_t)depth_width * depth_height * 2)
+        {
+            print("unexpected size of " + depth_file, 1);
+            continue;
+        }
+
+        bool with_color = use_color && !frame.color_file.empty() &&
+                          reader.read(frame.color_file, color) &&
+                          color.size() == (size_t)width * height * color_bpp;
+        size_t num_points = pc.process(
+            reinterpret_cast<const uint16_t *>(depth.data()),
+            depth_width, depth_height, depth_width * 2, depth_unit,
+            with_color ? color.data() : nullptr,
+            width, height, width * color_bpp, color_bpp, color_bgr);
+        const float *points = pc.points();
+        const uint8_t *colors = with_color ? pc.colors() : nullptr;
+        if (grid)
+        {
+            num_points = grid->process(points, num_points, 3, colors);
+            points = grid->points();
+            colors = grid->colors();
+        }
+
+        std::string filename =
+            output_path + "/" +
+            pad_zeros(std::to_string(frame.global_timestamp), 20) + ".ply";
+        if (!points_to_ply(filename, points, colors, num_points))
+        {
+            print("could not write " + filename, 2);
+            return EXIT_FAILURE;
+        }
+        num_saved++;
+    }
+
+    print("saved " + std::to_string(num_saved) + " point clouds to " + output_path, 0);
+    return EXIT_SUCCESS;
+}
@@ -37,13 +37,11 @@ void print_rs2_device_infos(const rs2::device &device, const bool &verbose)
     std::cout << std::string(80, '=') << std::endl;
 }
 
-void print_camera_temperature(device &device,
-                              const int &printout_interval,
-                              const bool &verbose)
+float print_camera_temperature(device &device,
+                               const int &printout_interval,
+                               const bool &verbose)
 {
-    if (!verbose)
-        return;
-
+    float max_temp = -1.0f;
     int c = device.camera_temp_printout_counter;
     if (c >= printout_interval || c == -1)
     {
@@ -52,15 +50,20 @@ void print_camera_temperature(device &device,
         if (dss->supports(RS2_OPTION_ASIC_TEMPERATURE))
         {
             auto temp = dss->get_option(RS2_OPTION_ASIC_TEMPERATURE);
-            print(device.sn + " Temperature ASIC      : " + std::to_string(temp), 0);
+            max_temp = std::max(max_temp, temp);
+            if (verbose)
+                print(device.sn + " Temperature ASIC      : " + std::to_string(temp), 0);
         }
         if (dss->supports(RS2_OPTION_PROJECTOR_TEMPERATURE))
         {
             auto temp = dss->get_option(RS2_OPTION_PROJECTOR_TEMPERATURE);
-            print(device.sn + " Temperature Projector : " + std::to_string(temp), 0);
+            max_temp = std::max(max_temp, temp);
+            if (verbose)
+                print(device.sn + " Temperature Projector : " + std::to_string(temp), 0);
         }
     }
     device.camera_temp_printout_counter += 1;
+    return max_temp;
 }
 
 void print_no_device_enabled(const std::string &function)
@@ -83,36 +86,31 @@ bool framedata_to_bin(const rs2::frame &frm, const std::string &filename)
     return ret;
 }
 
-void metadata_to_csv(const rs2::frame &frm, const std::string &filename)
+void metadata_to_csv(const rs2::frame &frm,
+                     const std::string &filename,
+                     metadatacache &cache)
 {
-    std::ofstream csv;
-    csv.open(filename);
-
-    csv << "Stream,"
-        << rs2_stream_to_string(frm.get_profile().stream_type())
-        << "\nAttribute,Value\n";
+    const metadatamask &mask = cache.query(frm);
+    metadatarecord record;
+    mask.extract(frm, record);
+    mask.to_csv(record, filename);
+}
 
-    rs2_frame_metadata_value metadata_idx;
-    for (size_t i = 0; i < RS2_FRAME_METADATA_COUNT; i++)
-    {
-        metadata_idx = (rs2_frame_metadata_value)i;
-        if (frm.supports_frame_metadata(metadata_idx))
-        {
-            // rs2_metadata_type => long long.
-            rs2_metadata_type metadata = frm.get_frame_metadata(metadata_idx);
-            csv << rs2_frame_metadata_to_string(metadata_idx)
-                << ","
-                << metadata
-                << "\n";
-        }
-    }
-    csv.close();
+rs2_metadata_type query_frame_metadata(const rs2::frame &frm,
+                                       const rs2_frame_metadata_value &metadata)
+{
+    if (!frm || !frm.supports_frame_metadata(metadata))
+        return -1;
+    return frm.get_frame_metadata(metadata);
 }
 
 void timestamp_to_txt(const int64_t &global_timestamp,
                       const rs2_metadata_type &color_timestamp,
                       const rs2_metadata_type &depth_timestamp,
-                      const std::string &filename)
+                      const std::string &filename,
+                      const bool &stored,
+                      const int64_t &corrected_timestamp,
+                      const framegaps &gaps)
 {
     std::fstream txt;
     txt.open(filename, std::fstream::in | std::fstream::out | std::fstream::app);
@@ -124,20 +122,70 @@ void timestamp_to_txt(const int64_t &global_timestamp,
         << color_timestamp
         << "::"
         << depth_timestamp
+        << "::"
+        << (stored ? 1 : 0)
+        << "::"
+        << corrected_timestamp
+        << "::"
+        << gaps.color_dropped
+        << "::"
+        << gaps.depth_dropped
+        << "::"
+        << gaps.color_jitter_us
+        << "::"
+        << gaps.depth_jitter_us
         << "\n";
     txt.close();
 }
 
-bool check_if_color_depth_frames_are_valid(const rs2::frameset &frameset)
+bool check_if_color_depth_frames_are_valid(const rs2::frameset &frameset,
+                                           const bool &partial)
 {
     rs2::frame cf = frameset.first_or_default(RS2_STREAM_COLOR);
     rs2::frame df = frameset.first_or_default(RS2_STREAM_DEPTH);
-    if (!cf || !df)
+    if (partial)
+        return cf || df;
+    else if (!cf || !df)
         return false;
     else
         return true;
 }
 
+bool check_if_streams_differ_in_fps(const rs2::pipeline_profile &profile)
+{
+    std::vector<rs2::stream_profile> streams = profile.get_streams();
+    for (auto const &stream : streams)
+        if (stream.fps() != streams.front().fps())
+            return true;
+    return false;
+}
+
+// [FRAMESETCOMPOSER CLASS] ----------------------------------------------------
+framesetcomposer::framesetcomposer()
+    : queue(1),
+      block([this](rs2::frame, rs2::frame_source &source)
+            { source.frame_ready(source.allocate_composite_frame(frames)); })
+{
+    block.start(queue);
+}
+
+rs2::frameset framesetcomposer::compose(const std::vector<rs2::frame> &frames)
+{
+    if (frames.empty())
+        return rs2::frameset();
+
+    // the processing block runs synchronously in invoke().
+    this->frames = frames;
+    block.invoke(frames.front());
+    this->frames.clear();
+
+    rs2::frame composite;
+    if (!queue.poll_for_frame(&composite))
+        return rs2::frameset();
+    return composite.as<rs2::frameset>();
+}
+// ---------------------------------------------------- [FRAMESETCOMPOSER CLASS]
+
 // [STORAGEPATH CLASS] ---------------------------------------------------------
 storagepath::storagepath()
 {
@@ -146,13 +194,35 @@ storagepath::storagepath()
 void storagepath::create(const std::vector<std::string> &device_sns,
                          const std::string &base_path)
 {
-    time(&trial_idx);
+    time_t _trial_idx;
+    time(&_trial_idx);
+    this->create(device_sns, base_path, _trial_idx);
+}
+
+void storagepath::create(const std::vector<std::string> &device_sns,
+                         const std::string &base_path,
+                         const time_t &trial_idx)
+{
+    this->trial_idx = trial_idx;
     for (auto const &device_sn : device_sns)
     {
         this->create(device_sn, base_path);
     }
 }
 
+void storagepath::create(const std::vector<std::string> &device_sns,
+                         const std::string &base_path,
+                         const time_t &trial_idx,
+                         const std::map<std::string, std::string> &base_paths)
+{
+    this->trial_idx = trial_idx;
+    for (auto const &device_sn : device_sns)
+    {
+        auto itr = base_paths.find(device_sn);
+        this->create(device_sn, itr != base_paths.end() ? itr->second : base_path);
+    }
+}
+
 void storagepath::create(const std::string &device_sn,
                          const std::string &base_path)
 {
@@ -171,6 +241,12 @@ void storagepath::create(const std::string &device_sn,
     // Timestamp
     this->timestamp[device_sn] = path + "/timestamp";
     this->make_dirs(this->timestamp[device_sn].c_str(), false);
+    // Clock model fits, not in 'timestamp' that only holds the journal.
+    this->clock[device_sn] = path + "/clock";
+    this->make_dirs(this->clock[device_sn].c_str(), false);
+    // Telemetry samples
+    this->telemetry[device_sn] = path + "/telemetry";
+    this->make_dirs(this->telemetry[device_sn].c_str(), false);
     // Calib
     this->calib[device_sn] = path + "/calib";
     this->make_dirs(this->calib[device_sn].c_str(), false);
@@ -182,8 +258,24 @@ void storagepath::create(const std::string &device_sn,
     // Depth
     this->depth[device_sn] = path + "/depth";
     this->make_dirs(this->depth[device_sn].c_str(), false);
+    if (this->filtered_devices.count(device_sn) > 0)
+    {
+        this->depth_filtered[device_sn] = path + "/depth_filtered";
+        this->make_dirs(this->depth_filtered[device_sn].c_str(), false);
+    }
     this->depth_metadata[device_sn] = path + "/depth_metadata";
     this->make_dirs(this->depth_metadata[device_sn].c_str(), false);
+    // Point cloud
+    this->pointcloud[device_sn] = path + "/pointcloud";
+    this->make_dirs(this->pointcloud[device_sn].c_str(), false);
+}
+
+void storagepath::create_fusion(const std::string &base_path)
+{
+    std::string path = base_path + "/" + FUSION_FOLDER;
+    this->make_dirs(path.c_str(), true);
+    this->fusion = path + "/" + std::to_string(trial_idx);
+    this->make_dirs(this->fusion.c_str(), false);
 }
 
 void storagepath::show()
@@ -197,8 +289,64 @@ void storagepath::show(const std::string &device_sn)
     print("calib : " + calib[device_sn], 0);
     print("color : " + color[device_sn], 0);
     print("depth : " + depth[device_sn], 0);
+    if (depth_filtered.count(device_sn) > 0)
+        print("depth_filtered : " + depth_filtered[device_sn], 0);
     print("color_metadata : " + color_metadata[device_sn], 0);
     print("depth_metadata : " + depth_metadata[device_sn], 0);
+    print("pointcloud : " + pointcloud[device_sn], 0);
+}
+
+void storagepath::set_fanout(const std::string &spec)
+{
+    fanout_created.clear();
+    size_t sep = spec.find(':');
+    std::string mode = spec.substr(0, sep);
+    if (mode == "none" || mode.empty())
+    {
+        fanout_mode = 0;
+        fanout_size = 0;
+        return;
+    }
+    if (sep == std::string::npos)
+        throw std::invalid_argument("storage fanout size missing : " + spec);
+    fanout_size = std::stoll(spec.substr(sep + 1));
+    if (fanout_size <= 0)
+        throw std::invalid_argument("storage fanout size must be > 0 : " + spec);
+    if (mode == "time")
+        fanout_mode = 1;
+    else if (mode == "frames")
+        fanout_mode = 2;
+    else
+        throw std::invalid_argument("storage fanout unknown : " + spec);
+}
+
+std::string storagepath::fanout(const std::string &path,
+                                const int64_t &global_timestamp,
+                                const int64_t &frame_idx,
+                                const bool &create)
+{
+    int64_t shard = 0;
+    if (fanout_mode == 1)
+        shard = global_timestamp / (fanout_size * 1000000000LL);
+    else if (fanout_mode == 2)
+        shard = frame_idx / fanout_size;
+    else
+        return path;
+
+    std::string shard_path = path + "/" + pad_zeros(std::to_string(shard), 8);
+
+    // Creates the shard when it is first written to.
+    if (create)
+    {
+        auto itr = fanout_created.find(path);
+        if (itr == fanout_created.end() || itr->second != shard)
+        {
+            this->make_dirs(shard_path.c_str(), true);
+            fanout_created[path] = shard;
+        }
+    }
+
+    return shard_path;
 }
 
 int storagepath::make_dirs(const char *path, const bool &exists_ok)
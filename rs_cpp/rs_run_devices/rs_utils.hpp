@@ -15,11 +15,15 @@
 #include <iostream> // Terminal IO
 #include <sstream>  // Stringstreams
 #include <vector>
+#include <algorithm>
 #include <map>
+#include <set>
 #include <cerrno>
 #include <cstring>
 
 #include "utils.hpp"
+#include "metadata.hpp"
+#include "gaps.hpp"
 
 /**
  * @brief Creates a holder to collect important rs variables.
@@ -35,11 +39,33 @@ struct device
     rs2_metadata_type depth_timestamp = 0;
     rs2_metadata_type color_reset_counter = 0;
     rs2_metadata_type depth_reset_counter = 0;
+    int64_t frame_counter = 0;
     int camera_temp_printout_counter = -1;
     int num_streams = 0;
+    // the streams run at different fps, a frameset can miss the slower one.
+    bool partial_framesets = false;
+    // target of the alignment of a frameset without a color frame.
+    rs2::frame last_color;
     std::string sn;
 };
 
+/**
+ * @brief A frameset that has not been saved yet, e.g. for a pre-roll.
+ *
+ */
+struct frameset_record
+{
+    int64_t global_timestamp = 0;
+    rs2_metadata_type color_timestamp = 0;
+    rs2_metadata_type depth_timestamp = 0;
+    // sensor timestamp in the host domain (clock model), -1 if none, in ns.
+    int64_t corrected_timestamp = -1;
+    framegaps gaps;
+    rs2::frameset frameset;
+    int64_t frame_idx = 0; // index in its trial, picks the fan-out shard
+    bool save = false; // whether it is saved when leaving a ring
+};
+
 /**
  * @brief Configs needed for rs stream.
  *
@@ -53,29 +79,103 @@ struct stream_config
     int framerate = 30;
 };
 
+// Folders of the data of all devices, next to the device folders of
+// <base_path>. The '_' keeps them out of the device namespace, the readers
+// skip them.
+const std::string SYNC_FOLDER = "_sync";
+const std::string FUSION_FOLDER = "_fusion";
+
 /**
  * @brief Storage paths to save data.
  *
+ * The per-frame folders (color, depth, *_metadata) can optionally be fanned
+ * out into numbered subfolders to keep the number of files per folder small:
+ * - "none"         : <folder>/<timestamp>.bin
+ * - "time:<sec>"   : <folder>/<global_timestamp / sec>/<timestamp>.bin
+ * - "frames:<N>"   : <folder>/<frame_idx / N>/<timestamp>.bin
+ * The frame index counts the framesets of a trial and is taken when the
+ * frameset is captured. A shard is created by the writer of its first file.
+ *
  */
 class storagepath
 {
 public:
     time_t trial_idx;
     bool save = true;
+    int fanout_mode = 0; // 0: none, 1: time, 2: frames
+    int64_t fanout_size = 0;
     std::vector<std::string> device_sns;
     std::map<std::string, std::string> timestamp;
+    std::map<std::string, std::string> clock;
+    std::map<std::string, std::string> telemetry;
     std::map<std::string, std::string> calib;
     std::map<std::string, std::string> color;
     std::map<std::string, std::string> depth;
+    std::map<std::string, std::string> depth_filtered;
     std::map<std::string, std::string> color_metadata;
     std::map<std::string, std::string> depth_metadata;
+    std::map<std::string, std::string> pointcloud;
+    // fused point clouds of all devices, empty if not created.
+    std::string fusion;
+    // devices with a 'depth_filtered' folder, set before 'create'.
+    std::set<std::string> filtered_devices;
     storagepath();
     void create(const std::vector<std::string> &device_sns,
                 const std::string &base_path);
+    void create(const std::vector<std::string> &device_sns,
+                const std::string &base_path,
+                const time_t &trial_idx);
+
+    /**
+     * @brief Creates the storage paths, devices in 'base_paths' are saved
+     * under their own base path instead of 'base_path'.
+     *
+     * @param device_sns device serial numbers.
+     * @param base_path default root of the storage layout.
+     * @param trial_idx trial index (folder name).
+     * @param base_paths device_sn > root of the storage layout.
+     */
+    void create(const std::vector<std::string> &device_sns,
+                const std::string &base_path,
+                const time_t &trial_idx,
+                const std::map<std::string, std::string> &base_paths);
     void show();
     void show(const std::string &device_sn);
 
+    /**
+     * @brief Creates the folder of the fused point clouds,
+     * <base_path>/_fusion/<trial_idx>.
+     *
+     * @param base_path root of the storage layout.
+     */
+    void create_fusion(const std::string &base_path);
+
+    /**
+     * @brief Sets the fan-out scheme of the per-frame folders.
+     *
+     * @param spec "none", "time:<sec>" or "frames:<N>".
+     */
+    void set_fanout(const std::string &spec);
+
+    /**
+     * @brief Returns the folder a frame should be saved into.
+     *
+     * @param path per-frame folder, e.g. 'color[device_sn]'.
+     * @param global_timestamp timestamp in ns used as filename.
+     * @param frame_idx index of the frameset in its trial.
+     * @param create whether to create the shard folder, if false the
+     *               writer creates it.
+     * @return std::string
+     */
+    std::string fanout(const std::string &path,
+                       const int64_t &global_timestamp,
+                       const int64_t &frame_idx,
+                       const bool &create = true);
+
 private:
+    // folder > shard index that has been created last.
+    std::map<std::string, int64_t> fanout_created;
+
     int make_dirs(const char *path, const bool &exists_ok);
     void create(const std::string &device_sn,
                 const std::string &base_path);
@@ -90,15 +190,17 @@ private:
 void print_rs2_device_infos(const rs2::device &device, const bool &verbose);
 
 /**
- * @brief prints out the temeprature of the camera asic and IR projector
+ * @brief reads the temeprature of the camera asic and IR projector every
+ * 'printout_interval' calls, prints it out if verbose.
  *
  * @param device
  * @param printout_interval
  * @param verbose
+ * @return float highest temperature read, -1 if not read in this call.
  */
-void print_camera_temperature(device &device,
-                              const int &printout_interval,
-                              const bool &verbose);
+float print_camera_temperature(device &device,
+                               const int &printout_interval,
+                               const bool &verbose);
 
 /**
  * @brief Prints out a message saying no device enabled.
@@ -125,8 +227,21 @@ bool framedata_to_bin(const rs2::frame &frm, const std::string &filename);
  *
  * @param frm An instance of rs2::frame .
  * @param filename name of file to save to.
+ * @param cache supported fields of the stream profiles.
  */
-void metadata_to_csv(const rs2::frame &frm, const std::string &filename);
+void metadata_to_csv(const rs2::frame &frm,
+                     const std::string &filename,
+                     metadatacache &cache);
+
+/**
+ * @brief Gets a metadata value of a rs2::frame.
+ *
+ * @param frm An instance of rs2::frame .
+ * @param metadata the metadata.
+ * @return rs2_metadata_type the value, -1 if it is not supported.
+ */
+rs2_metadata_type query_frame_metadata(const rs2::frame &frm,
+                                       const rs2_frame_metadata_value &metadata);
 
 /**
  * @briefsaves timestamp to txt file.
@@ -135,19 +250,64 @@ void metadata_to_csv(const rs2::frame &frm, const std::string &filename);
  * @param color_timestamp
  * @param depth_timestamp
  * @param filename
+ * @param stored whether the frames were saved (false if skipped by a gate).
+ * @param corrected_timestamp color timestamp in the host domain, -1 if none.
+ * @param gaps dropped frames + jitter of the color and depth streams.
  */
 void timestamp_to_txt(const int64_t &global_timestamp,
                       const rs2_metadata_type &color_timestamp,
                       const rs2_metadata_type &depth_timestamp,
-                      const std::string &filename);
+                      const std::string &filename,
+                      const bool &stored = true,
+                      const int64_t &corrected_timestamp = -1,
+                      const framegaps &gaps = framegaps());
 
 /**
  * @brief check if color and depth frames are valid.
  *
  * @param frameset
+ * @param partial whether one of the streams is enough.
+ * @return true
+ * @return false
+ */
+bool check_if_color_depth_frames_are_valid(const rs2::frameset &frameset,
+                                           const bool &partial = false);
+
+/**
+ * @brief check if the streams of a profile run at different fps.
+ *
+ * @param profile started pipeline profile.
  * @return true
  * @return false
  */
-bool check_if_color_depth_frames_are_valid(const rs2::frameset &frameset);
+bool check_if_streams_differ_in_fps(const rs2::pipeline_profile &profile);
+
+/**
+ * @brief Bundles frames into a frameset, e.g. a depth frame with the last
+ * color frame so that it can be aligned.
+ *
+ */
+class framesetcomposer
+{
+public:
+    framesetcomposer();
+
+    /**
+     * @brief Composes a frameset.
+     *
+     * @param frames frames of the frameset.
+     * @return rs2::frameset empty if it failed.
+     */
+    rs2::frameset compose(const std::vector<rs2::frame> &frames);
+
+private:
+    framesetcomposer(const framesetcomposer &) = delete;
+    framesetcomposer &operator=(const framesetcomposer &) = delete;
+
+    // frames of the running compose(), read by the processing block.
+    std::vector<rs2::frame> frames;
+    rs2::frame_queue queue;
+    rs2::processing_block block;
+};
 
 #endif
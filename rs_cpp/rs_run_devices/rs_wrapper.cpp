@@ -1,7 +1,10 @@
 #include "rs_wrapper.hpp"
 
 const int num_zeros_to_pad = 16;
-std::mutex reset_mux;
+
+// Restarts of a device that came back, the wait doubles after every failure.
+const int reattach_attempts = 4;
+const int reattach_backoff_ms = 500;
 
 /*******************************************************************************
  * rs2wrapper PUBLIC FUNCTIONS
@@ -12,7 +15,7 @@ rs2wrapper::rs2wrapper(int argc,
                        std::string device_sn)
 {
     rs2args _args = rs2args(argc, argv);
-    constructor(_args, _args.verbose(), context, device_sn);
+    constructor(_args, rs2config(_args), _args.verbose(), context, device_sn);
 }
 
 rs2wrapper::rs2wrapper(int argc,
@@ -22,22 +25,39 @@ rs2wrapper::rs2wrapper(int argc,
                        std::string device_sn)
 {
     rs2args _args = rs2args(argc, argv);
-    constructor(_args, verbose, context, device_sn);
+    constructor(_args, rs2config(_args), verbose, context, device_sn);
+}
+
+rs2wrapper::rs2wrapper(rs2args args,
+                       rs2::context context,
+                       std::string device_sn)
+{
+    constructor(args, rs2config(args), args.verbose(), context, device_sn);
+}
+
+rs2wrapper::rs2wrapper(rs2args args,
+                       const bool &verbose,
+                       rs2::context context,
+                       std::string device_sn)
+{
+    constructor(args, rs2config(args), verbose, context, device_sn);
 }
 
 rs2wrapper::rs2wrapper(rs2args args,
+                       const rs2config &config,
                        rs2::context context,
                        std::string device_sn)
 {
-    constructor(args, args.verbose(), context, device_sn);
+    constructor(args, config, args.verbose(), context, device_sn);
 }
 
 rs2wrapper::rs2wrapper(rs2args args,
+                       const rs2config &config,
                        const bool &verbose,
                        rs2::context context,
                        std::string device_sn)
 {
-    constructor(args, verbose, context, device_sn);
+    constructor(args, config, verbose, context, device_sn);
 }
 
 void rs2wrapper::initialize(const bool &enable_ir_emitter)
@@ -55,7 +75,7 @@ void rs2wrapper::initialize(const std::string &device_sn,
     std::shared_ptr<device> dev = std::make_shared<device>();
     dev->sn = device_sn;
     enabled_devices[device_sn] = dev;
-    fps_counter[device_sn] = std::vector<int64_t>(args.fps(), 0);
+    fps_counter[device_sn] = std::vector<int64_t>(config.device(device_sn).fps(), 0);
 
     // 1. pipeline
     rs2::pipeline pipe = initialize_pipeline();
@@ -66,22 +86,79 @@ void rs2wrapper::initialize(const std::string &device_sn,
     configure_depth_stream_config(device_sn);
     configure_stream(device_sn);
 
+    // 2.b. sensor options (AE, AE limit, IR), set before the pipeline starts.
+    configure_color_sensor(device_sn);
+    configure_depth_sensor(device_sn);
+    configure_ir_emitter(device_sn);
+    apply_sensor_options(device_sn);
+
     // 3. pipeline start
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
     start(device_sn);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (!wait_for_sensor(device_sn, config.ready_timeout_ms()))
+        print(device_sn + " depth sensor options not readable yet...", 1);
+    ready_wait(device_sn, "start", 100.0, t0);
     if (verbose)
-        print("pipeline started with 100ms sleep...", 0);
+        print("pipeline started...", 0);
 
-    // 4. sensors
+    // 4. sensors, the options are verified + re-applied live if needed.
     configure_color_depth_sensor(device_sn);
 
-    // 5. IR
-    configure_ir_emitter(device_sn);
-
     // 6. align instances recreate
     align_to_color = rs2::align(RS2_STREAM_COLOR);
     align_to_depth = rs2::align(RS2_STREAM_DEPTH);
 
+    // 6.b. motion gate
+    if (args.motion_gate() != "none")
+    {
+        motion_gates[device_sn] = std::make_shared<motiongate>(
+            args.motion_on_threshold(),
+            args.motion_off_threshold(),
+            args.motion_depth_delta(),
+            args.motion_color_delta(),
+            args.motion_downsample(),
+            args.motion_pre_roll(),
+            args.motion_post_roll(),
+            args.motion_idle_fps());
+        if (verbose)
+            print("motion gated recording using " + args.motion_gate() + "...", 0);
+    }
+
+    // 6.c. ring buffer for the frames that are not saved (yet).
+    // The total budget is split across all devices of the process.
+    int64_t num_devices = config.network()
+                              ? 1
+                              : std::max<int64_t>(1, deviceregistry::instance().devices().size());
+    int64_t ring_max_bytes = std::min<int64_t>(args.ring_max_mb(),
+                                               args.ring_total_mb() / num_devices) *
+                             1024 * 1024;
+    if (args.record_mode() == "trigger")
+    {
+        rings[device_sn] = std::make_shared<framesetring>(
+            -1,
+            (int64_t)(args.trigger_pre_sec() * 1e9),
+            ring_max_bytes);
+        trigger_generations[device_sn] = eventtrigger::instance().generation(device_sn);
+        trigger_record_until[device_sn] = -1;
+        if (verbose)
+            print("trigger recording with " +
+                      std::to_string(args.trigger_pre_sec()) + "s pre-trigger...",
+                  0);
+    }
+    else if (motion_gates.find(device_sn) != motion_gates.end())
+    {
+        rings[device_sn] = std::make_shared<framesetring>(
+            motion_gates[device_sn]->pre_roll(),
+            -1,
+            ring_max_bytes);
+    }
+
+    // 6.d. depth filters
+    initialize_depth_filter(device_sn);
+
+    // 6.e. point cloud
+    initialize_pointcloud(device_sn);
+
     // 7. infos
     print_rs2_device_infos(dev->pipeline_profile->get_device(), args.verbose());
     print_camera_temperature(*enabled_devices[device_sn],
@@ -95,61 +172,6 @@ void rs2wrapper::initialize(const std::string &device_sn,
     print("Initialized RealSense devices " + std::string(device_sn) + "\n", 0);
 }
 
-void rs2wrapper::initialize_depth_sensor_ae()
-{
-    for (auto const &available_device : available_devices)
-        initialize_depth_sensor_ae(available_device[0]);
-}
-
-void rs2wrapper::initialize_depth_sensor_ae(const std::string &device_sn)
-{
-    print("Initializing RealSense depth sensor AE " + std::string(device_sn), 0);
-
-    // 0. enabled devices
-    std::shared_ptr<device> dev = std::make_shared<device>();
-    dev->sn = device_sn;
-    enabled_devices[device_sn] = dev;
-
-    // 1. pipeline
-    rs2::pipeline pipe = initialize_pipeline();
-    dev->pipeline = std::make_shared<rs2::pipeline>(pipe);
-
-    // 2. configure
-    configure_color_stream_config(device_sn);
-    configure_depth_stream_config(device_sn);
-    // HACK: sensor AE configuration seems to only work for fps = 6
-    stream_config_colors[device_sn].framerate = 6;
-    stream_config_depths[device_sn].framerate = 6;
-    configure_stream(device_sn);
-
-    // 3. pipeline start
-    start(device_sn);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    if (verbose)
-        print("pipeline started with 100ms sleep...", 0);
-
-    // 4. sensors
-    std::vector<rs2::sensor> sensors =
-        dev->pipeline_profile->get_device().query_sensors();
-    for (auto &&sensor : sensors)
-    {
-        if (auto dss = sensor.as<rs2::depth_stereo_sensor>())
-        {
-            // int limit = 8500; // default
-            int limit = args.depth_sensor_autoexposure_limit();
-            dss.set_option(RS2_OPTION_ENABLE_AUTO_EXPOSURE, 1.0f);
-            dss.set_option(RS2_OPTION_AUTO_EXPOSURE_LIMIT_TOGGLE, 1.0f);
-            dss.set_option(RS2_OPTION_AUTO_EXPOSURE_LIMIT, float(limit));
-            print("depth sensor auto exposure limit : " + std::to_string(limit), 0);
-        }
-    }
-
-    // 5. pipeline stop
-    stop(device_sn);
-
-    print("Initialized RealSense depth sensor AE " + std::string(device_sn) + "\n", 0);
-}
-
 void rs2wrapper::start()
 {
     if (enabled_devices.size() > 0)
@@ -171,6 +193,7 @@ void rs2wrapper::start(const std::string &device_sn)
 
     dev->pipeline_profile = std::make_shared<rs2::pipeline_profile>(profile);
     dev->num_streams = dev->pipeline_profile->get_streams().size();
+    dev->partial_framesets = check_if_streams_differ_in_fps(profile);
     if (verbose)
         print(device_sn + " pipeline profile is saved...", 0);
 }
@@ -178,19 +201,41 @@ void rs2wrapper::start(const std::string &device_sn)
 void rs2wrapper::step()
 {
     step_clear();
+    update_storage();
+    process_hotplug();
+
+    // all devices dropped off the bus, waits for them.
+    if (enabled_devices.empty())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / std::max(1, config.fps())));
 
+    const std::string &reset_policy = config.reset_policy();
     while (valid_frame_received_flags.size() < enabled_devices.size())
     {
+        // a device that drops off now does not stall the step.
+        process_hotplug();
+        // a hardware reset detaches the device from 'enabled_devices'.
+        std::vector<std::string> device_sns;
         for (auto const &enabled_device : enabled_devices)
+            device_sns.push_back(enabled_device.first);
+        for (auto const &device_sn : device_sns)
         {
-            auto device_sn = enabled_device.first;
             step(device_sn);
-            reset_due_to_high_reset_counter(device_sn);
-            // In case a device is not sending anything at all.
-            // empty frame for 0.5 seconds.
-            reset_due_to_empty_frame_received(device_sn);
+            if (reset_policy == "health")
+            {
+                reset_due_to_health(device_sn);
+            }
+            else if (reset_policy == "interval")
+            {
+                reset_due_to_high_reset_counter(device_sn);
+                // In case a device is not sending anything at all.
+                // empty frame for 0.5 seconds.
+                reset_due_to_empty_frame_received(device_sn);
+            }
         }
     }
+
+    // A frameset of every device was processed.
+    fuse_pointclouds();
 }
 
 void rs2wrapper::step(const std::string &device_sn)
@@ -224,8 +269,10 @@ void rs2wrapper::step(const std::string &device_sn)
     // 3.b. Polled frames are not empty.
     else
     {
-        // 4. Make sure both color and depth frames are there.
-        if (frameset.size() == dev->num_streams)
+        // 4. Make sure both color and depth frames are there, the slower
+        // stream is missing in most framesets if they run at different fps.
+        if (frameset.size() == dev->num_streams ||
+            (dev->partial_framesets && frameset.size() > 0))
         {
             // Timestamp duration using the global start timestamp.
             // This will be used as the filenames of the sdaved data.
@@ -234,8 +281,9 @@ void rs2wrapper::step(const std::string &device_sn)
             // int64_t global_timestamp_diff = get_timestamp_ns();
 
             // 5.a. Check if both frames are valid, skip step if one is invalid.
-            if (!check_if_color_depth_frames_are_valid(frameset))
+            if (!check_if_color_depth_frames_are_valid(frameset, dev->partial_framesets))
             {
+                health->frame(device_sn, -1, false);
                 dev->color_reset_counter += 1;
                 dev->depth_reset_counter += 1;
                 output_msg = device_sn + " :: One of the streams is missing...";
@@ -246,6 +294,7 @@ void rs2wrapper::step(const std::string &device_sn)
                 // 6.a. Tries to align the frames, and skip step if exception occurs.
                 if (!align_frameset(device_sn, frameset, aligned_frameset, 1))
                 {
+                    health->frame(device_sn, -1, false);
                     dev->color_reset_counter += 1;
                     dev->depth_reset_counter += 1;
                     output_msg = device_sn + " :: Align failed...";
@@ -253,13 +302,41 @@ void rs2wrapper::step(const std::string &device_sn)
                 // 6.b. Framesets are aligned.
                 else
                 {
-                    // 7. Loops through the streams to get color and depth.
+                    // 7.a. Decides whether the frames are saved (motion gate / trigger).
+                    motiongate::decision decision = query_record_decision(
+                        device_sn,
+                        aligned_frameset,
+                        global_timestamp_diff);
+                    bool save = decision != motiongate::SKIP;
+                    bool buffered = rings.find(device_sn) != rings.end();
+
+                    // 7.b. Loops through the streams to get color and depth.
+                    // A stream without a new frame gets -1 as timestamp.
+                    bool has_color = (bool)frameset.first_or_default(RS2_STREAM_COLOR);
+                    bool has_depth = (bool)frameset.first_or_default(RS2_STREAM_DEPTH);
+                    // the fan-out shard is fixed now, also for a later write
+                    // from the ring.
+                    int64_t frame_idx = trial_frame_counters[device_sn]++;
                     int error_status = process_color_depth_stream(
                         device_sn,
                         aligned_frameset,
                         global_timestamp_diff,
+                        frame_idx,
                         current_color_timestamp,
-                        current_depth_timestamp);
+                        current_depth_timestamp,
+                        save && !buffered,
+                        has_color,
+                        has_depth);
+                    framegaps gaps = frame_gaps[device_sn];
+
+                    // The faster stream (color if equal) times the device.
+                    rs2_metadata_type reference_timestamp =
+                        stream_config_colors[device_sn].framerate >=
+                                stream_config_depths[device_sn].framerate
+                            ? current_color_timestamp
+                            : current_depth_timestamp;
+                    health->frame(device_sn, reference_timestamp, error_status == 0);
+                    health->dropped(device_sn, std::max(gaps.color_dropped, gaps.depth_dropped));
 
                     // 8.a. Something was wrong with color stream.
                     if (error_status == 1 || error_status == 3)
@@ -291,11 +368,58 @@ void rs2wrapper::step(const std::string &device_sn)
                     // Saves the timestamps and generate output message.
                     if (error_status == 0)
                     {
-                        std::string txt_file = storagepaths.timestamp[device_sn] + "/timestamp.txt";
-                        timestamp_to_txt(global_timestamp_diff,
-                                         current_color_timestamp,
-                                         current_depth_timestamp,
-                                         txt_file);
+                        int64_t corrected_timestamp =
+                            update_clock_model(device_sn,
+                                               reference_timestamp,
+                                               global_timestamp_diff);
+
+                        if (buffered)
+                        {
+                            frameset_record record;
+                            record.global_timestamp = global_timestamp_diff;
+                            record.color_timestamp = current_color_timestamp;
+                            record.depth_timestamp = current_depth_timestamp;
+                            record.corrected_timestamp = corrected_timestamp;
+                            record.gaps = gaps;
+                            record.frameset = aligned_frameset;
+                            record.frame_idx = frame_idx;
+                            record.save = save;
+                            buffer_frameset(device_sn,
+                                            record,
+                                            decision == motiongate::STORE_WITH_PRE_ROLL);
+                        }
+                        else
+                        {
+                            std::string txt_file = storagepaths.timestamp[device_sn] + "/timestamp.txt";
+                            timestamp_to_txt(global_timestamp_diff,
+                                             current_color_timestamp,
+                                             current_depth_timestamp,
+                                             txt_file,
+                                             true,
+                                             corrected_timestamp,
+                                             gaps);
+                        }
+                        metrics::instance().add(device_sn,
+                                                save ? "frames_stored" : "frames_skipped",
+                                                1);
+
+                        if (sync)
+                        {
+                            frameset_record record;
+                            record.global_timestamp = global_timestamp_diff;
+                            record.color_timestamp = current_color_timestamp;
+                            record.depth_timestamp = current_depth_timestamp;
+                            record.corrected_timestamp = corrected_timestamp;
+                            record.gaps = gaps;
+                            if (sync->needs_frames())
+                                record.frameset = aligned_frameset;
+                            record.frame_idx = frame_idx;
+                            record.save = save;
+                            sync->push(device_sn,
+                                       record,
+                                       query_sync_timestamp(corrected_timestamp,
+                                                            global_timestamp_diff));
+                        }
 
                         valid_frame_received_flags[device_sn] = true;
                         empty_frame_received_timers[device_sn] = 0;
@@ -335,6 +459,12 @@ void rs2wrapper::stop()
             stop(enabled_device.first);
     else
         print_no_device_enabled(__func__);
+
+    // the queued filtered depths + fused point clouds are written.
+    if (filter_writer)
+        filter_writer->stop();
+    if (fusion_writer)
+        fusion_writer->stop();
 }
 
 void rs2wrapper::stop(const std::string &device_sn)
@@ -342,6 +472,7 @@ void rs2wrapper::stop(const std::string &device_sn)
     if (!check_if_device_is_enabled(device_sn, __func__))
         return;
 
+    drain_ring(device_sn, get_timestamp_duration_ns(global_timestamp_start), true);
     enabled_devices[device_sn]->pipeline->stop();
     if (verbose)
         print(device_sn + " stopped...", 0);
@@ -382,11 +513,20 @@ void rs2wrapper::reset(const std::string &device_sn)
         return;
 
     stop(device_sn);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
     if (verbose)
-        print(device_sn + " pipeline stopped + paused with 500ms sleep...", 0);
-
-    start(device_sn);
+        print(device_sn + " pipeline stopped...", 0);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    bool ready = start_when_ready(device_sn, config.ready_timeout_ms());
+    if (!ready)
+        print(device_sn + " pipeline restart timed out...", 2);
+    else if (!(ready = wait_for_frameset(device_sn, config.ready_timeout_ms())))
+        print(device_sn + " no frameset after restart...", 1);
+    ready_wait(device_sn, "reset", 500.0, t0);
+
+    // warm-up, the AE may need a few frames after the restart.
+    if (ready)
+        flush_frames(device_sn, config.flush_steps());
     if (verbose)
         print(device_sn + " pipeline restarted...", 0);
 }
@@ -396,29 +536,29 @@ void rs2wrapper::reset_hardware(const std::string &device_sn)
     if (!check_if_device_is_enabled(device_sn, __func__))
         return;
 
-    std::lock_guard<std::mutex> lock(reset_mux);
-
-    stop(device_sn);
-    rs2::device dev = enabled_devices[device_sn]->pipeline_profile->get_device();
-
-    dev.hardware_reset();
-    if (verbose)
-        print(device_sn + " hardware reset...", 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-    std::string cmd = "~/realsense-simple-wrapper/scripts/pi4_client_bind.sh " + USBIP_MAPPING[device_sn];
-    system(cmd.c_str());
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // network devices are not enumerated by the context.
+    if (config.network())
+    {
+        print(device_sn + " hardware reset is not supported over network, restarting the pipeline...", 1);
+        reset(device_sn);
+        return;
+    }
 
-    rs2::pipeline pipe = initialize_pipeline();
-    enabled_devices[device_sn]->pipeline = std::make_shared<rs2::pipeline>(pipe);
-    if (verbose)
-        print(device_sn + " pipeline reinitialized...", 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (!resets)
+    {
+        resets = std::make_shared<resetservice>(ctx,
+                                                args.reset_concurrency(),
+                                                args.reset_timeout_ms(),
+                                                args.usbip_bind_command());
+        if (args.usbip_mapping() != "none")
+            resets->load_mapping(args.usbip_mapping());
+    }
+    resets->start();
 
-    start(device_sn);
-    if (verbose)
-        print(device_sn + " pipeline restarted with 300ms sleep...", 0);
+    rs2::device dev = enabled_devices[device_sn]->pipeline_profile->get_device();
+    detach_device(device_sn);
+    if (!resets->request(device_sn, dev))
+        print(device_sn + " hardware reset is already running...", 1);
 }
 
 void rs2wrapper::reset_reset_counter()
@@ -490,6 +630,55 @@ void rs2wrapper::reset_due_to_empty_frame_received(const std::string &device_sn)
     }
 }
 
+void rs2wrapper::reset_due_to_health()
+{
+    if (enabled_devices.size() > 0)
+        for (auto const &enabled_device : enabled_devices)
+            reset_due_to_health(enabled_device.first);
+    else
+        print_no_device_enabled(__func__);
+}
+
+void rs2wrapper::reset_due_to_health(const std::string &device_sn)
+{
+    if (!check_if_device_is_enabled(device_sn, __func__))
+        return;
+
+    // a new temperature sample of the telemetry.
+    telemetrysampler::sample sample;
+    if (telemetry->latest(device_sn, sample) &&
+        (telemetry_indices.count(device_sn) == 0 ||
+         telemetry_indices[device_sn] != sample.index))
+    {
+        telemetry_indices[device_sn] = sample.index;
+        health->temperature(device_sn,
+                            std::max(sample.asic_temperature,
+                                     sample.projector_temperature));
+    }
+
+    std::string reason;
+    resetscheduler::action action = health->decide(device_sn, reason);
+    if (action == resetscheduler::NONE)
+        return;
+
+    if (action == resetscheduler::RESTART)
+    {
+        print("Reset " + device_sn + " due to " + reason, 1);
+        reset(device_sn);
+        reset_reset_counter(device_sn);
+        empty_frame_received_timers[device_sn] = 0;
+        health->done(device_sn);
+    }
+    else
+    {
+        print("Hardware reset " + device_sn + " due to " + reason + ", restarting did not help", 1);
+        reset_hardware(device_sn);
+        // the device is back once it is attached again.
+        if (enabled_devices.count(device_sn) > 0)
+            health->done(device_sn);
+    }
+}
+
 void rs2wrapper::save_calib()
 {
     if (enabled_devices.size() > 0)
@@ -505,9 +694,7 @@ void rs2wrapper::save_calib(const std::string &device_sn)
         return;
 
     std::shared_ptr<device> dev = enabled_devices[device_sn];
-    std::string csv_file = storagepaths.calib[device_sn] + "/calib.csv";
-    std::ofstream csv;
-    csv.open(csv_file);
+    std::ostringstream csv;
 
     // Intrinsics of color & depth frames
     rs2::stream_profile profile_color =
@@ -536,8 +723,8 @@ void rs2wrapper::save_calib(const std::string &device_sn)
         << rs2_distortion_to_string(intr_color.model) << ",";
     for (auto const &value : intr_color.coeffs)
         csv << value << ",";
-    csv << args.color_format() << ","
-        << args.fps() << ",";
+    csv << stream_config_colors[device_sn].format << ","
+        << stream_config_colors[device_sn].framerate << ",";
     csv << "\n";
 
     csv << intr_depth.width << ","
@@ -549,8 +736,8 @@ void rs2wrapper::save_calib(const std::string &device_sn)
         << rs2_distortion_to_string(intr_depth.model) << ",";
     for (auto const &value : intr_depth.coeffs)
         csv << value << ",";
-    csv << args.depth_format() << ","
-        << args.fps() << ",";
+    csv << stream_config_depths[device_sn].format << ","
+        << stream_config_depths[device_sn].framerate << ",";
     csv << "\n";
 
     for (auto const &value : extr.rotation)
@@ -570,6 +757,27 @@ void rs2wrapper::save_calib(const std::string &device_sn)
         }
     }
 
+    // Size of the saved filtered depth, decimated by the depth filters, and
+    // whether the saved depth is aligned to color (1) or uses the depth
+    // intrinsics (0).
+    rs2_intrinsics intr_saved = query_saved_depth_intrinsics(device_sn);
+    int decimation = 1;
+    auto filter = depth_filters.find(device_sn);
+    if (filter != depth_filters.end())
+        decimation = filter->second->get_decimation();
+    csv << intr_saved.width / decimation << ","
+        << intr_saved.height / decimation << ","
+        << (config.device(device_sn).depth_aligned() ? 1 : 0) << ",\n";
+
+    std::string csv_file = storagepaths.calib[device_sn] + "/calib.csv";
+    std::ofstream csv_out(csv_file);
+    csv_out << csv.str();
+    csv_out.close();
+
+    // Later windows get the same calibration data written by the rotator.
+    if (rotator)
+        rotator->set_calib(device_sn, csv.str());
+
     print(device_sn + " Saved camera calibration data...", 0);
 }
 
@@ -595,25 +803,85 @@ void rs2wrapper::flush_frames(const int &num_frames)
 {
     int _num_frames = 0;
     if (num_frames == -1)
-        _num_frames = args.flush_steps();
+        _num_frames = config.flush_steps();
     else
         _num_frames = num_frames;
 
-    for (auto i = 0; i < _num_frames; ++i)
-        flush_frame();
+    if (enabled_devices.size() > 0)
+        for (auto const &enabled_device : enabled_devices)
+            flush_frames(enabled_device.first, _num_frames);
+    else
+        print_no_device_enabled(__func__);
+}
+
+int rs2wrapper::flush_frames(const std::string &device_sn, const int &num_frames)
+{
+    if (!check_if_device_is_enabled(device_sn, __func__))
+        return 0;
+
+    return flush_frames(enabled_devices[device_sn], num_frames);
+}
+
+int rs2wrapper::flush_frames(std::shared_ptr<device> dev, const int &num_frames)
+{
+    const std::string &device_sn = dev->sn;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    // Stops once exposure, gain and brightness of the color frames hold,
+    // the wait is capped. Without the AE convergence a fixed number.
+    int max_wait_ms = config.ae_max_wait_ms();
+    std::chrono::steady_clock::time_point deadline =
+        t0 + std::chrono::milliseconds(max_wait_ms);
+    aeconvergence ae(config.ae_tolerance(), config.ae_stable_frames());
+    int flushed = 0;
+    while (max_wait_ms > 0
+               ? !ae.converged() && std::chrono::steady_clock::now() < deadline
+               : flushed < num_frames)
+    {
+        rs2::frameset frameset = dev->pipeline->wait_for_frames();
+        // AE only needs the color frames, depth may be missing if the
+        // streams run at different fps. Only color frames count.
+        if (!check_if_color_depth_frames_are_valid(frameset, dev->partial_framesets) ||
+            !frameset.first_or_default(RS2_STREAM_COLOR))
+            continue;
+        flushed++;
+        dev->last_color = frameset.first_or_default(RS2_STREAM_COLOR);
+        rs2::video_frame color_frame = dev->last_color.as<rs2::video_frame>();
+        float brightness = -1.0f;
+        if (color_frame.get_bytes_per_pixel() == 1 ||
+            color_frame.get_bytes_per_pixel() == 2 ||
+            color_frame.get_bytes_per_pixel() == 3)
+            brightness = aeconvergence::mean_brightness(
+                (const uint8_t *)color_frame.get_data(),
+                color_frame.get_width() * color_frame.get_bytes_per_pixel(),
+                color_frame.get_height(),
+                color_frame.get_stride_in_bytes());
+        ae.update(query_frame_metadata(color_frame, RS2_FRAME_METADATA_ACTUAL_EXPOSURE),
+                  query_frame_metadata(color_frame, RS2_FRAME_METADATA_GAIN_LEVEL),
+                  brightness);
+    }
 
+    ready_wait(device_sn, "flush", num_frames * 1000.0 / config.device(device_sn).fps(), t0);
+    metrics &m = metrics::instance();
+    m.set(device_sn, "flush_frames", flushed);
+    m.set(device_sn, "ae_converged", ae.converged() ? 1 : 0);
     if (verbose)
-        print("Flushed " + std::to_string(_num_frames) + " initial frames...\n", 0);
+        print(device_sn + " Flushed " + std::to_string(flushed) + " frames" +
+                  (ae.converged() ? ", AE converged...\n" : ", AE not converged...\n"),
+              0);
+    return flushed;
 }
 
 void rs2wrapper::reset_global_timestamp()
 {
     this->global_timestamp_start = std::chrono::steady_clock::now();
+    this->telemetry->set_reference(this->global_timestamp_start);
 }
 
 void rs2wrapper::reset_global_timestamp(std::chrono::steady_clock::time_point global_timestamp)
 {
     this->global_timestamp_start = global_timestamp;
+    this->telemetry->set_reference(this->global_timestamp_start);
 }
 
 void rs2wrapper::prepare_storage()
@@ -624,7 +892,15 @@ void rs2wrapper::prepare_storage()
     {
         device_names.push_back(available_device[0]);
     }
-    sp.create(device_names, args.save_path());
+    for (auto const &device_name : device_names)
+        if (config.saves_filtered_depth(device_name))
+            sp.filtered_devices.insert(device_name);
+    time_t trial_idx;
+    time(&trial_idx);
+    sp.create(device_names, config.save_path(), trial_idx, config.save_paths());
+    if (args.fusion_extrinsics() != "none")
+        sp.create_fusion(config.save_path());
+    sp.set_fanout(args.storage_fanout());
     storagepaths = sp;
     // std::this_thread::sleep_for(std::chrono::milliseconds(100));
 }
@@ -643,6 +919,59 @@ storagepath rs2wrapper::get_storagepaths()
     return this->storagepaths;
 }
 
+void rs2wrapper::set_workerpool(std::shared_ptr<workerpool> pool)
+{
+    this->pool = pool;
+}
+
+void rs2wrapper::set_framesync(std::shared_ptr<framesync> sync)
+{
+    this->sync = sync;
+}
+
+void rs2wrapper::set_resetservice(std::shared_ptr<resetservice> resets)
+{
+    this->resets = resets;
+}
+
+void rs2wrapper::set_resetscheduler(std::shared_ptr<resetscheduler> health)
+{
+    this->health = health;
+}
+
+void rs2wrapper::set_telemetrysampler(std::shared_ptr<telemetrysampler> telemetry)
+{
+    this->telemetry = telemetry;
+    this->telemetry->set_reference(global_timestamp_start);
+}
+
+std::shared_ptr<resetscheduler> rs2wrapper::create_resetscheduler(
+    rs2args &args,
+    const std::vector<std::string> &device_sns)
+{
+    resetscheduler::limits l;
+    l.window_ns = (int64_t)args.health_window_ms() * 1000000;
+    l.grace_ns = (int64_t)args.health_grace_ms() * 1000000;
+    l.escalate_ns = (int64_t)args.health_escalate_ms() * 1000000;
+    l.max_empty_ns = (int64_t)args.health_max_empty_ms() * 1000000;
+    l.frozen_frames = args.health_frozen_frames();
+    l.max_drop_rate = args.health_max_drop_rate();
+    l.max_error_rate = args.health_max_error_rate();
+    l.max_temperature = args.health_max_temperature();
+    return std::make_shared<resetscheduler>(
+        l,
+        resetscheduler::parse_groups(args.reset_groups(),
+                                     device_sns,
+                                     args.sync() != "none"));
+}
+
+void rs2wrapper::set_storagerotator(std::shared_ptr<storagerotator> rotator)
+{
+    this->rotator = rotator;
+    this->storage_generation = -1;
+    update_storage();
+}
+
 std::string rs2wrapper::get_output_msg()
 {
     std::string output_msg;
@@ -667,6 +996,11 @@ rs2args rs2wrapper::get_args()
     return this->args;
 }
 
+const rs2config &rs2wrapper::get_config()
+{
+    return this->config;
+}
+
 bool rs2wrapper::check_if_device_is_enabled(const std::string &device_sn,
                                             const std::string &function_name)
 {
@@ -683,20 +1017,22 @@ bool rs2wrapper::check_if_device_is_enabled(const std::string &device_sn,
  * rs2wrapper PRIVATAE FUNCTIONS
  ******************************************************************************/
 void rs2wrapper::constructor(rs2args args,
+                             const rs2config &config,
                              const bool &verbose,
                              rs2::context context,
                              std::string device_sn)
 {
     // CLI args
     this->args = args;
+    this->config = config;
 
     // reset after 0.5s
     max_reset_counter =
-        std::round((float)this->args.fps() *
+        std::round((float)this->config.fps() *
                    ((float)this->args.max_reset_counter()) / 1000);
     // every 1 minutes
     camera_temp_printout_interval =
-        this->args.fps() * this->args.camera_temperature_printout_interval();
+        this->config.fps() * this->args.camera_temperature_printout_interval();
 
     // whether to printout stuffs
     this->verbose = verbose;
@@ -708,6 +1044,8 @@ void rs2wrapper::constructor(rs2args args,
     // context grabs the usb resources of the cameras.
     this->ctx = std::make_shared<rs2::context>(context);
     this->query_available_devices();
+    if (!this->config.network() && this->config.hotplug())
+        hotplugmonitor::instance().attach(this->ctx);
 
     // Sort the devices.
     std::sort(this->available_devices.begin(),
@@ -717,6 +1055,18 @@ void rs2wrapper::constructor(rs2args args,
               {
                   return a[0] < b[0];
               });
+
+    // Resets of the devices of this wrapper, replaced by a shared one in
+    // the multithreading mode.
+    std::vector<std::string> device_sns;
+    for (auto const &available_device : this->available_devices)
+        device_sns.push_back(available_device[0]);
+    this->health = create_resetscheduler(this->args, device_sns);
+
+    // Started with the first device.
+    this->telemetry = std::make_shared<telemetrysampler>(
+        this->args.telemetry_interval_ms(),
+        this->args.verbose() ? this->args.camera_temperature_printout_interval() * 1000 : 0);
 }
 
 void rs2wrapper::query_available_devices()
@@ -735,7 +1085,7 @@ void rs2wrapper::query_available_devices()
 
     print("Querying available devices", 0);
 
-    if (args.network())
+    if (config.network())
     {
         print("NETWORK mode", 0);
         rs2::net_device dev(args.ip());
@@ -751,19 +1101,20 @@ void rs2wrapper::query_available_devices()
     {
         print("LOCAL mode", 0);
 
+        // enumerated once for all wrappers.
+        deviceregistry &registry = deviceregistry::instance();
+        registry.enumerate(*ctx);
+
         if (single_device_sn == "-1")
         {
-            for (auto &&dev : ctx->query_devices())
-            {
-                auto serial = dev.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER);
-                auto product_line = dev.get_info(RS2_CAMERA_INFO_PRODUCT_LINE);
-                add_device(serial, product_line, available_devices, verbose);
-            }
+            for (auto const &dev : registry.devices())
+                add_device(dev[0], dev[1], available_devices, verbose);
         }
         else
         {
             auto serial = single_device_sn;
-            auto product_line = "D400";
+            deviceregistry::entry e;
+            std::string product_line = registry.find(serial, e) ? e.product_line : "D400";
             add_device(serial, product_line, available_devices, verbose);
         }
     }
@@ -771,123 +1122,562 @@ void rs2wrapper::query_available_devices()
     print(" ", 0);
 }
 
-rs2::pipeline rs2wrapper::initialize_pipeline()
+void rs2wrapper::update_storage()
 {
-    if (args.network())
-    {
-        rs2::pipeline pipe(*ctx);
-        return pipe;
-    }
-    else
-    {
-        rs2::pipeline pipe;
-        return pipe;
-    }
-}
+    if (!rotator)
+        return;
 
-void rs2wrapper::configure_color_stream_config(const std::string &device_sn)
-{
-    stream_config_colors[device_sn].stream_type = RS2_STREAM_COLOR;
-    stream_config_colors[device_sn].width = args.width();
-    stream_config_colors[device_sn].height = args.height();
-    stream_config_colors[device_sn].format = args.color_format();
-    stream_config_colors[device_sn].framerate = args.fps();
-}
+    // Only an integer compare per step, the paths are copied once per window.
+    int generation = rotator->generation();
+    if (generation == storage_generation)
+        return;
 
-void rs2wrapper::configure_depth_stream_config(const std::string &device_sn)
-{
-    stream_config_depths[device_sn].stream_type = RS2_STREAM_DEPTH;
-    stream_config_depths[device_sn].width = args.width();
-    stream_config_depths[device_sn].height = args.height();
-    stream_config_depths[device_sn].format = args.depth_format();
-    stream_config_depths[device_sn].framerate = args.fps();
+    std::shared_ptr<const storagepath> sp = rotator->current();
+    if (!sp)
+        return;
+    storagepaths = *sp;
+    storagepaths.set_fanout(args.storage_fanout());
+    storage_generation = generation;
+    // the shards of a trial start at 0.
+    trial_frame_counters.clear();
+    fusion_ticks = 0;
+
+    for (auto const &enabled_device : enabled_devices)
+        if (storagepaths.telemetry.count(enabled_device.first) > 0)
+            telemetry->set_log(enabled_device.first,
+                               storagepaths.telemetry[enabled_device.first] + "/telemetry.txt");
 }
 
-void rs2wrapper::configure_stream(const std::string &device_sn)
+void rs2wrapper::initialize_depth_filter(const std::string &device_sn)
 {
-    if (stream_config_colors.find(device_sn) == stream_config_colors.end())
-        throw std::invalid_argument("color config not found for " + device_sn);
+    const std::string &depth_filters_spec = config.device(device_sn).depth_filters;
+    if (depth_filters_spec == "none")
+        return;
 
-    if (stream_config_depths.find(device_sn) == stream_config_depths.end())
-        throw std::invalid_argument("depth config not found for " + device_sn);
+    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    rs2_intrinsics intr_saved = query_saved_depth_intrinsics(device_sn);
 
-    rs2::config cfg;
-    cfg.enable_stream(stream_config_colors[device_sn].stream_type,
-                      stream_config_colors[device_sn].width,
-                      stream_config_colors[device_sn].height,
-                      stream_config_colors[device_sn].format,
-                      stream_config_colors[device_sn].framerate);
-    cfg.enable_stream(stream_config_depths[device_sn].stream_type,
-                      stream_config_depths[device_sn].width,
-                      stream_config_depths[device_sn].height,
-                      stream_config_depths[device_sn].format,
-                      stream_config_depths[device_sn].framerate);
+    float depth_unit = 0.001f;
+    float baseline = 0.05f;
+    for (auto &&sensor : dev->pipeline_profile->get_device().query_sensors())
+    {
+        if (auto dss = sensor.as<rs2::depth_stereo_sensor>())
+        {
+            depth_unit = dss.get_depth_scale();
+            baseline = dss.get_stereo_baseline() * 0.001f;
+        }
+    }
 
-    if (!args.network())
-        cfg.enable_device(std::string(device_sn));
+    if (!pool)
+        pool = std::make_shared<workerpool>(args.filter_threads());
 
-    if (verbose)
-        if (cfg.can_resolve(*enabled_devices[device_sn]->pipeline))
-            print("'cfg' usable with 'pipeline' : True", 0);
-        else
-            print("'cfg' usable with 'pipeline' : False", 2);
+    std::shared_ptr<depthfilter> filter = std::make_shared<depthfilter>(
+        depth_unit, baseline, intr_saved.fx, pool.get());
+    filter->configure(depth_filters_spec);
+    if (!filter->enabled())
+        return;
 
-    rs_cfg[device_sn] = cfg;
+    // about one second of frames of a device, later ones are dropped.
+    if (!filter_writer)
+        filter_writer = std::make_shared<asyncwriter>(std::max(4, config.device(device_sn).fps()));
+    // the writer reads the filter maps, they only change while it is stopped.
+    filter_writer->stop();
+    depth_filters[device_sn] = filter;
+    filtered_depths[device_sn] = std::vector<uint16_t>();
+    filter_writer->start();
+    if (verbose)
+        print(device_sn + " depth filters : " + depth_filters_spec +
+                  ", output : " + args.depth_output(),
+              0);
 }
 
-void rs2wrapper::configure_color_sensor(const std::string &device_sn)
+void rs2wrapper::initialize_pointcloud(const std::string &device_sn)
 {
-    if (!check_if_device_is_enabled(device_sn, __func__))
+    if (args.pointcloud() == "none" && args.fusion_extrinsics() == "none")
         return;
 
-    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    if (!pool)
+        pool = std::make_shared<workerpool>(args.filter_threads());
 
-    if (args.autoexposure())
+    std::shared_ptr<pointcloud> pc = std::make_shared<pointcloud>(pool.get());
+    pc->set_intrinsics(query_saved_depth_intrinsics(device_sn));
+    pointclouds[device_sn] = pc;
+    if (verbose)
+        print(device_sn + " point cloud : " + args.pointcloud(), 0);
+
+    if (args.voxel_size() > 0.0f)
     {
-        dev->color_sensor->set_option(RS2_OPTION_ENABLE_AUTO_EXPOSURE, 1.0f);
-        dev->color_sensor->set_option(RS2_OPTION_AUTO_EXPOSURE_PRIORITY, 0.0f);
-        // https://github.com/IntelRealSense/librealsense/issues/4015
-        // Set the Auto Exposure (AE) Region of Interest (ROI). Should be done after
-        // starting the pipe, will give an error otherwise
-        // Create the ROI for auto exposure (set these values to whatever you need)
-        // rs2::region_of_interest roi;
-        // roi.min_x = 124;
-        // roi.min_y = 350;
-        // roi.max_x = 724;
-        // roi.max_y = 450;
-        // rs2::roi_sensor roi_sensor = css.as<rs2::roi_sensor>();
-        // std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        // roi_sensor.set_region_of_interest(roi);
-        // if (verbose)
-        //     print("color sensor roi :\t" +
-        //               std::to_string(roi.min_x) + "\t" +
-        //               std::to_string(roi.min_y) + "\t" +
-        //               std::to_string(roi.max_x) + "\t" +
-        //               std::to_string(roi.max_y),
-        //           0);
+        voxelgrids[device_sn] = std::make_shared<voxelgrid>(
+            args.voxel_size(),
+            voxelgrid::reduction_from_string(args.voxel_reduction()),
+            pool.get());
+        if (verbose)
+            print(device_sn + " voxel grid : " + std::to_string(args.voxel_size()) +
+                      "m, " + args.voxel_reduction(),
+                  0);
     }
-    else
+
+    if (args.fusion_extrinsics() == "none")
+        return;
+    if (!fusion)
     {
-        dev->color_sensor->set_option(RS2_OPTION_ENABLE_AUTO_EXPOSURE, 0.0f);
-        dev->color_sensor->set_option(RS2_OPTION_EXPOSURE, 100.0);
+        fusion = std::make_shared<cloudfusion>(args.fusion_voxel_size(), pool.get());
+        fusion_writer = std::make_shared<asyncwriter>();
+        fusion_writer->start();
+        int num_cameras = fusion->load_extrinsics(args.fusion_extrinsics());
         if (verbose)
-            print("no AE for color sensor...", 0);
+            print("fusion of " + std::to_string(num_cameras) + " cameras from " +
+                      args.fusion_extrinsics(),
+                  0);
     }
+    if (!fusion->has_extrinsics(device_sn))
+        print(device_sn + " has no extrinsics, it is not fused", 1);
 }
 
-void rs2wrapper::configure_depth_sensor(const std::string &device_sn)
+void rs2wrapper::process_hotplug()
 {
-    if (!check_if_device_is_enabled(device_sn, __func__))
-        return;
-
-    std::shared_ptr<device> dev = enabled_devices[device_sn];
-
-    if (args.autoexposure())
+    process_resets();
+    if (!config.network() && config.hotplug())
     {
-        dev->depth_sensor->set_option(RS2_OPTION_ENABLE_AUTO_EXPOSURE, 1.0f);
-        auto limit = dev->depth_sensor->get_option(RS2_OPTION_AUTO_EXPOSURE_LIMIT);
-        if (verbose)
-            print("depth sensor auto exposure limit : " + std::to_string(limit), 0);
+        hotplugmonitor &monitor = hotplugmonitor::instance();
+
+        // 1. devices that dropped off the bus, also the ones that are
+        // already back.
+        std::vector<std::string> removed_sns;
+        std::set<std::string> reattached_sns;
+        for (auto const &enabled_device : enabled_devices)
+        {
+            hotplugmonitor::event e = monitor.poll(enabled_device.first);
+            if (e == hotplugmonitor::REMOVED || e == hotplugmonitor::REATTACHED)
+                removed_sns.push_back(enabled_device.first);
+            if (e == hotplugmonitor::REATTACHED)
+                reattached_sns.insert(enabled_device.first);
+        }
+        for (auto const &device_sn : removed_sns)
+            detach_device(device_sn);
+
+        // 2. devices that are back are restarted in the background.
+        for (auto const &detached_device : detached_devices)
+        {
+            const std::string &device_sn = detached_device.first;
+            hotplugmonitor::event e = monitor.poll(device_sn);
+            bool added = e == hotplugmonitor::ADDED ||
+                         e == hotplugmonitor::REATTACHED ||
+                         reattached_sns.count(device_sn) > 0;
+            // a device in its hardware reset comes back through 'process_resets'.
+            if (added &&
+                !(resets && resets->busy(device_sn)) &&
+                reattach_futures.find(device_sn) == reattach_futures.end())
+            {
+                start_reattach(device_sn, 0);
+            }
+        }
+    }
+    attach_restarted_devices();
+}
+
+void rs2wrapper::process_resets()
+{
+    if (!resets)
+        return;
+
+    for (auto const &detached_device : detached_devices)
+    {
+        const std::string &device_sn = detached_device.first;
+        resetservice::state state = resets->take(device_sn);
+        if (state == resetservice::DONE &&
+            reattach_futures.find(device_sn) == reattach_futures.end())
+        {
+            start_reattach(device_sn, 0);
+        }
+        else if (state == resetservice::FAILED)
+        {
+            // a hot-plug event can still bring it back.
+            print(device_sn + " stays unavailable after its hardware reset...", 2);
+            health->done(device_sn);
+        }
+    }
+}
+
+void rs2wrapper::attach_restarted_devices()
+{
+    // restarted devices are swapped in.
+    for (auto itr = reattach_futures.begin(); itr != reattach_futures.end();)
+    {
+        if (itr->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++itr;
+            continue;
+        }
+        std::string device_sn = itr->first;
+        try
+        {
+            attach_device(device_sn, itr->second.get());
+            reattach_retries.erase(device_sn);
+        }
+        catch (const std::exception &e)
+        {
+            // the 'added' event or the reset that started it is gone, the
+            // restart is retried here.
+            int attempt = reattach_retries[device_sn].first + 1;
+            print(device_sn + " restart failed (" + std::to_string(attempt) + "/" +
+                      std::to_string(reattach_attempts) + ") : " + e.what(),
+                  2);
+            metrics::instance().add(device_sn, "reattach_failed", 1);
+            if (attempt < reattach_attempts)
+            {
+                reattach_retries[device_sn] = std::make_pair(
+                    attempt,
+                    std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(reattach_backoff_ms << (attempt - 1)));
+            }
+            else
+            {
+                // the scheduler does not hold back the other devices of its
+                // group, a hot-plug event can still bring it back.
+                print(device_sn + " stays unavailable...", 2);
+                reattach_retries.erase(device_sn);
+                health->done(device_sn);
+            }
+        }
+        itr = reattach_futures.erase(itr);
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (auto const &retry : reattach_retries)
+        if (now >= retry.second.second &&
+            detached_devices.count(retry.first) > 0 &&
+            reattach_futures.find(retry.first) == reattach_futures.end())
+            start_reattach(retry.first, retry.second.first);
+}
+
+void rs2wrapper::start_reattach(const std::string &device_sn, const int &attempt)
+{
+    // a new event starts over.
+    if (attempt == 0)
+        reattach_retries.erase(device_sn);
+    else
+        reattach_retries[device_sn].second = std::chrono::steady_clock::time_point::max();
+    reattach_futures[device_sn] = std::async(std::launch::async,
+                                             &rs2wrapper::reattach_device,
+                                             this,
+                                             device_sn,
+                                             rs_cfg[device_sn],
+                                             sensor_options[device_sn],
+                                             config.ready_timeout_ms(),
+                                             config.flush_steps());
+}
+
+void rs2wrapper::detach_device(const std::string &device_sn)
+{
+    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    drain_ring(device_sn, get_timestamp_duration_ns(global_timestamp_start), true);
+    try
+    {
+        dev->pipeline->stop();
+    }
+    catch (const rs2::error &)
+    {
+        // the device is already gone.
+    }
+    telemetry->remove(device_sn);
+    detached_devices[device_sn] = dev;
+    detached_timestamps[device_sn] = std::chrono::steady_clock::now();
+    enabled_devices.erase(device_sn);
+    metrics::instance().add(device_sn, "detached", 1);
+    print(device_sn + " detached, the other devices keep streaming...", 1);
+}
+
+void rs2wrapper::attach_device(const std::string &device_sn, std::shared_ptr<device> dev)
+{
+    enabled_devices[device_sn] = dev;
+    detached_devices.erase(device_sn);
+    configure_color_depth_sensor(device_sn);
+    health->done(device_sn);
+
+    double downtime_ms = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() -
+                             detached_timestamps[device_sn])
+                             .count();
+    detached_timestamps.erase(device_sn);
+    metrics &m = metrics::instance();
+    m.set(device_sn, "downtime_ms", downtime_ms);
+    m.add(device_sn, "downtime_total_ms", downtime_ms);
+    print(device_sn + " attached again after " + std::to_string((int)downtime_ms) + "ms...", 0);
+}
+
+std::shared_ptr<device> rs2wrapper::reattach_device(const std::string &device_sn,
+                                                    rs2::config cfg,
+                                                    sensoroptions options,
+                                                    const int &timeout_ms,
+                                                    const int &flush_steps)
+{
+    // the cached handle of the device is stale.
+    deviceregistry &registry = deviceregistry::instance();
+    registry.refresh(*ctx);
+    deviceregistry::entry e;
+    if (registry.find(device_sn, e))
+        options.apply(e.device, device_sn);
+
+    std::shared_ptr<device> dev = std::make_shared<device>();
+    dev->sn = device_sn;
+    dev->pipeline = std::make_shared<rs2::pipeline>(*ctx);
+
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true)
+    {
+        try
+        {
+            rs2::pipeline_profile profile = dev->pipeline->start(cfg);
+            dev->pipeline_profile = std::make_shared<rs2::pipeline_profile>(profile);
+            dev->num_streams = dev->pipeline_profile->get_streams().size();
+            dev->partial_framesets = check_if_streams_differ_in_fps(profile);
+            break;
+        }
+        catch (const rs2::error &)
+        {
+            // the device may still be busy enumerating.
+            if (std::chrono::steady_clock::now() >= deadline)
+                throw;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // warm-up, the AE starts over after the reset. Done here so the capture
+    // thread gets a device with a settled exposure.
+    flush_frames(dev, flush_steps);
+    return dev;
+}
+
+bool rs2wrapper::wait_for_sensor(const std::string &device_sn, const int &timeout_ms)
+{
+    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true)
+    {
+        try
+        {
+            bool has_depth_sensor = false;
+            for (auto &&sensor : dev->pipeline_profile->get_device().query_sensors())
+            {
+                if (auto dss = sensor.as<rs2::depth_stereo_sensor>())
+                {
+                    has_depth_sensor = true;
+                    if (dss.supports(RS2_OPTION_ENABLE_AUTO_EXPOSURE))
+                    {
+                        dss.get_option(RS2_OPTION_ENABLE_AUTO_EXPOSURE);
+                        return true;
+                    }
+                }
+            }
+            if (!has_depth_sensor)
+                return true;
+        }
+        catch (const rs2::error &)
+        {
+            // not ready yet.
+        }
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+bool rs2wrapper::wait_for_frameset(const std::string &device_sn, const int &timeout_ms)
+{
+    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    rs2::frameset frameset;
+    while (true)
+    {
+        int64_t remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   deadline - std::chrono::steady_clock::now())
+                                   .count();
+        if (remaining_ms <= 0)
+            return false;
+        try
+        {
+            if (dev->pipeline->try_wait_for_frames(&frameset, (unsigned int)remaining_ms) &&
+                check_if_color_depth_frames_are_valid(frameset))
+                return true;
+        }
+        catch (const rs2::error &e)
+        {
+            print(device_sn + " :: " + e.what(), 2);
+            return false;
+        }
+    }
+}
+
+bool rs2wrapper::start_when_ready(const std::string &device_sn, const int &timeout_ms)
+{
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true)
+    {
+        try
+        {
+            start(device_sn);
+            return true;
+        }
+        catch (const rs2::error &e)
+        {
+            // the device is still busy with the previous pipeline.
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                print(device_sn + " :: " + e.what(), 2);
+                return false;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void rs2wrapper::ready_wait(const std::string &device_sn,
+                            const std::string &name,
+                            const double &fixed_ms,
+                            const std::chrono::steady_clock::time_point &t0)
+{
+    double waited_ms = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - t0)
+                           .count();
+    metrics &m = metrics::instance();
+    m.set(device_sn, name + "_ready_ms", waited_ms);
+    m.add(device_sn, "ready_saved_ms", fixed_ms - waited_ms);
+}
+
+rs2::pipeline rs2wrapper::initialize_pipeline()
+{
+    // the shared context, an implicit one would enumerate the devices again.
+    rs2::pipeline pipe(*ctx);
+    return pipe;
+}
+
+void rs2wrapper::configure_color_stream_config(const std::string &device_sn)
+{
+    stream_config_colors[device_sn].stream_type = RS2_STREAM_COLOR;
+    const streamsettings &color = config.device(device_sn).color;
+    stream_config_colors[device_sn].width = color.width;
+    stream_config_colors[device_sn].height = color.height;
+    stream_config_colors[device_sn].format = color.format;
+    stream_config_colors[device_sn].framerate = color.fps;
+}
+
+void rs2wrapper::configure_depth_stream_config(const std::string &device_sn)
+{
+    stream_config_depths[device_sn].stream_type = RS2_STREAM_DEPTH;
+    const streamsettings &depth = config.device(device_sn).depth;
+    stream_config_depths[device_sn].width = depth.width;
+    stream_config_depths[device_sn].height = depth.height;
+    stream_config_depths[device_sn].format = depth.format;
+    stream_config_depths[device_sn].framerate = depth.fps;
+}
+
+void rs2wrapper::configure_stream(const std::string &device_sn)
+{
+    if (stream_config_colors.find(device_sn) == stream_config_colors.end())
+        throw std::invalid_argument("color config not found for " + device_sn);
+
+    if (stream_config_depths.find(device_sn) == stream_config_depths.end())
+        throw std::invalid_argument("depth config not found for " + device_sn);
+
+    rs2::config cfg;
+    cfg.enable_stream(stream_config_colors[device_sn].stream_type,
+                      stream_config_colors[device_sn].width,
+                      stream_config_colors[device_sn].height,
+                      stream_config_colors[device_sn].format,
+                      stream_config_colors[device_sn].framerate);
+    cfg.enable_stream(stream_config_depths[device_sn].stream_type,
+                      stream_config_depths[device_sn].width,
+                      stream_config_depths[device_sn].height,
+                      stream_config_depths[device_sn].format,
+                      stream_config_depths[device_sn].framerate);
+
+    if (!config.network())
+    {
+        cfg.enable_device(std::string(device_sn));
+
+        // checked against the cached profiles of the device.
+        deviceregistry &registry = deviceregistry::instance();
+        stream_config color = stream_config_colors[device_sn];
+        stream_config depth = stream_config_depths[device_sn];
+        if (registry.supports(device_sn, color.stream_type, color.width, color.height,
+                              color.format, color.framerate) == 0)
+            print(device_sn + " color stream profile not supported by the device", 2);
+        if (registry.supports(device_sn, depth.stream_type, depth.width, depth.height,
+                              depth.format, depth.framerate) == 0)
+            print(device_sn + " depth stream profile not supported by the device", 2);
+    }
+
+    if (verbose)
+        if (cfg.can_resolve(*enabled_devices[device_sn]->pipeline))
+            print("'cfg' usable with 'pipeline' : True", 0);
+        else
+            print("'cfg' usable with 'pipeline' : False", 2);
+
+    rs_cfg[device_sn] = cfg;
+}
+
+void rs2wrapper::configure_color_sensor(const std::string &device_sn)
+{
+    if (!check_if_device_is_enabled(device_sn, __func__))
+        return;
+
+    sensoroptions &options = sensor_options[device_sn];
+
+    if (args.autoexposure())
+    {
+        options.set("color", RS2_OPTION_ENABLE_AUTO_EXPOSURE, 1.0f);
+        options.set("color", RS2_OPTION_AUTO_EXPOSURE_PRIORITY, 0.0f);
+        // https://github.com/IntelRealSense/librealsense/issues/4015
+        // Set the Auto Exposure (AE) Region of Interest (ROI). Should be done after
+        // starting the pipe, will give an error otherwise
+        // Create the ROI for auto exposure (set these values to whatever you need)
+        // rs2::region_of_interest roi;
+        // roi.min_x = 124;
+        // roi.min_y = 350;
+        // roi.max_x = 724;
+        // roi.max_y = 450;
+        // rs2::roi_sensor roi_sensor = css.as<rs2::roi_sensor>();
+        // std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // roi_sensor.set_region_of_interest(roi);
+        // if (verbose)
+        //     print("color sensor roi :\t" +
+        //               std::to_string(roi.min_x) + "\t" +
+        //               std::to_string(roi.min_y) + "\t" +
+        //               std::to_string(roi.max_x) + "\t" +
+        //               std::to_string(roi.max_y),
+        //           0);
+    }
+    else
+    {
+        options.set("color", RS2_OPTION_ENABLE_AUTO_EXPOSURE, 0.0f);
+        options.set("color", RS2_OPTION_EXPOSURE, 100.0f);
+        if (verbose)
+            print("no AE for color sensor...", 0);
+    }
+}
+
+void rs2wrapper::configure_depth_sensor(const std::string &device_sn)
+{
+    if (!check_if_device_is_enabled(device_sn, __func__))
+        return;
+
+    sensoroptions &options = sensor_options[device_sn];
+
+    if (args.autoexposure())
+    {
+        // The limit is set on the sensor before the pipeline starts, no
+        // separate pipeline is needed for it.
+        int limit = args.depth_sensor_autoexposure_limit();
+        options.set("depth", RS2_OPTION_ENABLE_AUTO_EXPOSURE, 1.0f);
+        options.set("depth", RS2_OPTION_AUTO_EXPOSURE_LIMIT_TOGGLE, 1.0f);
+        options.set("depth", RS2_OPTION_AUTO_EXPOSURE_LIMIT, float(limit));
+        if (verbose)
+            print("depth sensor auto exposure limit : " + std::to_string(limit), 0);
 
         // https://github.com/IntelRealSense/librealsense/issues/4015
         // Set the Auto Exposure (AE) Region of Interest (ROI). Should be done after
@@ -911,8 +1701,8 @@ void rs2wrapper::configure_depth_sensor(const std::string &device_sn)
     }
     else
     {
-        dev->depth_sensor->set_option(RS2_OPTION_ENABLE_AUTO_EXPOSURE, 0.0f);
-        dev->depth_sensor->set_option(RS2_OPTION_EXPOSURE, 1000.0);
+        options.set("depth", RS2_OPTION_ENABLE_AUTO_EXPOSURE, 0.0f);
+        options.set("depth", RS2_OPTION_EXPOSURE, 1000.0f);
         if (verbose)
             print("no AE for depth sensor...", 0);
     }
@@ -935,16 +1725,22 @@ void rs2wrapper::configure_color_depth_sensor(const std::string &device_sn)
             if (verbose)
                 print("color sensor available...", 0);
             dev->color_sensor = std::make_shared<rs2::color_sensor>(css);
-            configure_color_sensor(device_sn);
         }
         else if (auto dss = sensor.as<rs2::depth_stereo_sensor>())
         {
             if (verbose)
                 print("depth sensor available...", 0);
             dev->depth_sensor = std::make_shared<rs2::depth_stereo_sensor>(dss);
-            configure_depth_sensor(device_sn);
         }
     }
+
+    apply_sensor_options(device_sn, dev->pipeline_profile->get_device());
+
+    // the options are read in the background from now on.
+    telemetry->add(device_sn, dev->color_sensor, dev->depth_sensor);
+    if (storagepaths.telemetry.count(device_sn) > 0)
+        telemetry->set_log(device_sn, storagepaths.telemetry[device_sn] + "/telemetry.txt");
+    telemetry->start();
 }
 
 void rs2wrapper::configure_ir_emitter(const std::string &device_sn)
@@ -952,44 +1748,58 @@ void rs2wrapper::configure_ir_emitter(const std::string &device_sn)
     if (!check_if_device_is_enabled(device_sn, __func__))
         return;
 
-    auto dss_p = enabled_devices[device_sn]->depth_sensor;
+    sensoroptions &options = sensor_options[device_sn];
 
-    if (dss_p->supports(RS2_OPTION_EMITTER_ENABLED))
+    // The laser power is clamped to its range when applied.
+    if (args.enable_ir_emitter())
     {
-        if (args.enable_ir_emitter())
-        {
-            dss_p->set_option(RS2_OPTION_EMITTER_ENABLED, 1);
-            auto range = dss_p->get_option_range(RS2_OPTION_LASER_POWER);
-            float power = 0.0;
-            if ((float)args.ir_emitter_power() > range.max)
-                power = range.max;
-            else if ((float)args.ir_emitter_power() < range.min)
-                power = range.min;
-            else
-                power = (float)args.ir_emitter_power();
-            dss_p->set_option(RS2_OPTION_LASER_POWER, power);
-            // dss_p->set_option(RS2_OPTION_LASER_POWER, 0.f); // Disable laser
-            if (verbose)
-                print("ir emitter enabled...", 0);
-        }
-        else
-        {
-            dss_p->set_option(RS2_OPTION_EMITTER_ENABLED, 0);
-            if (verbose)
-                print("ir emitter not enabled...", 0);
-        }
+        options.set("depth", RS2_OPTION_EMITTER_ENABLED, 1.0f);
+        options.set("depth", RS2_OPTION_LASER_POWER, (float)args.ir_emitter_power());
+        if (verbose)
+            print("ir emitter enabled...", 0);
     }
     else
     {
+        options.set("depth", RS2_OPTION_EMITTER_ENABLED, 0.0f);
         if (verbose)
-            print("ir emitter not supported...", 1);
+            print("ir emitter not enabled...", 0);
+    }
+}
+
+int rs2wrapper::apply_sensor_options(const std::string &device_sn)
+{
+    // not streaming yet, the device is taken from the registry or resolved
+    // from the config.
+    deviceregistry::entry e;
+    if (!config.network() && deviceregistry::instance().find(device_sn, e))
+        return apply_sensor_options(device_sn, e.device);
+    try
+    {
+        return apply_sensor_options(
+            device_sn,
+            rs_cfg[device_sn].resolve(*enabled_devices[device_sn]->pipeline).get_device());
     }
+    catch (const rs2::error &e)
+    {
+        print(device_sn + " sensor options not set before start : " + e.what(), 1);
+        return -1;
+    }
+}
+
+int rs2wrapper::apply_sensor_options(const std::string &device_sn,
+                                     const rs2::device &device)
+{
+    int failed = sensor_options[device_sn].apply(device, device_sn);
+    metrics::instance().set(device_sn, "options_failed", failed);
+    return failed;
 }
 
 bool rs2wrapper::process_color_stream(const std::string &device_sn,
                                       const rs2::frameset &frameset,
                                       const int64_t &global_timestamp,
-                                      rs2_metadata_type &timestamp)
+                                      const int64_t &frame_idx,
+                                      rs2_metadata_type &timestamp,
+                                      const bool &save)
 {
     try
     {
@@ -1012,17 +1822,12 @@ bool rs2wrapper::process_color_stream(const std::string &device_sn,
             return false;
         }
 
-        std::string filename = pad_zeros(std::to_string(global_timestamp), 20);
+        update_gaps(device_sn, frame, timestamp,
+                    frame_gaps[device_sn].color_dropped,
+                    frame_gaps[device_sn].color_jitter_us);
 
-        // Record per-frame metadata for UVC streams
-        std::string csv_file = storagepaths.color_metadata[device_sn] +
-                               "/" + filename + ".csv";
-        metadata_to_csv(frame, csv_file);
-
-        // Write images to disk
-        std::string png_file = storagepaths.color[device_sn] +
-                               "/" + filename + ".bin";
-        framedata_to_bin(frame, png_file);
+        if (save)
+            save_color_frame(device_sn, frame, global_timestamp, frame_idx);
 
         // Save timestamp
         dev->color_timestamp = timestamp;
@@ -1049,7 +1854,9 @@ bool rs2wrapper::process_color_stream(const std::string &device_sn,
 bool rs2wrapper::process_depth_stream(const std::string &device_sn,
                                       const rs2::frameset &frameset,
                                       const int64_t &global_timestamp,
-                                      rs2_metadata_type &timestamp)
+                                      const int64_t &frame_idx,
+                                      rs2_metadata_type &timestamp,
+                                      const bool &save)
 {
     try
     {
@@ -1072,17 +1879,12 @@ bool rs2wrapper::process_depth_stream(const std::string &device_sn,
             return false;
         }
 
-        std::string filename = pad_zeros(std::to_string(global_timestamp), 20);
-
-        // Record per-frame metadata for UVC streams
-        std::string csv_file = storagepaths.depth_metadata[device_sn] +
-                               "/" + filename + ".csv";
-        metadata_to_csv(frame, csv_file);
+        update_gaps(device_sn, frame, timestamp,
+                    frame_gaps[device_sn].depth_dropped,
+                    frame_gaps[device_sn].depth_jitter_us);
 
-        // Write images to disk
-        std::string png_file = storagepaths.depth[device_sn] +
-                               "/" + filename + ".bin";
-        framedata_to_bin(frame, png_file);
+        if (save)
+            save_depth_frame(device_sn, frame, global_timestamp, frame_idx);
 
         // Save timestamp
         dev->depth_timestamp = timestamp;
@@ -1109,22 +1911,493 @@ bool rs2wrapper::process_depth_stream(const std::string &device_sn,
 int rs2wrapper::process_color_depth_stream(const std::string &device_sn,
                                            const rs2::frameset &frameset,
                                            const int64_t &global_timestamp,
+                                           const int64_t &frame_idx,
                                            rs2_metadata_type &color_timestamp,
-                                           rs2_metadata_type &depth_timestamp)
+                                           rs2_metadata_type &depth_timestamp,
+                                           const bool &save,
+                                           const bool &has_color,
+                                           const bool &has_depth)
 {
     int error_status = 0;
-    if (!process_color_stream(device_sn, frameset,
-                              global_timestamp, color_timestamp))
+    frame_gaps[device_sn] = framegaps();
+    color_timestamp = -1;
+    depth_timestamp = -1;
+    if (has_color &&
+        !process_color_stream(device_sn, frameset,
+                              global_timestamp, frame_idx, color_timestamp, save))
         error_status += 1;
-    print_camera_temperature(*enabled_devices[device_sn],
-                             camera_temp_printout_interval,
-                             args.verbose());
-    if (!process_depth_stream(device_sn, frameset,
-                              global_timestamp, depth_timestamp))
+    if (has_depth &&
+        !process_depth_stream(device_sn, frameset,
+                              global_timestamp, frame_idx, depth_timestamp, save))
         error_status += 2;
+    if (save && has_depth && error_status == 0)
+        save_pointcloud(device_sn, frameset, global_timestamp, frame_idx);
+    enabled_devices[device_sn]->frame_counter += 1;
+    if (enabled_devices[device_sn]->frame_counter % std::max(1, config.device(device_sn).fps()) == 0)
+        publish_gaps(device_sn);
     return error_status;
 }
 
+void rs2wrapper::save_color_frame(const std::string &device_sn,
+                                  const rs2::frame &frame,
+                                  const int64_t &global_timestamp,
+                                  const int64_t &frame_idx)
+{
+    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    std::string filename = pad_zeros(std::to_string(global_timestamp), 20);
+
+    // Record per-frame metadata for UVC streams
+    std::string csv_file = storagepaths.fanout(storagepaths.color_metadata[device_sn],
+                                               global_timestamp,
+                                               frame_idx) +
+                           "/" + filename + ".csv";
+    metadata_to_csv(frame, csv_file, metadata_cache);
+
+    // Write images to disk
+    std::string png_file = storagepaths.fanout(storagepaths.color[device_sn],
+                                               global_timestamp,
+                                               frame_idx) +
+                           "/" + filename + ".bin";
+    framedata_to_bin(frame, png_file);
+}
+
+void rs2wrapper::save_depth_frame(const std::string &device_sn,
+                                  const rs2::frame &frame,
+                                  const int64_t &global_timestamp,
+                                  const int64_t &frame_idx)
+{
+    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    std::string filename = pad_zeros(std::to_string(global_timestamp), 20);
+
+    // Record per-frame metadata for UVC streams
+    std::string csv_file = storagepaths.fanout(storagepaths.depth_metadata[device_sn],
+                                               global_timestamp,
+                                               frame_idx) +
+                           "/" + filename + ".csv";
+    metadata_to_csv(frame, csv_file, metadata_cache);
+
+    bool filtered = depth_filters.find(device_sn) != depth_filters.end();
+    const std::string &output = config.depth_output();
+
+    // Write images to disk
+    if (!filtered || output != "filtered")
+    {
+        std::string png_file = storagepaths.fanout(storagepaths.depth[device_sn],
+                                                   global_timestamp,
+                                                   frame_idx) +
+                               "/" + filename + ".bin";
+        framedata_to_bin(frame, png_file);
+    }
+    if (filtered && output != "raw")
+        save_filtered_depth_frame(device_sn, frame, global_timestamp, frame_idx);
+}
+
+void rs2wrapper::save_filtered_depth_frame(const std::string &device_sn,
+                                           const rs2::frame &frame,
+                                           const int64_t &global_timestamp,
+                                           const int64_t &frame_idx)
+{
+    rs2::video_frame vf = frame.as<rs2::video_frame>();
+    if (!vf)
+        return;
+
+    // The point cloud needs the filtered depth of this step, otherwise the
+    // filters run off the capture thread, on a copy of the depth so that
+    // the frame goes back to librealsense.
+    if (filter_writer && pointclouds.find(device_sn) == pointclouds.end())
+    {
+        std::string bin_path = storagepaths.fanout(storagepaths.depth_filtered[device_sn],
+                                                   global_timestamp,
+                                                   frame_idx,
+                                                   false);
+        std::string bin_file = bin_path + "/" + pad_zeros(std::to_string(global_timestamp), 20) + ".bin";
+        int width = vf.get_width();
+        int height = vf.get_height();
+        int stride = vf.get_stride_in_bytes();
+        const uint16_t *data = static_cast<const uint16_t *>(vf.get_data());
+        std::shared_ptr<std::vector<uint16_t>> depth = std::make_shared<std::vector<uint16_t>>(
+            data, data + (size_t)height * stride / sizeof(uint16_t));
+        bool queued = filter_writer->push(
+            [this, device_sn, depth, width, height, stride, bin_path, bin_file]
+            {
+                // EEXIST for every frame but the first of a shard.
+                mkdir(bin_path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+                filter_depth_frame(device_sn, depth->data(), width, height, stride, bin_file);
+            });
+        if (!queued)
+            metrics::instance().add(device_sn, "filter_dropped", 1);
+        return;
+    }
+
+    std::string bin_file = storagepaths.fanout(storagepaths.depth_filtered[device_sn],
+                                               global_timestamp,
+                                               frame_idx) +
+                           "/" + pad_zeros(std::to_string(global_timestamp), 20) + ".bin";
+    filter_depth_frame(device_sn,
+                       static_cast<const uint16_t *>(vf.get_data()),
+                       vf.get_width(),
+                       vf.get_height(),
+                       vf.get_stride_in_bytes(),
+                       bin_file);
+}
+
+void rs2wrapper::filter_depth_frame(const std::string &device_sn,
+                                    const uint16_t *depth,
+                                    const int &width,
+                                    const int &height,
+                                    const int &stride,
+                                    const std::string &bin_file)
+{
+    // The entries are created by 'initialize_depth_filter', the map is only read here.
+    std::shared_ptr<depthfilter> filter = depth_filters.at(device_sn);
+    std::vector<uint16_t> &filtered_depth = filtered_depths.at(device_sn);
+    filtered_depth.resize((size_t)width * height);
+
+    filter->process(depth, width, height, stride, filtered_depth.data());
+
+    metrics &m = metrics::instance();
+    int64_t total_ns = 0;
+    for (int s = 0; s < depthfilter::NUM_STAGES; s++)
+    {
+        int64_t ns = filter->stage_duration_ns((depthfilter::stage)s);
+        if (ns == 0)
+            continue;
+        m.set(device_sn, "filter_" + depthfilter::stage_name((depthfilter::stage)s) + "_ms", ns * 1e-6);
+        total_ns += ns;
+    }
+    m.set(device_sn, "filter_total_ms", total_ns * 1e-6);
+
+    std::ofstream outfile(bin_file, std::ofstream::binary);
+    outfile.write(reinterpret_cast<const char *>(filtered_depth.data()),
+                  (size_t)filter->out_width() * filter->out_height() * sizeof(uint16_t));
+}
+
+void rs2wrapper::save_pointcloud(const std::string &device_sn,
+                                 const rs2::frameset &frameset,
+                                 const int64_t &global_timestamp,
+                                 const int64_t &frame_idx)
+{
+    if (pointclouds.find(device_sn) == pointclouds.end())
+        return;
+
+    rs2::depth_frame depth = frameset.get_depth_frame();
+    if (!depth)
+        return;
+
+    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    std::shared_ptr<pointcloud> pc = pointclouds[device_sn];
+    auto t0 = std::chrono::steady_clock::now();
+
+    // Uses the same depth as the one that is saved, the filtered one if any.
+    const uint16_t *depth_data = static_cast<const uint16_t *>(depth.get_data());
+    int width = depth.get_width();
+    int height = depth.get_height();
+    int stride = depth.get_stride_in_bytes();
+    auto filter = depth_filters.find(device_sn);
+    if (filter != depth_filters.end() && config.depth_output() != "raw")
+    {
+        depth_data = filtered_depths[device_sn].data();
+        width = filter->second->out_width();
+        height = filter->second->out_height();
+        stride = width * sizeof(uint16_t);
+    }
+
+    // Color is only used when it is rgb/bgr and the depth is aligned to it.
+    const uint8_t *color_data = nullptr;
+    int color_width = 0;
+    int color_height = 0;
+    int color_stride = 0;
+    int color_bpp = 0;
+    bool color_bgr = false;
+    rs2::video_frame color = frameset.get_color_frame();
+    if (config.pointcloud() == "xyzrgb" && color &&
+        config.device(device_sn).depth_aligned())
+    {
+        rs2_format format = color.get_profile().format();
+        color_bgr = format == RS2_FORMAT_BGR8 || format == RS2_FORMAT_BGRA8;
+        if (format == RS2_FORMAT_RGB8 || format == RS2_FORMAT_BGR8 ||
+            format == RS2_FORMAT_RGBA8 || format == RS2_FORMAT_BGRA8)
+        {
+            color_data = static_cast<const uint8_t *>(color.get_data());
+            color_width = color.get_width();
+            color_height = color.get_height();
+            color_stride = color.get_stride_in_bytes();
+            color_bpp = color.get_bytes_per_pixel();
+        }
+    }
+
+    size_t num_points = pc->process(depth_data, width, height, stride,
+                                    depth.get_units(),
+                                    color_data, color_width, color_height,
+                                    color_stride, color_bpp, color_bgr);
+    const float *points = pc->points();
+    const uint8_t *colors = color_data ? pc->colors() : nullptr;
+
+    auto grid = voxelgrids.find(device_sn);
+    if (grid != voxelgrids.end())
+    {
+        num_points = grid->second->process(points, num_points, 3, colors);
+        points = grid->second->points();
+        colors = grid->second->colors();
+    }
+
+    if (fusion)
+    {
+        fusionframe &ff = fusion_frames[device_sn];
+        ff.global_timestamp = global_timestamp;
+        ff.xyz.assign(points, points + num_points * 3);
+        if (colors)
+            ff.rgb.assign(colors, colors + num_points * 3);
+        else
+            ff.rgb.clear();
+    }
+
+    if (config.pointcloud() != "none")
+    {
+        std::string ply_file = storagepaths.fanout(storagepaths.pointcloud[device_sn],
+                                                   global_timestamp,
+                                                   frame_idx) +
+                               "/" + pad_zeros(std::to_string(global_timestamp), 20) + ".ply";
+        if (!points_to_ply(ply_file, points, colors, num_points))
+            print(device_sn + " could not write " + ply_file, 2);
+    }
+
+    metrics &m = metrics::instance();
+    m.set(device_sn, "pointcloud_points", num_points);
+    m.set(device_sn, "pointcloud_ms", get_timestamp_duration_ns(t0) * 1e-6);
+}
+
+void rs2wrapper::fuse_pointclouds()
+{
+    if (!fusion)
+        return;
+
+    metrics &m = metrics::instance();
+    int64_t global_timestamp = -1;
+    for (auto const &enabled_device : enabled_devices)
+    {
+        auto itr = fusion_frames.find(enabled_device.first);
+        if (itr == fusion_frames.end() || itr->second.global_timestamp < 0)
+        {
+            m.add("fusion", "ticks_incomplete", 1);
+            return;
+        }
+        global_timestamp = std::max(global_timestamp, itr->second.global_timestamp);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    size_t num_points = fusion->process(fusion_frames);
+
+    // The folder is created by the storage rotator.
+    if (!storagepaths.fusion.empty())
+    {
+        // The shard is created by the writer.
+        std::string ply_path = storagepaths.fanout(storagepaths.fusion,
+                                                   global_timestamp,
+                                                   fusion_ticks,
+                                                   false);
+        std::string ply_file = ply_path + "/" + pad_zeros(std::to_string(global_timestamp), 20) + ".ply";
+        std::shared_ptr<std::vector<float>> xyz = std::make_shared<std::vector<float>>(
+            fusion->points(), fusion->points() + num_points * 3);
+        std::shared_ptr<std::vector<uint8_t>> rgb;
+        if (fusion->colors())
+            rgb = std::make_shared<std::vector<uint8_t>>(
+                fusion->colors(), fusion->colors() + num_points * 3);
+        bool queued = fusion_writer->push(
+            [ply_path, ply_file, xyz, rgb, num_points]
+            {
+                // EEXIST for every tick but the first of a shard.
+                mkdir(ply_path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+                if (!points_to_ply(ply_file, xyz->data(), rgb ? rgb->data() : nullptr, num_points))
+                    print("could not write " + ply_file, 2);
+            });
+        if (!queued)
+            m.add("fusion", "writes_dropped", 1);
+    }
+    fusion_ticks++;
+
+    for (auto &&frame : fusion_frames)
+        frame.second.global_timestamp = -1;
+
+    m.add("fusion", "ticks", 1);
+    m.set("fusion", "points", num_points);
+    m.set("fusion", "ms", get_timestamp_duration_ns(t0) * 1e-6);
+}
+
+motiongate::decision rs2wrapper::query_motion_decision(const std::string &device_sn,
+                                                       const rs2::frameset &frameset,
+                                                       const int64_t &global_timestamp)
+{
+    if (motion_gates.find(device_sn) == motion_gates.end())
+        return motiongate::STORE;
+
+    std::shared_ptr<motiongate> gate = motion_gates[device_sn];
+    const std::string &mode = config.motion_gate();
+    float score = 0.0f;
+
+    if (mode == "depth" || mode == "both")
+    {
+        rs2::video_frame vf = frameset.first_or_default(RS2_STREAM_DEPTH).as<rs2::video_frame>();
+        if (vf)
+            score = std::max(score,
+                             gate->score_depth(
+                                 static_cast<const uint16_t *>(vf.get_data()),
+                                 vf.get_width(),
+                                 vf.get_height(),
+                                 vf.get_stride_in_bytes()));
+    }
+    if (mode == "color" || mode == "both")
+    {
+        rs2::video_frame vf = frameset.first_or_default(RS2_STREAM_COLOR).as<rs2::video_frame>();
+        if (vf)
+            score = std::max(score,
+                             gate->score_color(
+                                 static_cast<const uint8_t *>(vf.get_data()),
+                                 vf.get_width() * vf.get_bytes_per_pixel(),
+                                 vf.get_height(),
+                                 vf.get_stride_in_bytes()));
+    }
+
+    motiongate::decision decision = gate->update(score, global_timestamp);
+
+    metrics &m = metrics::instance();
+    m.set(device_sn, "motion_score", score);
+    m.set(device_sn, "motion_active", gate->active() ? 1 : 0);
+
+    return decision;
+}
+
+motiongate::decision rs2wrapper::query_record_decision(const std::string &device_sn,
+                                                       const rs2::frameset &frameset,
+                                                       const int64_t &global_timestamp)
+{
+    motiongate::decision decision = query_motion_decision(device_sn,
+                                                          frameset,
+                                                          global_timestamp);
+    if (config.record_mode() != "trigger")
+        return decision;
+
+    // The motion gate acts as a detector, its idle frames are not used.
+    eventtrigger &trigger = eventtrigger::instance();
+    if (decision == motiongate::STORE_WITH_PRE_ROLL)
+        trigger.fire(device_sn);
+
+    int64_t &record_until = trigger_record_until[device_sn];
+    uint64_t generation = trigger.generation(device_sn);
+    if (generation != trigger_generations[device_sn])
+    {
+        trigger_generations[device_sn] = generation;
+        bool recording = global_timestamp <= record_until;
+        record_until = global_timestamp + (int64_t)(config.trigger_post_sec() * 1e9);
+        metrics::instance().add(device_sn, "triggers", 1);
+        if (verbose)
+            print(device_sn + " triggered, recording until " +
+                      std::to_string(record_until / 1000000000) + "s...",
+                  0);
+        // A trigger while recording only extends the recording.
+        return recording ? motiongate::STORE : motiongate::STORE_WITH_PRE_ROLL;
+    }
+    return global_timestamp <= record_until ? motiongate::STORE : motiongate::SKIP;
+}
+
+void rs2wrapper::buffer_frameset(const std::string &device_sn,
+                                 frameset_record &record,
+                                 const bool &with_pre_roll)
+{
+    std::shared_ptr<framesetring> ring = rings[device_sn];
+    if (with_pre_roll)
+    {
+        ring->mark_for_saving(record.global_timestamp);
+        if (verbose && ring->size() > 0)
+            print(device_sn + " saving " + std::to_string(ring->size()) +
+                      " buffered frames...",
+                  0);
+    }
+    ring->push(record);
+    drain_ring(device_sn, record.global_timestamp, false);
+}
+
+void rs2wrapper::drain_ring(const std::string &device_sn,
+                            const int64_t &global_timestamp,
+                            const bool &flush)
+{
+    if (rings.find(device_sn) == rings.end())
+        return;
+
+    std::shared_ptr<framesetring> ring = rings[device_sn];
+    std::string txt_file = storagepaths.timestamp[device_sn] + "/timestamp.txt";
+    int saved = 0;
+
+    while (!ring->empty())
+    {
+        frameset_record &record = ring->front();
+        bool over_budget = ring->over_budget();
+        bool stored = false;
+
+        if (record.save)
+        {
+            // Only a few framesets are written per step so that a trigger
+            // does not stall the capture, unless the ring is over its budget.
+            if (!flush && !over_budget && saved >= ring_drain_per_step)
+                break;
+            try
+            {
+                // a stream without a new frame has -1 as timestamp.
+                if (record.color_timestamp >= 0)
+                    save_color_frame(device_sn,
+                                     record.frameset.first_or_default(RS2_STREAM_COLOR),
+                                     record.global_timestamp,
+                                     record.frame_idx);
+                if (record.depth_timestamp >= 0)
+                {
+                    save_depth_frame(device_sn,
+                                     record.frameset.first_or_default(RS2_STREAM_DEPTH),
+                                     record.global_timestamp,
+                                     record.frame_idx);
+                    save_pointcloud(device_sn,
+                                    record.frameset,
+                                    record.global_timestamp,
+                                    record.frame_idx);
+                }
+                stored = true;
+            }
+            catch (const std::exception &e)
+            {
+                print(device_sn + " :: buffered frame : " + e.what(), 2);
+            }
+            saved++;
+        }
+        else if (!flush && !over_budget && !ring->expired(global_timestamp))
+        {
+            break;
+        }
+
+        timestamp_to_txt(record.global_timestamp,
+                         record.color_timestamp,
+                         record.depth_timestamp,
+                         txt_file,
+                         stored,
+                         record.corrected_timestamp,
+                         record.gaps);
+        ring->pop();
+    }
+
+    metrics &m = metrics::instance();
+    m.set(device_sn, "ring_frames", ring->size());
+    m.set(device_sn, "ring_bytes", ring->bytes());
+}
+
+rs2_intrinsics rs2wrapper::query_saved_depth_intrinsics(const std::string &device_sn)
+{
+    std::shared_ptr<device> dev = enabled_devices[device_sn];
+    rs2_stream stream = config.device(device_sn).depth_aligned()
+                            ? RS2_STREAM_COLOR
+                            : RS2_STREAM_DEPTH;
+    return dev->pipeline_profile->get_stream(stream)
+        .as<rs2::video_stream_profile>()
+        .get_intrinsics();
+}
+
 bool rs2wrapper::align_frameset(const std::string &device_sn,
                                 rs2::frameset &frameset,
                                 rs2::frameset &aligned_frameset,
@@ -1134,6 +2407,30 @@ bool rs2wrapper::align_frameset(const std::string &device_sn,
     {
         if (mode == 1)
         {
+            // The streams run at different fps: a frameset without depth
+            // has nothing to align, a depth frame without color is aligned
+            // to the last color frame (only its profile matters).
+            // The depth is only aligned if color has the same resolution.
+            std::shared_ptr<device> dev = enabled_devices[device_sn];
+            rs2::frame color = frameset.first_or_default(RS2_STREAM_COLOR);
+            rs2::frame depth = frameset.first_or_default(RS2_STREAM_DEPTH);
+            if (color)
+                dev->last_color = color;
+            if (!depth || !config.device(device_sn).depth_aligned())
+            {
+                aligned_frameset = frameset;
+                return true;
+            }
+            if (!color)
+            {
+                if (!dev->last_color)
+                    return false;
+                rs2::frameset composed = composer->compose({depth, dev->last_color});
+                if (!composed)
+                    return false;
+                aligned_frameset = align_to_color.process(composed);
+                return true;
+            }
             aligned_frameset = align_to_color.process(frameset);
             return true;
         }
@@ -1163,6 +2460,90 @@ bool rs2wrapper::align_frameset(const std::string &device_sn,
     }
 }
 
+int64_t rs2wrapper::query_sync_timestamp(const int64_t &corrected_timestamp,
+                                         const int64_t &global_timestamp)
+{
+    if (config.sync() != "sensor" || corrected_timestamp < 0)
+        return global_timestamp;
+    return corrected_timestamp;
+}
+
+void rs2wrapper::update_gaps(const std::string &device_sn,
+                             const rs2::frame &frame,
+                             const rs2_metadata_type &timestamp,
+                             int64_t &dropped,
+                             int64_t &jitter_us)
+{
+    // arrival time is in ms, sensor/frame timestamps in us.
+    int64_t unit_ns = timestamp_mode == RS2_FRAME_METADATA_TIME_OF_ARRIVAL ? 1000000 : 1000;
+    rs2::stream_profile profile = frame.get_profile();
+    int64_t jitter_ns = 0;
+    gap_trackers[device_sn][profile.stream_type()].update(
+        query_frame_metadata(frame, RS2_FRAME_METADATA_FRAME_COUNTER),
+        timestamp >= 0 ? timestamp * unit_ns : -1,
+        profile.fps(),
+        dropped,
+        jitter_ns);
+    jitter_us = jitter_ns / 1000;
+}
+
+void rs2wrapper::publish_gaps(const std::string &device_sn)
+{
+    metrics &m = metrics::instance();
+    for (auto &&entry : gap_trackers[device_sn])
+    {
+        std::string name = rs2_stream_to_string((rs2_stream)entry.first);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        gaptracker &tracker = entry.second;
+        m.set(device_sn, name + "_dropped", tracker.dropped());
+        m.set(device_sn, name + "_drop_rate", tracker.drop_rate());
+        m.set(device_sn, name + "_jitter_rms_ms", tracker.jitter_rms_ns() * 1e-6);
+        m.set(device_sn, name + "_jitter_max_ms", tracker.jitter_max_ns() * 1e-6);
+        tracker.reset_jitter();
+    }
+}
+
+int64_t rs2wrapper::update_clock_model(const std::string &device_sn,
+                                       const rs2_metadata_type &sensor_timestamp,
+                                       const int64_t &global_timestamp)
+{
+    if (sensor_timestamp < 0)
+        return -1;
+
+    if (clock_models.find(device_sn) == clock_models.end())
+    {
+        clock_models[device_sn] = std::make_shared<clockmodel>();
+        clock_fit_counts[device_sn] = 0;
+    }
+    std::shared_ptr<clockmodel> model = clock_models[device_sn];
+
+    // arrival time is in ms, sensor/frame timestamps in us.
+    int64_t unit_ns = timestamp_mode == RS2_FRAME_METADATA_TIME_OF_ARRIVAL ? 1000000 : 1000;
+    int64_t corrected_timestamp = model->update(sensor_timestamp * unit_ns,
+                                                global_timestamp);
+
+    if (model->fit_count() != clock_fit_counts[device_sn])
+    {
+        clock_fit_counts[device_sn] = model->fit_count();
+
+        metrics &m = metrics::instance();
+        m.set(device_sn, "clock_drift_ppm", model->drift_ppm());
+        m.set(device_sn, "clock_residual_ms", model->residual_ns() * 1e-6);
+
+        std::string txt_file = storagepaths.clock[device_sn] + "/clock.txt";
+        std::ofstream txt(txt_file, std::ofstream::app);
+        txt << global_timestamp
+            << "::"
+            << model->sensor_reference()
+            << "::"
+            << model->offset()
+            << "::"
+            << std::setprecision(12) << model->slope()
+            << "\n";
+    }
+    return corrected_timestamp;
+}
+
 void rs2wrapper::query_timestamp_mode(const std::string &device_sn)
 {
     for (auto &&frame : enabled_devices[device_sn]->pipeline->wait_for_frames())
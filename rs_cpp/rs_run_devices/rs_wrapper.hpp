@@ -16,6 +16,7 @@
 #include <mutex>
 #include <chrono>
 #include <thread>
+#include <future>
 #include <algorithm>
 #include <vector>
 #include <map>
@@ -24,10 +25,32 @@
 #include <fstream>  // File IO
 #include <iostream> // Terminal IO
 #include <sstream>  // Stringstreams
+#include <iomanip>
 
 #include "utils.hpp"
 #include "rs_args.hpp"
+#include "config.hpp"
 #include "rs_utils.hpp"
+#include "rotation.hpp"
+#include "motion.hpp"
+#include "ring.hpp"
+#include "trigger.hpp"
+#include "workerpool.hpp"
+#include "filter.hpp"
+#include "pointcloud.hpp"
+#include "voxel.hpp"
+#include "fusion.hpp"
+#include "writer.hpp"
+#include "sync.hpp"
+#include "clock.hpp"
+#include "exposure.hpp"
+#include "options.hpp"
+#include "registry.hpp"
+#include "hotplug.hpp"
+#include "reset.hpp"
+#include "health.hpp"
+#include "telemetry.hpp"
+#include "metrics.hpp"
 
 /**
  * @brief Wrapper class for the librealsense library to run a realsense device.
@@ -63,6 +86,26 @@ public:
                rs2::context context,
                std::string device_sn = "-1");
 
+    /**
+     * @brief Construct a new rs2wrapper object from arguments that are
+     * already parsed, the config is not parsed again.
+     *
+     * @param args arguments.
+     * @param config config parsed from 'args'.
+     * @param verbose If provided overrides the one in args.
+     * @param ctx rs context.
+     * @param device_sn Device serial number to be used.
+     */
+    rs2wrapper(rs2args args,
+               const rs2config &config,
+               const bool &verbose,
+               rs2::context context,
+               std::string device_sn = "-1");
+    rs2wrapper(rs2args args,
+               const rs2config &config,
+               rs2::context context,
+               std::string device_sn = "-1");
+
     /**
      * @brief Initialize the realsense devices.
      *
@@ -71,8 +114,6 @@ public:
     void initialize(const bool &enable_ir_emitter = true);
     void initialize(const std::string &device_sn,
                     const bool &enable_ir_emitter = true);
-    void initialize_depth_sensor_ae();
-    void initialize_depth_sensor_ae(const std::string &device_sn);
 
     /**
      * @brief starts the rs pipeline.
@@ -103,11 +144,20 @@ public:
     void stop_sensor(const std::string &device_sn);
 
     /**
-     * @brief resets the pipeline using stop and start.
+     * @brief resets the pipeline using stop and start. The pipeline is
+     * restarted as soon as the device takes it and the reset waits for the
+     * first valid frameset (--ready-timeout-ms) and the AE to converge.
      *
      */
     void reset();
     void reset(const std::string &device_sn);
+
+    /**
+     * @brief hardware reset of a device, does not block: the device is
+     * detached and handed to the reset service, the other devices keep
+     * streaming and the device is attached again once it is back.
+     *
+     */
     void reset_hardware(const std::string &device_sn);
     void reset_reset_counter();
     void reset_reset_counter(const std::string &device_sn);
@@ -126,6 +176,15 @@ public:
     void reset_due_to_empty_frame_received();
     void reset_due_to_empty_frame_received(const std::string &device_sn);
 
+    /**
+     * @brief resets a device if the reset scheduler finds it unhealthy
+     * (--reset-policy health): a pipeline restart, or a hardware reset if
+     * the restart did not help.
+     *
+     */
+    void reset_due_to_health();
+    void reset_due_to_health(const std::string &device_sn);
+
     /**
      * @brief Saves the camera calibration data.
      *
@@ -134,15 +193,21 @@ public:
     void save_calib(const std::string &device_sn);
 
     /**
-     * @brief Flushes N frames
+     * @brief Flushes frames until the AE has converged
      *
-     * Used to discard frames at init to give autoexposure, etc. a chance to settle.
+     * Used to discard frames at init and after a reset to give autoexposure,
+     * etc. a chance to settle. Stops once the AE has converged
+     * (--ae-tolerance, --ae-stable-frames) or after --ae-max-wait-ms. With
+     * --ae-max-wait-ms 0, N frames are flushed.
      *
-     * @param num_frames N frames to flush.
+     * @param num_frames frames to flush without the AE convergence,
+     *                   -1 = --flush-steps.
+     * @return int frames flushed.
      */
     void flush_frame();
     void flush_frame(const std::string &device_sn);
     void flush_frames(const int &num_frames = -1);
+    int flush_frames(const std::string &device_sn, const int &num_frames);
 
     /**
      * @brief resets the global timestamp start
@@ -165,8 +230,27 @@ public:
     std::vector<std::vector<std::string>> get_available_devices();
     std::map<std::string, std::shared_ptr<device>> get_enabled_devices();
     rs2args get_args();
+    const rs2config &get_config();
     void set_storagepaths(const storagepath &storagepaths);
     storagepath get_storagepaths();
+    void set_storagerotator(std::shared_ptr<storagerotator> rotator);
+    void set_workerpool(std::shared_ptr<workerpool> pool);
+    void set_framesync(std::shared_ptr<framesync> sync);
+    void set_resetservice(std::shared_ptr<resetservice> resets);
+    void set_resetscheduler(std::shared_ptr<resetscheduler> health);
+    void set_telemetrysampler(std::shared_ptr<telemetrysampler> telemetry);
+
+    /**
+     * @brief creates the reset scheduler of the devices from the args
+     * (--reset-groups, --health-*).
+     *
+     * @param args rs2args.
+     * @param device_sns all devices.
+     * @return std::shared_ptr<resetscheduler>
+     */
+    static std::shared_ptr<resetscheduler> create_resetscheduler(
+        rs2args &args,
+        const std::vector<std::string> &device_sns);
 
     /**
      * @brief Check functions to see if some condition is true.
@@ -188,17 +272,127 @@ private:
      * @param device_sn Device serial number to be used.
      */
     void constructor(rs2args args,
+                     const rs2config &config,
                      const bool &verbose,
                      rs2::context context,
                      std::string device_sn);
 
     void query_available_devices();
 
+    /**
+     * @brief picks up the storage paths of a new window from the rotator.
+     *
+     */
+    void update_storage();
+
     rs2::pipeline initialize_pipeline();
 
+    /**
+     * @brief creates the depth filters (--depth-filters) of a device.
+     *
+     * The filters run on the saved depth, so its intrinsics (color ones if
+     * aligned) are used for the disparity conversion.
+     *
+     * @param device_sn device serial number.
+     */
+    void initialize_depth_filter(const std::string &device_sn);
+
+    /**
+     * @brief creates the point cloud generator (--pointcloud) of a device,
+     * with the rays of the intrinsics of the saved depth,
+     * and its voxel grid (--voxel-size). Also creates the fusion of all
+     * devices (--fusion-extrinsics).
+     *
+     * @param device_sn device serial number.
+     */
+    void initialize_pointcloud(const std::string &device_sn);
+
+    /**
+     * @brief handles the hot-plug events of the devices (--hotplug), on the
+     * capture thread at the start of 'step':
+     * - a removed device is torn down (its ring is flushed) and the other
+     *   devices keep streaming.
+     * - a device that is added again is restarted in the background by
+     *   'reattach_device' and swapped in once it streams.
+     * - a device after its hardware reset is restarted the same way.
+     * - a restart that fails is retried with a doubling wait, after the
+     *   last attempt the device stays detached and the health scheduler
+     *   is told it is done.
+     * The downtime is set in the metrics (downtime_ms, downtime_total_ms).
+     *
+     */
+    void process_hotplug();
+    void process_resets();
+    void attach_restarted_devices();
+    void start_reattach(const std::string &device_sn, const int &attempt);
+    void detach_device(const std::string &device_sn);
+    void attach_device(const std::string &device_sn, std::shared_ptr<device> dev);
+
+    /**
+     * @brief starts a new pipeline for a device that came back and flushes
+     * it until the AE converged, runs on a background thread so it only
+     * uses copies of the wrapper state.
+     *
+     * @param device_sn device serial number.
+     * @param cfg rs2 config of the device.
+     * @param options sensor options of the device, applied before the start.
+     * @param timeout_ms max wait for the device to take the pipeline.
+     * @param flush_steps frames of the warm-up without the AE convergence.
+     * @return std::shared_ptr<device> the streaming device.
+     */
+    std::shared_ptr<device> reattach_device(const std::string &device_sn,
+                                            rs2::config cfg,
+                                            sensoroptions options,
+                                            const int &timeout_ms,
+                                            const int &flush_steps);
+
+    /**
+     * @brief the flush of 'flush_frames' on a device that is not enabled
+     * (yet), only reads 'config' so it can run in the background.
+     *
+     * @param dev the streaming device.
+     * @param num_frames frames to flush without the AE convergence.
+     * @return int frames flushed.
+     */
+    int flush_frames(std::shared_ptr<device> dev, const int &num_frames);
+
+    /**
+     * @brief readiness conditions that replace fixed sleeps, they give up
+     * after 'timeout_ms' and return false.
+     *
+     * wait_for_sensor : an option of the depth sensor is readable.
+     * wait_for_frameset : a valid color + depth frameset is received.
+     * start_when_ready : starts the pipeline, retried while the device is busy.
+     *
+     * @param device_sn device serial number.
+     * @param timeout_ms max wait in ms.
+     */
+    bool wait_for_sensor(const std::string &device_sn, const int &timeout_ms);
+    bool wait_for_frameset(const std::string &device_sn, const int &timeout_ms);
+    bool start_when_ready(const std::string &device_sn, const int &timeout_ms);
+
+    /**
+     * @brief sets the duration of a readiness wait in the metrics
+     * (<name>_ready_ms) and adds the difference to the fixed delay it
+     * replaces to ready_saved_ms.
+     *
+     * @param device_sn device serial number.
+     * @param name name of the wait.
+     * @param fixed_ms fixed delay that was used before.
+     * @param t0 start of the wait.
+     */
+    void ready_wait(const std::string &device_sn,
+                    const std::string &name,
+                    const double &fixed_ms,
+                    const std::chrono::steady_clock::time_point &t0);
+
     /**
      * @brief configures the rs stream + sensor.
      *
+     * The color/depth sensor and ir emitter configs only set the options in
+     * 'sensor_options', they are applied before the pipeline starts and
+     * verified by 'configure_color_depth_sensor' once it streams.
+     *
      * @param device_sn device serial number.
      */
     void configure_color_stream_config(const std::string &device_sn);
@@ -209,6 +403,20 @@ private:
     void configure_color_depth_sensor(const std::string &device_sn);
     void configure_ir_emitter(const std::string &device_sn);
 
+    /**
+     * @brief applies 'sensor_options' to the sensors of the device, the
+     * failed options are set in the metrics (options_failed).
+     *
+     * @param device_sn device serial number.
+     * @param device rs2 device, if not given it is resolved from the config
+     *               of the device before the pipeline starts.
+     * @return int number of options that did not take effect, -1 if the
+     *             device could not be resolved.
+     */
+    int apply_sensor_options(const std::string &device_sn);
+    int apply_sensor_options(const std::string &device_sn,
+                             const rs2::device &device);
+
     /**
      * @brief processes the color and depth streams.
      *
@@ -222,28 +430,158 @@ private:
      * - 2 : depth stream error
      * - 3 : color and depth stream error.
      * Reset counter increment only in 'step(...)' .
+     * A stream without a new frame ('has_color'/'has_depth' false, the
+     * slower stream) is skipped and its timestamp is -1.
      *
      * @param device_sn device serial number.
      * @param frameset rs2 frameset object, contains multiple frames.
      * @param global_timestamp timestamp from chrono.
+     * @param frame_idx index of the frameset in its trial, for the fan-out.
      * @param timestamp timestamp from rs.
+     * @param save whether to save the frame, it is only checked if false.
      */
     bool process_color_stream(const std::string &device_sn,
                               const rs2::frameset &frameset,
                               const int64_t &global_timestamp,
-                              rs2_metadata_type &timestamp);
+                              const int64_t &frame_idx,
+                              rs2_metadata_type &timestamp,
+                              const bool &save = true);
     bool process_depth_stream(const std::string &device_sn,
                               const rs2::frameset &frameset,
                               const int64_t &global_timestamp,
-                              rs2_metadata_type &timestamp);
+                              const int64_t &frame_idx,
+                              rs2_metadata_type &timestamp,
+                              const bool &save = true);
     int process_color_depth_stream(const std::string &device_sn,
                                    const rs2::frameset &frameset,
                                    const int64_t &global_timestamp,
+                                   const int64_t &frame_idx,
                                    rs2_metadata_type &color_timestamp,
-                                   rs2_metadata_type &depth_timestamp);
+                                   rs2_metadata_type &depth_timestamp,
+                                   const bool &save = true,
+                                   const bool &has_color = true,
+                                   const bool &has_depth = true);
+
+    /**
+     * @brief saves the frame data + metadata of a frame.
+     *
+     * @param device_sn device serial number.
+     * @param frame rs2 frame of the color/depth stream.
+     * @param global_timestamp timestamp from chrono, used as filename.
+     * @param frame_idx index of the frameset in its trial, taken when it
+     *                  was captured, it picks the fan-out shard.
+     */
+    void save_color_frame(const std::string &device_sn,
+                          const rs2::frame &frame,
+                          const int64_t &global_timestamp,
+                          const int64_t &frame_idx);
+    void save_depth_frame(const std::string &device_sn,
+                          const rs2::frame &frame,
+                          const int64_t &global_timestamp,
+                          const int64_t &frame_idx);
+
+    /**
+     * @brief filters the depth frame and saves it into 'depth_filtered'.
+     *
+     * @param device_sn device serial number.
+     * @param frame rs2 frame of the depth stream.
+     * @param global_timestamp timestamp from chrono, used as filename.
+     * @param frame_idx index of the frameset in its trial.
+     */
+    void save_filtered_depth_frame(const std::string &device_sn,
+                                   const rs2::frame &frame,
+                                   const int64_t &global_timestamp,
+                                   const int64_t &frame_idx);
 
     /**
-     * @brief aligns the frameset to either color or depth.
+     * @brief runs the depth filters of the device into 'filtered_depths'
+     * and writes the result.
+     *
+     * @param device_sn device serial number.
+     * @param depth Z16 depth data.
+     * @param width width of the depth.
+     * @param height height of the depth.
+     * @param stride bytes per row of the depth.
+     * @param bin_file output file, its folder has to exist.
+     */
+    void filter_depth_frame(const std::string &device_sn,
+                            const uint16_t *depth,
+                            const int &width,
+                            const int &height,
+                            const int &stride,
+                            const std::string &bin_file);
+
+    /**
+     * @brief deprojects the saved depth (filtered if it is saved) and writes
+     * it as a .ply into 'pointcloud'. Must be called after 'save_depth_frame'.
+     *
+     * @param device_sn device serial number.
+     * @param frameset rs2 frameset (from align_frameset).
+     * @param global_timestamp timestamp from chrono, used as filename.
+     * @param frame_idx index of the frameset in its trial.
+     */
+    void save_pointcloud(const std::string &device_sn,
+                         const rs2::frameset &frameset,
+                         const int64_t &global_timestamp,
+                         const int64_t &frame_idx);
+
+    /**
+     * @brief fuses the point clouds of all devices of a step into the world
+     * frame and writes them into <save_path>/fusion/<trial_idx> (fanned out)
+     * on the writer thread.
+     * A step where a device saved no point cloud is skipped.
+     *
+     */
+    void fuse_pointclouds();
+
+    /**
+     * @brief decides through the motion gate whether a frameset is saved.
+     *
+     * @param device_sn device serial number.
+     * @param frameset rs2 frameset object, contains multiple frames.
+     * @param global_timestamp timestamp from chrono.
+     * @return motiongate::decision, always STORE if no gate is used.
+     */
+    motiongate::decision query_motion_decision(const std::string &device_sn,
+                                               const rs2::frameset &frameset,
+                                               const int64_t &global_timestamp);
+
+    /**
+     * @brief decides whether a frameset is saved, combines the motion gate
+     * with the trigger in trigger record mode.
+     *
+     * @param device_sn device serial number.
+     * @param frameset rs2 frameset object, contains multiple frames.
+     * @param global_timestamp timestamp from chrono.
+     * @return motiongate::decision, STORE_WITH_PRE_ROLL also saves the ring.
+     */
+    motiongate::decision query_record_decision(const std::string &device_sn,
+                                               const rs2::frameset &frameset,
+                                               const int64_t &global_timestamp);
+
+    /**
+     * @brief handles the ring of framesets of the motion gate / trigger.
+     *
+     * buffer_frameset : adds a frameset to the ring, 'with_pre_roll' marks
+     *                   the framesets in the ring to be saved.
+     * drain_ring : saves the marked framesets and logs the expired ones as
+     *              skipped in the timestamp file. 'flush' empties the ring.
+     *
+     * @param device_sn device serial number.
+     * @param record the frameset with its timestamps.
+     * @param global_timestamp timestamp from chrono.
+     */
+    void buffer_frameset(const std::string &device_sn,
+                         frameset_record &record,
+                         const bool &with_pre_roll);
+    void drain_ring(const std::string &device_sn,
+                    const int64_t &global_timestamp,
+                    const bool &flush);
+
+    /**
+     * @brief aligns the frameset to either color or depth. In mode 1 the
+     * depth is aligned to color only if both have the same resolution,
+     * the frameset is passed through otherwise.
      *
      * @param device_sn device serial number.
      * @param frameset rs2 frameset object, contains multiple frames.
@@ -256,6 +594,65 @@ private:
                         rs2::frameset &aligned_frameset,
                         const int &mode = 0);
 
+    /**
+     * @brief intrinsics of the saved depth, the color ones if the depth is
+     * aligned to color, its own ones otherwise.
+     *
+     * @param device_sn device serial number.
+     * @return rs2_intrinsics
+     */
+    rs2_intrinsics query_saved_depth_intrinsics(const std::string &device_sn);
+
+    /**
+     * @brief timestamp of a frameset used by the frameset sync (--sync).
+     *
+     * host : 'global_timestamp'.
+     * sensor : sensor timestamp corrected by the clock model, else
+     *          'global_timestamp' while there is no model.
+     *
+     * @param corrected_timestamp from 'update_clock_model', -1 if none.
+     * @param global_timestamp timestamp from chrono.
+     * @return int64_t ns
+     */
+    int64_t query_sync_timestamp(const int64_t &corrected_timestamp,
+                                 const int64_t &global_timestamp);
+
+    /**
+     * @brief feeds the clock model of the device with a frame and returns
+     * its sensor timestamp in the host domain ('global_timestamp').
+     * Whenever the model is refitted its drift is set in the metrics and
+     * the model is appended to 'clock'/clock.txt as
+     * <global_timestamp>::<sensor_reference_ns>::<offset_ns>::<slope>
+     * (host = offset + slope * (sensor - sensor_reference)).
+     *
+     * @param device_sn device serial number.
+     * @param sensor_timestamp from 'query_frame_timestamp'.
+     * @param global_timestamp timestamp from chrono, arrival of the frame.
+     * @return int64_t ns, -1 if the frame has no sensor timestamp.
+     */
+    int64_t update_clock_model(const std::string &device_sn,
+                               const rs2_metadata_type &sensor_timestamp,
+                               const int64_t &global_timestamp);
+
+    /**
+     * @brief updates the frame counter gaps + timestamp jitter of a stream
+     * with a frame, and publishes them in the metrics (once per second):
+     * <stream>_dropped, <stream>_drop_rate, <stream>_jitter_rms_ms and
+     * <stream>_jitter_max_ms (since the last publish).
+     *
+     * @param device_sn device serial number.
+     * @param frame the frame.
+     * @param timestamp from 'query_frame_timestamp'.
+     * @param dropped frames dropped before this frame.
+     * @param jitter_us interval deviation from the nominal period in us.
+     */
+    void update_gaps(const std::string &device_sn,
+                     const rs2::frame &frame,
+                     const rs2_metadata_type &timestamp,
+                     int64_t &dropped,
+                     int64_t &jitter_us);
+    void publish_gaps(const std::string &device_sn);
+
     /**
      * @brief query the timestamp mode.
      *
@@ -288,6 +685,8 @@ private:
 
     // Args from CLI
     rs2args args;
+    // Args parsed once, per device stream settings.
+    rs2config config;
 
     // Device data
     std::shared_ptr<rs2::context> ctx;
@@ -299,11 +698,14 @@ private:
 
     // Configurations
     std::map<std::string, rs2::config> rs_cfg;
+    std::map<std::string, sensoroptions> sensor_options;
     std::map<std::string, stream_config> stream_config_colors;
     std::map<std::string, stream_config> stream_config_depths;
 
     // Paths for saving data
     storagepath storagepaths;
+    std::shared_ptr<storagerotator> rotator;
+    int storage_generation = -1;
 
     // Timestamp data
     int camera_temp_printout_interval = 0;
@@ -313,9 +715,74 @@ private:
     // Declare depth colorizer for pretty visualization of depth data
     rs2::colorizer color_map;
 
+    // Motion gated recording.
+    std::map<std::string, std::shared_ptr<motiongate>> motion_gates;
+
+    // Frames that are not saved (yet), used by the motion gate and trigger.
+    std::map<std::string, std::shared_ptr<framesetring>> rings;
+    std::map<std::string, uint64_t> trigger_generations;
+    std::map<std::string, int64_t> trigger_record_until;
+    int ring_drain_per_step = 2;
+
+    // Depth filters, run on a pool that can be shared by all wrappers.
+    std::shared_ptr<workerpool> pool;
+    std::map<std::string, std::shared_ptr<depthfilter>> depth_filters;
+    std::map<std::string, std::vector<uint16_t>> filtered_depths;
+    // runs the depth filters + their writes off the capture thread, for the
+    // devices without a point cloud.
+    std::shared_ptr<asyncwriter> filter_writer;
+
+    // Point clouds, on the same pool as the depth filters.
+    std::map<std::string, std::shared_ptr<pointcloud>> pointclouds;
+    std::map<std::string, std::shared_ptr<voxelgrid>> voxelgrids;
+
+    // Matching of the framesets of all devices.
+    std::shared_ptr<framesync> sync;
+
+    // Supported metadata fields of every stream profile.
+    metadatacache metadata_cache;
+
+    // Dropped frames + jitter of every stream (rs2_stream), and of the
+    // current frameset.
+    std::map<std::string, std::map<int, gaptracker>> gap_trackers;
+    std::map<std::string, framegaps> frame_gaps;
+
+    // Sensor clock -> host clock of every device.
+    std::map<std::string, std::shared_ptr<clockmodel>> clock_models;
+    std::map<std::string, int> clock_fit_counts;
+
+    // Devices that dropped off the bus (hot-plug) + their restart.
+    std::map<std::string, std::shared_ptr<device>> detached_devices;
+    std::map<std::string, std::chrono::steady_clock::time_point> detached_timestamps;
+    std::map<std::string, std::future<std::shared_ptr<device>>> reattach_futures;
+    // failed restarts + when the next one starts.
+    std::map<std::string, std::pair<int, std::chrono::steady_clock::time_point>> reattach_retries;
+
+    // Hardware resets, can be shared by all threads.
+    std::shared_ptr<resetservice> resets;
+
+    // Health of the devices + when they are reset, can be shared by all threads.
+    std::shared_ptr<resetscheduler> health;
+
+    // Temperatures + sensor options sampled in the background, can be
+    // shared by all threads. Index of the last sample given to 'health'.
+    std::shared_ptr<telemetrysampler> telemetry;
+    std::map<std::string, int64_t> telemetry_indices;
+
+    // Fusion of the point clouds of a step.
+    std::shared_ptr<cloudfusion> fusion;
+    std::map<std::string, fusionframe> fusion_frames;
+    // writes the fused point clouds off the capture thread.
+    std::shared_ptr<asyncwriter> fusion_writer;
+    int64_t fusion_ticks = 0;
+    // index of the next frameset of every device in the current trial.
+    std::map<std::string, int64_t> trial_frame_counters;
+
     // Alignment of data from different streams.
     rs2::align align_to_color = rs2::align(RS2_STREAM_COLOR);
     rs2::align align_to_depth = rs2::align(RS2_STREAM_DEPTH);
+    // depth + last color frame if the streams run at different fps.
+    std::shared_ptr<framesetcomposer> composer = std::make_shared<framesetcomposer>();
 
     // [INTERNAL] --------------------------------------------------------------
     // FPS counter
@@ -329,11 +796,6 @@ private:
     // Frame check, true if poll/wait returns a valid frame.
     std::map<std::string, bool> valid_frame_received_flags;
     std::map<std::string, int64_t> empty_frame_received_timers;
-    // IP Mapping
-    std::map<std::string, std::string> USBIP_MAPPING{
-        {"001622070408", "192.168.1.238"},
-        {"001622071039", "192.168.1.202"},
-        {"001622070717", "192.168.1.34"}};
     // -------------------------------------------------------------- [INTERNAL]
 
     // ------------------------------------------------------ [MEMBER VARIABLES]
@@ -0,0 +1,82 @@
+#include "startup.hpp"
+
+initscheduler::initscheduler(const int &max_concurrent,
+                             const int &max_retries,
+                             const int &backoff_ms)
+    : max_concurrent(max_concurrent),
+      max_retries(std::max(0, max_retries)),
+      backoff(std::max(0, backoff_ms))
+{
+}
+
+void initscheduler::run(const std::string &device_sn,
+                        const std::string &phase,
+                        const std::function<void()> &fn,
+                        const std::function<void()> &rollback)
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    metrics &m = metrics::instance();
+    std::chrono::milliseconds wait = backoff;
+
+    for (int attempt = 0;; attempt++)
+    {
+        acquire();
+        try
+        {
+            fn();
+            release();
+            break;
+        }
+        catch (const rs2::error &e)
+        {
+            if (rollback)
+            {
+                try
+                {
+                    rollback();
+                }
+                catch (const std::exception &)
+                {
+                }
+            }
+            release();
+            if (attempt >= max_retries)
+                throw;
+            print(device_sn + " " + phase + " failed (" + e.what() + "), retry " +
+                      std::to_string(attempt + 1) + " in " +
+                      std::to_string(wait.count()) + "ms",
+                  1);
+            m.add(device_sn, "init_retries", 1);
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+        std::this_thread::sleep_for(wait);
+        wait *= 2;
+    }
+
+    m.set(device_sn,
+          "init_" + phase + "_ms",
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - t0)
+              .count());
+}
+
+void initscheduler::acquire()
+{
+    std::unique_lock<std::mutex> lock(mux);
+    cv.wait(lock, [this]
+            { return max_concurrent <= 0 || running < max_concurrent; });
+    running++;
+}
+
+void initscheduler::release()
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        running--;
+    }
+    cv.notify_one();
+}
@@ -0,0 +1,68 @@
+#ifndef STARTUP_HPP
+#define STARTUP_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "utils.hpp"
+#include "metrics.hpp"
+
+/**
+ * @brief Schedules the initialization phases of the devices, shared by the
+ * threads of all devices.
+ *
+ * The devices are initialized concurrently, up to 'max_concurrent' at once
+ * (0 = no limit). A phase that fails with an rs2 error (e.g. libusb busy
+ * while another device is opened) is rolled back and retried after a
+ * backoff that doubles every attempt, without holding a slot.
+ * The duration of every phase (incl. waits and retries) is set in the
+ * metrics of the device as init_<phase>_ms, the retries as init_retries.
+ *
+ */
+class initscheduler
+{
+public:
+    /**
+     * @brief Construct a new initscheduler object
+     *
+     * @param max_concurrent max phases running at once, 0 = no limit.
+     * @param max_retries retries of a failing phase before it throws.
+     * @param backoff_ms wait before the first retry.
+     */
+    initscheduler(const int &max_concurrent,
+                  const int &max_retries,
+                  const int &backoff_ms);
+
+    /**
+     * @brief Runs a phase of a device, blocks until it is done.
+     *
+     * @param device_sn device serial number.
+     * @param phase name of the phase used in the metrics.
+     * @param fn the phase.
+     * @param rollback called (errors ignored) after a failed attempt.
+     */
+    void run(const std::string &device_sn,
+             const std::string &phase,
+             const std::function<void()> &fn,
+             const std::function<void()> &rollback = nullptr);
+
+private:
+    void acquire();
+    void release();
+
+    int max_concurrent;
+    int max_retries;
+    std::chrono::milliseconds backoff;
+
+    std::mutex mux;
+    std::condition_variable cv;
+    int running = 0;
+};
+
+#endif
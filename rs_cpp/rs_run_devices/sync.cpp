@@ -0,0 +1,186 @@
+#include "sync.hpp"
+
+framesync::framesync(const std::vector<std::string> &device_sns,
+                     const int64_t &tolerance_ns,
+                     const int64_t &max_wait_ns,
+                     const size_t &max_queue)
+    : device_sns(device_sns),
+      tolerance_ns(tolerance_ns),
+      max_wait(max_wait_ns),
+      max_queue(std::max((size_t)1, max_queue))
+{
+    for (auto const &device_sn : device_sns)
+        queues[device_sn];
+}
+
+framesync::~framesync()
+{
+    stop();
+}
+
+void framesync::add_consumer(const consumer &fn, const bool &with_frames)
+{
+    consumers.push_back(fn);
+    this->with_frames |= with_frames;
+}
+
+bool framesync::needs_frames()
+{
+    return with_frames;
+}
+
+void framesync::push(const std::string &device_sn,
+                     frameset_record record,
+                     const int64_t &sync_timestamp)
+{
+    if (with_frames)
+        record.frameset.keep();
+    else
+        record.frameset = rs2::frameset();
+    entry e;
+    e.sync_timestamp = sync_timestamp;
+    e.arrival = std::chrono::steady_clock::now();
+    e.record = record;
+
+    size_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        auto itr = queues.find(device_sn);
+        if (itr == queues.end())
+            return;
+        std::deque<entry> &queue = itr->second;
+        while (queue.size() >= max_queue)
+        {
+            queue.pop_front();
+            dropped++;
+        }
+        queue.push_back(e);
+    }
+    if (dropped > 0)
+        metrics::instance().add("sync", "frames_dropped", dropped);
+    cv.notify_one();
+}
+
+void framesync::start()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    if (running)
+        return;
+    running = true;
+    th = std::thread(&framesync::run, this);
+}
+
+void framesync::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        if (!running)
+            return;
+        running = false;
+    }
+    cv.notify_all();
+    th.join();
+}
+
+void framesync::run()
+{
+    std::unique_lock<std::mutex> lock(mux);
+    while (running)
+    {
+        syncbundle bundle;
+        std::chrono::steady_clock::time_point deadline;
+        int status = match(bundle, deadline);
+        if (status == 1)
+        {
+            lock.unlock();
+            metrics &m = metrics::instance();
+            m.add("sync", bundle.complete ? "bundles" : "bundles_partial", 1);
+            m.set("sync", "spread_ms", bundle.spread * 1e-6);
+            for (auto const &device_sn : device_sns)
+                if (bundle.framesets.find(device_sn) == bundle.framesets.end())
+                    m.add(device_sn, "sync_missed", 1);
+            for (auto &&fn : consumers)
+                fn(bundle);
+            lock.lock();
+        }
+        else if (status == 0)
+        {
+            cv.wait_until(lock, deadline);
+        }
+        else
+        {
+            cv.wait(lock);
+        }
+    }
+}
+
+int framesync::match(syncbundle &bundle,
+                     std::chrono::steady_clock::time_point &deadline)
+{
+    // 1. the earliest queued frameset is the reference.
+    std::string ref_sn;
+    for (auto const &queue : queues)
+        if (!queue.second.empty() &&
+            (ref_sn.empty() ||
+             queue.second.front().sync_timestamp <
+                 queues[ref_sn].front().sync_timestamp))
+            ref_sn = queue.first;
+    if (ref_sn.empty())
+        return -1;
+    const entry &ref = queues[ref_sn].front();
+
+    // 2. closest frameset of the other devices.
+    std::map<std::string, size_t> matches;
+    bool waiting = false;
+    for (auto const &queue : queues)
+    {
+        if (queue.first == ref_sn)
+            continue;
+        int64_t best = tolerance_ns + 1;
+        bool later = false;
+        for (size_t i = 0; i < queue.second.size(); i++)
+        {
+            int64_t diff = queue.second[i].sync_timestamp - ref.sync_timestamp;
+            if (std::abs(diff) < best)
+            {
+                best = std::abs(diff);
+                matches[queue.first] = i;
+            }
+            if (diff > tolerance_ns)
+                later = true;
+        }
+        // no match yet, but one may still come.
+        if (matches.find(queue.first) == matches.end() && !later)
+            waiting = true;
+    }
+    if (waiting && std::chrono::steady_clock::now() < ref.arrival + max_wait)
+    {
+        deadline = ref.arrival + max_wait;
+        return 0;
+    }
+
+    // 3. takes the matched framesets out, the ones before them are dropped.
+    int64_t min_ts = ref.sync_timestamp;
+    int64_t max_ts = ref.sync_timestamp;
+    bundle.timestamp = ref.sync_timestamp;
+    bundle.framesets[ref_sn] = ref.record;
+    bundle.sync_timestamps[ref_sn] = ref.sync_timestamp;
+    queues[ref_sn].pop_front();
+    size_t dropped = 0;
+    for (auto const &match : matches)
+    {
+        std::deque<entry> &queue = queues[match.first];
+        const entry &e = queue[match.second];
+        bundle.framesets[match.first] = e.record;
+        bundle.sync_timestamps[match.first] = e.sync_timestamp;
+        min_ts = std::min(min_ts, e.sync_timestamp);
+        max_ts = std::max(max_ts, e.sync_timestamp);
+        dropped += match.second;
+        queue.erase(queue.begin(), queue.begin() + match.second + 1);
+    }
+    if (dropped > 0)
+        metrics::instance().add("sync", "frames_dropped", dropped);
+    bundle.spread = max_ts - min_ts;
+    bundle.complete = bundle.framesets.size() == queues.size();
+    return 1;
+}
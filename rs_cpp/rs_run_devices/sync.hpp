@@ -0,0 +1,141 @@
+#ifndef SYNC_HPP
+#define SYNC_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+#include "rs_utils.hpp"
+#include "metrics.hpp"
+
+/**
+ * @brief Framesets of several devices that belong to the same instant.
+ *
+ */
+struct syncbundle
+{
+    // sync timestamp of the earliest frameset of the bundle, in ns.
+    int64_t timestamp = 0;
+    // max - min sync timestamp of the framesets in the bundle, in ns.
+    int64_t spread = 0;
+    // whether all devices are in the bundle.
+    bool complete = false;
+    std::map<std::string, frameset_record> framesets;
+    std::map<std::string, int64_t> sync_timestamps;
+};
+
+/**
+ * @brief Matches the framesets of several devices by timestamp.
+ *
+ * Every device pushes its framesets (from any thread) with a sync timestamp
+ * in a common time domain, e.g. the host arrival time. A matcher thread
+ * takes the earliest frameset that is queued and looks for the closest
+ * frameset of every other device within +-tolerance:
+ * - all devices matched : complete bundle.
+ * - a device has no frameset within the tolerance but a later one : it
+ *   missed this instant, partial bundle.
+ * - a device has no frameset yet : waits up to 'max_wait' after the arrival
+ *   of the earliest frameset for the straggler, then a partial bundle.
+ * The bundles are passed to the consumers on the matcher thread.
+ * The queue of a device is bounded, the oldest framesets are dropped.
+ * Stats are published in the metrics under "sync" (+ per device misses).
+ *
+ */
+class framesync
+{
+public:
+    typedef std::function<void(const syncbundle &)> consumer;
+
+    /**
+     * @brief Construct a new framesync object
+     *
+     * @param device_sns devices to be matched.
+     * @param tolerance_ns max distance of a frameset to the bundle timestamp.
+     * @param max_wait_ns max wait for a straggler.
+     * @param max_queue max framesets queued per device.
+     */
+    framesync(const std::vector<std::string> &device_sns,
+              const int64_t &tolerance_ns,
+              const int64_t &max_wait_ns,
+              const size_t &max_queue = 4);
+    ~framesync();
+
+    /**
+     * @brief Adds a consumer of the bundles, before 'start'.
+     *
+     * @param fn called for every bundle.
+     * @param with_frames whether it reads the frames of the framesets.
+     */
+    void add_consumer(const consumer &fn, const bool &with_frames = false);
+
+    /**
+     * @brief Whether a consumer reads the frames. If not, the framesets are
+     * queued without their frames, so they do not hold the frame pool of
+     * librealsense.
+     *
+     * @return true
+     * @return false
+     */
+    bool needs_frames();
+
+    /**
+     * @brief Queues a frameset of a device. The frames are kept if a
+     * consumer needs them, dropped otherwise.
+     *
+     * @param device_sn device serial number.
+     * @param record frameset with its timestamps.
+     * @param sync_timestamp timestamp in ns used for the matching.
+     */
+    void push(const std::string &device_sn,
+              frameset_record record,
+              const int64_t &sync_timestamp);
+
+    void start();
+    void stop();
+
+private:
+    struct entry
+    {
+        int64_t sync_timestamp;
+        std::chrono::steady_clock::time_point arrival;
+        frameset_record record;
+    };
+
+    void run();
+
+    /**
+     * @brief Tries to build the next bundle. Must hold 'mux'.
+     *
+     * @param bundle the bundle, if one is ready.
+     * @param deadline when to try again if the bundle waits for a straggler.
+     * @return int 1 bundle ready, 0 waiting until 'deadline', -1 nothing queued.
+     */
+    int match(syncbundle &bundle, std::chrono::steady_clock::time_point &deadline);
+
+    std::vector<std::string> device_sns;
+    int64_t tolerance_ns;
+    std::chrono::nanoseconds max_wait;
+    size_t max_queue;
+    std::vector<consumer> consumers;
+    bool with_frames = false;
+
+    std::mutex mux;
+    std::condition_variable cv;
+    std::thread th;
+    bool running = false;
+    std::map<std::string, std::deque<entry>> queues;
+};
+
+#endif
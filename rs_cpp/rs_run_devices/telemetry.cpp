@@ -0,0 +1,179 @@
+#include "telemetry.hpp"
+
+/**
+ * @brief Reads an option of a sensor, -1 if it is not supported.
+ *
+ */
+static float query_option(const rs2::sensor *sensor, const rs2_option &option)
+{
+    if (sensor == nullptr || !sensor->supports(option))
+        return -1.0f;
+    return sensor->get_option(option);
+}
+
+telemetrysampler::telemetrysampler(const int &interval_ms,
+                                   const int &printout_interval_ms)
+    : interval(std::max(1, interval_ms)),
+      printout_interval(printout_interval_ms),
+      reference(std::chrono::steady_clock::now())
+{
+}
+
+telemetrysampler::~telemetrysampler()
+{
+    stop();
+}
+
+void telemetrysampler::add(const std::string &device_sn,
+                           std::shared_ptr<rs2::color_sensor> color_sensor,
+                           std::shared_ptr<rs2::depth_sensor> depth_sensor)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    source &src = sources[device_sn];
+    src.color_sensor = color_sensor;
+    src.depth_sensor = depth_sensor;
+}
+
+void telemetrysampler::remove(const std::string &device_sn)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    sources.erase(device_sn);
+}
+
+void telemetrysampler::set_log(const std::string &device_sn, const std::string &filename)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    sources[device_sn].log = filename;
+}
+
+void telemetrysampler::set_reference(const std::chrono::steady_clock::time_point &global_timestamp)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    reference = global_timestamp;
+}
+
+bool telemetrysampler::latest(const std::string &device_sn, sample &s)
+{
+    std::lock_guard<std::mutex> guard(mux);
+    auto itr = sources.find(device_sn);
+    if (itr == sources.end() || itr->second.last.index < 0)
+        return false;
+    s = itr->second.last;
+    return true;
+}
+
+void telemetrysampler::start()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    if (running)
+        return;
+    running = true;
+    th = std::thread(&telemetrysampler::run, this);
+}
+
+void telemetrysampler::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        if (!running)
+            return;
+        running = false;
+    }
+    cv.notify_all();
+    th.join();
+}
+
+void telemetrysampler::run()
+{
+    // Normal priority, it sleeps between the samples. At SCHED_IDLE the busy
+    // capture threads could starve it.
+    std::unique_lock<std::mutex> lock(mux);
+    while (running)
+    {
+        std::chrono::steady_clock::time_point next =
+            std::chrono::steady_clock::now() + interval;
+
+        // the control transfers run without the lock, 'add' and 'remove'
+        // are not blocked by a slow device.
+        std::map<std::string, source> _sources = sources;
+        std::chrono::steady_clock::time_point _reference = reference;
+        lock.unlock();
+
+        std::map<std::string, sample> samples;
+        for (auto const &entry : _sources)
+        {
+            sample s;
+            s.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - _reference)
+                              .count();
+            try
+            {
+                collect(entry.first, entry.second, s);
+            }
+            catch (const rs2::error &)
+            {
+                // the device may be resetting, it is sampled next time.
+                continue;
+            }
+            samples[entry.first] = s;
+
+            if (!entry.second.log.empty())
+            {
+                std::ofstream txt(entry.second.log, std::ofstream::app);
+                txt << s.timestamp
+                    << "::" << s.asic_temperature
+                    << "::" << s.projector_temperature
+                    << "::" << s.laser_power
+                    << "::" << s.exposure
+                    << "::" << s.gain
+                    << "\n";
+            }
+        }
+
+        lock.lock();
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (auto &&entry : samples)
+        {
+            // removed while it was sampled.
+            auto itr = sources.find(entry.first);
+            if (itr == sources.end())
+                continue;
+            entry.second.index = itr->second.last.index + 1;
+            itr->second.last = entry.second;
+
+            if (printout_interval.count() > 0 &&
+                now - itr->second.last_printout >= printout_interval)
+            {
+                itr->second.last_printout = now;
+                print(entry.first + " Temperature ASIC      : " + std::to_string(entry.second.asic_temperature), 0);
+                print(entry.first + " Temperature Projector : " + std::to_string(entry.second.projector_temperature), 0);
+            }
+        }
+
+        // a slow round is followed by a full interval, it never spins.
+        if (next < now)
+            next = now + interval;
+        cv.wait_until(lock, next, [this]
+                      { return !running; });
+    }
+}
+
+void telemetrysampler::collect(const std::string &device_sn,
+                               const source &src,
+                               sample &s)
+{
+    const rs2::sensor *css = src.color_sensor.get();
+    const rs2::sensor *dss = src.depth_sensor.get();
+    s.asic_temperature = query_option(dss, RS2_OPTION_ASIC_TEMPERATURE);
+    s.projector_temperature = query_option(dss, RS2_OPTION_PROJECTOR_TEMPERATURE);
+    s.laser_power = query_option(dss, RS2_OPTION_LASER_POWER);
+    s.exposure = query_option(css, RS2_OPTION_EXPOSURE);
+    s.gain = query_option(css, RS2_OPTION_GAIN);
+
+    metrics &m = metrics::instance();
+    m.set(device_sn, "asic_temperature", s.asic_temperature);
+    m.set(device_sn, "projector_temperature", s.projector_temperature);
+    m.set(device_sn, "laser_power", s.laser_power);
+    m.set(device_sn, "exposure", s.exposure);
+    m.set(device_sn, "gain", s.gain);
+}
@@ -0,0 +1,121 @@
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <librealsense2/rs.hpp>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "utils.hpp"
+#include "metrics.hpp"
+
+/**
+ * @brief Samples the temperatures and sensor options of the devices on a
+ * background thread that sleeps between the samples, so that the USB
+ * control transfers of 'get_option' never run on the capture threads.
+ *
+ * Every 'interval_ms' a sample of each device is:
+ * - set in the metrics of the device,
+ * - appended to its log, one "global_timestamp::asic_temperature::
+ *   projector_temperature::laser_power::exposure::gain" line per sample
+ *   (-1 if the device does not support it),
+ * - kept as the latest sample, see 'latest'.
+ *
+ */
+class telemetrysampler
+{
+public:
+    struct sample
+    {
+        int64_t index = -1; // increases with every sample of the device.
+        int64_t timestamp = 0; // global timestamp in ns.
+        float asic_temperature = -1.0f;
+        float projector_temperature = -1.0f;
+        float laser_power = -1.0f;
+        float exposure = -1.0f;
+        float gain = -1.0f;
+    };
+
+    /**
+     * @brief Construct a new telemetrysampler object
+     *
+     * @param interval_ms interval between 2 samples of a device.
+     * @param printout_interval_ms interval of the temperature printouts, 0
+     *                             disables them.
+     */
+    telemetrysampler(const int &interval_ms, const int &printout_interval_ms);
+    ~telemetrysampler();
+
+    /**
+     * @brief Adds (or replaces) the sensors of a device.
+     *
+     * @param device_sn device serial number.
+     * @param color_sensor color sensor, can be nullptr.
+     * @param depth_sensor depth sensor, can be nullptr.
+     */
+    void add(const std::string &device_sn,
+             std::shared_ptr<rs2::color_sensor> color_sensor,
+             std::shared_ptr<rs2::depth_sensor> depth_sensor);
+    void remove(const std::string &device_sn);
+
+    /**
+     * @brief Log file of a device, "" disables the log.
+     *
+     * @param device_sn device serial number.
+     * @param filename log file.
+     */
+    void set_log(const std::string &device_sn, const std::string &filename);
+
+    /**
+     * @brief Start of the global timestamps of the samples.
+     *
+     * @param global_timestamp steady clock time point.
+     */
+    void set_reference(const std::chrono::steady_clock::time_point &global_timestamp);
+
+    /**
+     * @brief Latest sample of a device.
+     *
+     * @param device_sn device serial number.
+     * @param s the sample.
+     * @return bool false if the device has no sample yet.
+     */
+    bool latest(const std::string &device_sn, sample &s);
+
+    void start();
+    void stop();
+
+private:
+    struct source
+    {
+        std::shared_ptr<rs2::color_sensor> color_sensor;
+        std::shared_ptr<rs2::depth_sensor> depth_sensor;
+        std::string log;
+        sample last;
+        std::chrono::steady_clock::time_point last_printout;
+    };
+
+    void run();
+    void collect(const std::string &device_sn, const source &src, sample &s);
+
+    std::chrono::milliseconds interval;
+    std::chrono::milliseconds printout_interval;
+    std::chrono::steady_clock::time_point reference;
+
+    std::mutex mux;
+    std::condition_variable cv;
+    std::thread th;
+    bool running = false;
+    std::map<std::string, source> sources;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "trigger.hpp"
+
+eventtrigger::eventtrigger()
+    : all_generation(0),
+      socket_running(false)
+{
+}
+
+eventtrigger::~eventtrigger()
+{
+    stop_socket();
+}
+
+eventtrigger &eventtrigger::instance()
+{
+    static eventtrigger _eventtrigger;
+    return _eventtrigger;
+}
+
+void eventtrigger::fire(const std::string &device_sn)
+{
+    if (device_sn.empty() || device_sn == "all")
+    {
+        all_generation++;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        device_generations[device_sn] += 1;
+    }
+    metrics::instance().add("trigger", "fired", 1);
+}
+
+void eventtrigger::fire_from_signal()
+{
+    // No locks and no prints in here, the metrics are updated by the
+    // capture thread that sees the new generation.
+    all_generation++;
+}
+
+uint64_t eventtrigger::generation(const std::string &device_sn)
+{
+    uint64_t _generation = all_generation;
+    std::lock_guard<std::mutex> guard(mux);
+    auto itr = device_generations.find(device_sn);
+    if (itr != device_generations.end())
+        _generation += itr->second;
+    return _generation;
+}
+
+bool eventtrigger::start_socket(const std::string &socket_path)
+{
+    if (socket_running)
+        return true;
+
+    struct sockaddr_un addr;
+    if (socket_path.size() >= sizeof(addr.sun_path))
+    {
+        print("trigger socket path is too long : " + socket_path, 2);
+        return false;
+    }
+
+    socket_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (socket_fd < 0)
+    {
+        print("trigger socket could not be created : " +
+                  std::string(strerror(errno)),
+              2);
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (bind(socket_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        print("trigger socket could not be bound to " + socket_path + " : " +
+                  std::string(strerror(errno)),
+              2);
+        close(socket_fd);
+        socket_fd = -1;
+        return false;
+    }
+
+    this->socket_path = socket_path;
+    socket_running = true;
+    socket_worker = std::thread(&eventtrigger::run_socket, this);
+    print("listening for triggers on " + socket_path, 0);
+    return true;
+}
+
+void eventtrigger::stop_socket()
+{
+    if (!socket_running)
+        return;
+    socket_running = false;
+    if (socket_worker.joinable())
+        socket_worker.join();
+    close(socket_fd);
+    unlink(socket_path.c_str());
+    socket_fd = -1;
+}
+
+void eventtrigger::run_socket()
+{
+    char buffer[256];
+    struct pollfd pfd;
+    pfd.fd = socket_fd;
+    pfd.events = POLLIN;
+
+    while (socket_running)
+    {
+        // Wakes up regularly to check whether the listener is stopped.
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 200) <= 0 || !(pfd.revents & POLLIN))
+            continue;
+
+        ssize_t n = recv(socket_fd, buffer, sizeof(buffer) - 1, 0);
+        if (n < 0)
+            continue;
+        buffer[n] = '\0';
+
+        std::string device_sn(buffer);
+        device_sn.erase(device_sn.find_last_not_of(" \t\r\n") + 1);
+        device_sn.erase(0, device_sn.find_first_not_of(" \t\r\n"));
+        fire(device_sn);
+        print("trigger received : " + (device_sn.empty() ? "all" : device_sn), 0);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef TRIGGER_HPP
+#define TRIGGER_HPP
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "utils.hpp"
+#include "metrics.hpp"
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "the trigger of a signal handler needs a lock-free 32 bit atomic");
+
+/**
+ * @brief Process wide source of recording triggers.
+ *
+ * A trigger is published as a generation counter, either for all devices or
+ * for a single device. The capture threads compare the counter of their
+ * device once per step and start recording when it changes.
+ *
+ * Triggers can come from:
+ * - a signal handler : 'fire_from_signal()' (e.g. SIGUSR1, async-signal-safe).
+ * - a local socket   : datagrams sent to a unix socket, the message is either
+ *                      empty / "all" or a device serial number.
+ * - a detector hook  : 'fire()' called from code, e.g. the motion gate.
+ *
+ */
+class eventtrigger
+{
+public:
+    /**
+     * @brief Returns the global trigger source.
+     *
+     * @return eventtrigger&
+     */
+    static eventtrigger &instance();
+
+    /**
+     * @brief Triggers the recording.
+     *
+     * @param device_sn device serial number, empty triggers all devices.
+     */
+    void fire(const std::string &device_sn = "");
+
+    /**
+     * @brief Triggers the recording of all devices, lock-free so that it can
+     * be called from a signal handler.
+     *
+     */
+    void fire_from_signal();
+
+    /**
+     * @brief Increases every time the device is triggered.
+     *
+     * @param device_sn device serial number.
+     * @return uint64_t
+     */
+    uint64_t generation(const std::string &device_sn);
+
+    /**
+     * @brief Starts a thread that listens on a unix datagram socket.
+     *
+     * @param socket_path path of the socket, an existing file is replaced.
+     * @return bool whether the socket could be created.
+     */
+    bool start_socket(const std::string &socket_path);
+    void stop_socket();
+
+private:
+    eventtrigger();
+    ~eventtrigger();
+    eventtrigger(const eventtrigger &) = delete;
+    eventtrigger &operator=(const eventtrigger &) = delete;
+
+    void run_socket();
+
+    // 32 bit so that it is lock-free (and so async-signal-safe) on the
+    // 32 bit targets as well.
+    std::atomic<uint32_t> all_generation;
+    std::mutex mux;
+    std::map<std::string, uint64_t> device_generations;
+
+    int socket_fd = -1;
+    std::string socket_path;
+    std::thread socket_worker;
+    std::atomic<bool> socket_running;
+};
+
+#endif
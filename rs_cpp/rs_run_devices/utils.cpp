@@ -65,6 +65,10 @@ argparser::argparser(int argc, char *argv[])
 {
     for (int i = 1; i < argc; ++i)
         args.push_back(std::string(argv[i]));
+    // the first occurrence of an option is used.
+    for (size_t i = 0; i < args.size(); ++i)
+        if (argmap.count(args[i]) == 0)
+            argmap[args[i]] = i + 1 < args.size() ? args[i + 1] : "";
 }
 
 argparser::~argparser()
@@ -73,11 +77,10 @@ argparser::~argparser()
 
 std::string argparser::getarg(const std::string &option)
 {
-    std::vector<std::string>::const_iterator itr;
-    itr = std::find(args.begin(), args.end(), option);
-    if (itr != args.end() && ++itr != args.end())
+    std::map<std::string, std::string>::const_iterator itr = argmap.find(option);
+    if (itr != argmap.end())
     {
-        return *itr;
+        return itr->second;
     }
     static const std::string empty_string("");
     return empty_string;
@@ -88,6 +91,11 @@ int argparser::getargi(const std::string &option)
     return std::stoi(getarg(option));
 }
 
+float argparser::getargf(const std::string &option)
+{
+    return std::stof(getarg(option));
+}
+
 bool argparser::getargb(const std::string &option)
 {
     return stob(getarg(option));
@@ -95,7 +103,13 @@ bool argparser::getargb(const std::string &option)
 
 bool argparser::checkarg(const std::string &option)
 {
-    return std::find(args.begin(), args.end(), option) != args.end();
+    return argmap.find(option) != argmap.end();
+}
+
+void argparser::setdefault(const std::string &option, const std::string &value)
+{
+    if (argmap.count(option) == 0)
+        argmap[option] = value;
 }
 
 void argparser::printout()
@@ -103,7 +117,8 @@ void argparser::printout()
     std::cout << ("\n" + std::string(80, '=')) << std::endl;
     std::cout << ">>>>> args <<<<<" << std::endl;
     std::cout << std::string(80, '=') << std::endl;
-    for (int i = 0; i < args.size(); i += 2)
-        std::cout << args[i] + " : " + args[i + 1] << std::endl;
+    for (auto const &arg : argmap)
+        if (arg.first.compare(0, 2, "--") == 0)
+            std::cout << arg.first + " : " + arg.second << std::endl;
     std::cout << (std::string(80, '=') + "\n") << std::endl;
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <chrono>
 #include <thread>
 #include <algorithm>
+#include <map>
 #include <vector>
 
 /**
@@ -54,6 +55,8 @@ int64_t get_timestamp_duration_ns(const std::chrono::steady_clock::time_point &t
 class argparser
 {
     std::vector<std::string> args;
+    // option > value, parsed once in the constructor.
+    std::map<std::string, std::string> argmap;
 
 public:
     argparser();
@@ -61,8 +64,18 @@ public:
     ~argparser();
     std::string getarg(const std::string &option);
     int getargi(const std::string &option);
+    float getargf(const std::string &option);
     bool getargb(const std::string &option);
     bool checkarg(const std::string &option);
+
+    /**
+     * @brief Sets the value of an option that is not given yet, e.g. from a
+     * config file, so that the command line has the priority.
+     *
+     * @param option e.g. '--fps'.
+     * @param value value of the option.
+     */
+    void setdefault(const std::string &option, const std::string &value);
     void printout();
 };
 
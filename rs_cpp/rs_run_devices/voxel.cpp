@@ -0,0 +1,354 @@
+#include "voxel.hpp"
+
+// Points per tile and number of partitions, fixed so the output does not
+// depend on the number of threads.
+static const size_t TILE_SIZE = 16384;
+static const int NUM_PARTITIONS = 16;
+static const int PARTITION_BITS = 4;
+
+static const uint64_t EMPTY_KEY = ~0ULL;
+// 21 bits per axis, +-2^20 voxels around the origin.
+static const int64_t KEY_OFFSET = 1 << 20;
+static const int64_t KEY_MAX = (1 << 21) - 1;
+
+/**
+ * @brief Packs the voxel coordinates of a point into a key.
+ *
+ * @param p x,y,z.
+ * @param inv_voxel_size 1 / voxel size.
+ * @param key packed voxel coordinates.
+ * @return bool false if the point is not finite or out of range.
+ */
+static inline bool voxel_key(const float *p, const float &inv_voxel_size, uint64_t &key)
+{
+    key = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        float v = p[i] * inv_voxel_size;
+        // also false for nan.
+        if (!(v >= -KEY_OFFSET && v < KEY_OFFSET))
+            return false;
+        // floor without the libm call.
+        int32_t q = (int32_t)v;
+        q -= v < q;
+        key = (key << 21) | (uint64_t)(q + KEY_OFFSET);
+    }
+    return true;
+}
+
+static inline uint64_t voxel_hash(const uint64_t &key)
+{
+    return key * 0x9E3779B97F4A7C15ULL;
+}
+
+void voxelgrid::table::reset(const size_t &capacity)
+{
+    size_t cap = 16;
+    while (cap < 2 * capacity)
+        cap <<= 1;
+    keys.assign(cap, EMPTY_KEY);
+    slots.resize(cap);
+    voxels.clear();
+}
+
+voxelgrid::voxel &voxelgrid::table::find_or_insert(const uint64_t &key,
+                                                   const uint64_t &hash,
+                                                   bool &inserted)
+{
+    // the top bits select the partition, the ones below the slot.
+    size_t mask = keys.size() - 1;
+    size_t i = (size_t)(hash >> (64 - PARTITION_BITS - 28)) & mask;
+    while (true)
+    {
+        if (keys[i] == key)
+        {
+            inserted = false;
+            return voxels[slots[i]];
+        }
+        if (keys[i] == EMPTY_KEY)
+        {
+            keys[i] = key;
+            slots[i] = (uint32_t)voxels.size();
+            voxels.push_back(voxel());
+            inserted = true;
+            return voxels.back();
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+voxelgrid::voxelgrid(const float &voxel_size,
+                     const reduction &mode,
+                     workerpool *pool)
+    : mode(mode), pool(pool)
+{
+    set_voxel_size(voxel_size);
+}
+
+void voxelgrid::set_voxel_size(const float &voxel_size)
+{
+    if (voxel_size <= 0.0f)
+        throw std::invalid_argument("voxel size must be > 0");
+    inv_voxel_size = 1.0f / voxel_size;
+}
+
+void voxelgrid::set_reduction(const reduction &mode)
+{
+    this->mode = mode;
+}
+
+voxelgrid::reduction voxelgrid::reduction_from_string(const std::string &name)
+{
+    if (name == "centroid")
+        return CENTROID;
+    else if (name == "first")
+        return FIRST;
+    else
+        throw std::invalid_argument("voxel reduction unknown : " + name);
+}
+
+void voxelgrid::bin_tile(table &tile,
+                         const size_t &begin,
+                         const size_t &end)
+{
+    tile.reset(std::min(end - begin, (size_t)TILE_SIZE));
+
+    // Points of a depth frame come in row order, so neighbours mostly share
+    // a voxel. A run of points with the same key is summed up locally and
+    // only then added to the table.
+    voxel run;
+    run.key = EMPTY_KEY;
+    run.count = 0;
+    size_t run_first = 0;
+    bool centroid = mode == CENTROID;
+
+    auto flush = [&]()
+    {
+        if (run.count == 0)
+            return;
+        uint64_t hash = voxel_hash(run.key);
+        bool inserted;
+        voxel &v = tile.find_or_insert(run.key, hash, inserted);
+        if (inserted && centroid)
+        {
+            v = run;
+            v.partition = (uint32_t)(hash >> (64 - PARTITION_BITS));
+        }
+        else if (inserted)
+        {
+            const float *p = in_xyz + run_first * xyz_stride;
+            const float *n = in_normals ? in_normals + run_first * normals_stride : nullptr;
+            const uint8_t *c = in_rgb ? in_rgb + run_first * 3 : nullptr;
+            v.key = run.key;
+            v.count = 1;
+            v.partition = (uint32_t)(hash >> (64 - PARTITION_BITS));
+            for (int k = 0; k < 3; k++)
+            {
+                v.xyz[k] = p[k];
+                v.normal[k] = n ? n[k] : 0.0f;
+                v.rgb[k] = c ? c[k] : 0;
+            }
+        }
+        else if (centroid)
+        {
+            v.count += run.count;
+            for (int k = 0; k < 3; k++)
+            {
+                v.xyz[k] += run.xyz[k];
+                v.normal[k] += run.normal[k];
+                v.rgb[k] += run.rgb[k];
+            }
+        }
+    };
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const float *p = in_xyz + i * xyz_stride;
+        uint64_t key;
+        if (!voxel_key(p, inv_voxel_size, key))
+            continue;
+        if (key != run.key)
+        {
+            flush();
+            run.key = key;
+            run.count = 0;
+            run_first = i;
+            for (int k = 0; k < 3; k++)
+            {
+                run.xyz[k] = 0.0f;
+                run.normal[k] = 0.0f;
+                run.rgb[k] = 0;
+            }
+        }
+        run.count++;
+        if (!centroid)
+            continue;
+        run.xyz[0] += p[0];
+        run.xyz[1] += p[1];
+        run.xyz[2] += p[2];
+        if (in_normals)
+        {
+            const float *n = in_normals + i * normals_stride;
+            run.normal[0] += n[0];
+            run.normal[1] += n[1];
+            run.normal[2] += n[2];
+        }
+        if (in_rgb)
+        {
+            const uint8_t *c = in_rgb + i * 3;
+            run.rgb[0] += c[0];
+            run.rgb[1] += c[1];
+            run.rgb[2] += c[2];
+        }
+    }
+    flush();
+
+    // counting sort of the voxels by partition.
+    tile.partition_offsets.assign(NUM_PARTITIONS + 1, 0);
+    for (auto &&v : tile.voxels)
+        tile.partition_offsets[v.partition + 1]++;
+    for (int p = 0; p < NUM_PARTITIONS; p++)
+        tile.partition_offsets[p + 1] += tile.partition_offsets[p];
+    std::vector<uint32_t> fill(tile.partition_offsets.begin(),
+                               tile.partition_offsets.end() - 1);
+    tile.order.resize(tile.voxels.size());
+    for (uint32_t j = 0; j < tile.voxels.size(); j++)
+        tile.order[fill[tile.voxels[j].partition]++] = j;
+}
+
+void voxelgrid::merge_partition(const int &p, const int &num_tiles)
+{
+    size_t capacity = 0;
+    for (int t = 0; t < num_tiles; t++)
+        capacity += tiles[t].partition_offsets[p + 1] - tiles[t].partition_offsets[p];
+
+    table &part = partitions[p];
+    part.reset(capacity);
+    // tiles in order, so the first voxel seen holds the first point.
+    for (int t = 0; t < num_tiles; t++)
+    {
+        const table &tile = tiles[t];
+        for (uint32_t j = tile.partition_offsets[p]; j < tile.partition_offsets[p + 1]; j++)
+        {
+            const voxel &src = tile.voxels[tile.order[j]];
+            bool inserted;
+            voxel &v = part.find_or_insert(src.key, voxel_hash(src.key), inserted);
+            if (inserted)
+            {
+                v = src;
+            }
+            else if (mode == CENTROID)
+            {
+                v.count += src.count;
+                for (int k = 0; k < 3; k++)
+                {
+                    v.xyz[k] += src.xyz[k];
+                    v.normal[k] += src.normal[k];
+                    v.rgb[k] += src.rgb[k];
+                }
+            }
+        }
+    }
+}
+
+size_t voxelgrid::process(const float *xyz,
+                          const size_t &num_points,
+                          const int &xyz_stride,
+                          const uint8_t *rgb,
+                          const float *normals,
+                          const int &normals_stride)
+{
+    in_xyz = xyz;
+    in_rgb = rgb;
+    in_normals = normals;
+    this->xyz_stride = xyz_stride;
+    this->normals_stride = normals_stride;
+
+    // 1. bins the tiles.
+    int num_tiles = (int)((num_points + TILE_SIZE - 1) / TILE_SIZE);
+    if (tiles.size() < (size_t)num_tiles)
+        tiles.resize(num_tiles);
+    parallel_for(0, num_tiles, [&](int t0, int t1)
+                 {
+                     for (int t = t0; t < t1; t++)
+                         bin_tile(tiles[t],
+                                  (size_t)t * TILE_SIZE,
+                                  std::min(num_points, (size_t)(t + 1) * TILE_SIZE));
+                 });
+
+    // 2. merges the voxels that are in more than one tile.
+    partitions.resize(NUM_PARTITIONS);
+    parallel_for(0, NUM_PARTITIONS, [&](int p0, int p1)
+                 {
+                     for (int p = p0; p < p1; p++)
+                         merge_partition(p, num_tiles);
+                 });
+
+    // 3. writes the voxels.
+    partition_offsets.assign(NUM_PARTITIONS + 1, 0);
+    for (int p = 0; p < NUM_PARTITIONS; p++)
+        partition_offsets[p + 1] = partition_offsets[p] + partitions[p].voxels.size();
+    num_voxels = partition_offsets[NUM_PARTITIONS];
+    this->xyz.resize(num_voxels * 3);
+    this->rgb.resize(rgb ? num_voxels * 3 : 0);
+    this->nxyz.resize(normals ? num_voxels * 3 : 0);
+
+    parallel_for(0, NUM_PARTITIONS, [&](int p0, int p1)
+                 {
+                     for (int p = p0; p < p1; p++)
+                     {
+                         size_t o = partition_offsets[p] * 3;
+                         for (auto &&v : partitions[p].voxels)
+                         {
+                             float inv_count = 1.0f / v.count;
+                             for (int k = 0; k < 3; k++)
+                                 this->xyz[o + k] = v.xyz[k] * inv_count;
+                             if (rgb)
+                                 for (int k = 0; k < 3; k++)
+                                     this->rgb[o + k] = (uint8_t)((v.rgb[k] + v.count / 2) / v.count);
+                             if (normals)
+                             {
+                                 float norm = std::sqrt(v.normal[0] * v.normal[0] +
+                                                        v.normal[1] * v.normal[1] +
+                                                        v.normal[2] * v.normal[2]);
+                                 float inv_norm = norm > 0.0f ? 1.0f / norm : 0.0f;
+                                 for (int k = 0; k < 3; k++)
+                                     this->nxyz[o + k] = v.normal[k] * inv_norm;
+                             }
+                             o += 3;
+                         }
+                     }
+                 });
+
+    return num_voxels;
+}
+
+size_t voxelgrid::size()
+{
+    return num_voxels;
+}
+
+const float *voxelgrid::points()
+{
+    return xyz.data();
+}
+
+const uint8_t *voxelgrid::colors()
+{
+    return rgb.empty() ? nullptr : rgb.data();
+}
+
+const float *voxelgrid::normals()
+{
+    return nxyz.empty() ? nullptr : nxyz.data();
+}
+
+void voxelgrid::parallel_for(const int &begin,
+                             const int &end,
+                             const std::function<void(int, int)> &fn)
+{
+    if (pool != nullptr)
+        pool->parallel_for(begin, end, fn);
+    else
+        fn(begin, end);
+}
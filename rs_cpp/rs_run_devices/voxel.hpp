@@ -0,0 +1,143 @@
+#ifndef VOXEL_HPP
+#define VOXEL_HPP
+
+#include <stdint.h>
+
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "workerpool.hpp"
+
+/**
+ * @brief Voxel grid downsampling of point clouds.
+ *
+ * The points are binned into cubes of 'voxel_size' and each occupied voxel
+ * becomes one point, either the centroid of its points or its first point.
+ *
+ * 1. The input is split into fixed tiles of consecutive points, every tile
+ *    bins its points into its own open addressing (linear probing) hash.
+ * 2. The voxels of the tiles are split over a fixed number of partitions by
+ *    their hash, every partition merges its share into its own hash.
+ * 3. The partitions are written out in order.
+ * No step needs a lock and the result does not depend on the number of
+ * threads. Tables are allocated once and reused across frames.
+ *
+ */
+class voxelgrid
+{
+public:
+    enum reduction
+    {
+        CENTROID = 0,
+        FIRST = 1,
+    };
+
+    /**
+     * @brief Construct a new voxelgrid object
+     *
+     * @param voxel_size edge length of a voxel in meters.
+     * @param mode centroid or first point of a voxel.
+     * @param pool Pool used for the tiles/partitions, nullptr runs inline.
+     */
+    voxelgrid(const float &voxel_size,
+              const reduction &mode = CENTROID,
+              workerpool *pool = nullptr);
+
+    void set_voxel_size(const float &voxel_size);
+    void set_reduction(const reduction &mode);
+
+    /**
+     * @brief Parses "centroid" or "first".
+     *
+     * @param name reduction name.
+     * @return reduction
+     */
+    static reduction reduction_from_string(const std::string &name);
+
+    /**
+     * @brief Downsamples a point cloud. Non finite points are dropped.
+     *
+     * @param xyz x,y,z of the first point, 'xyz_stride' floats per point.
+     * @param num_points number of points.
+     * @param xyz_stride floats per point (e.g. 4 for x,y,z,w).
+     * @param rgb optional r,g,b per point.
+     * @param normals optional normals, 'normals_stride' floats per point.
+     *                The centroid normals are normalized again.
+     * @param normals_stride floats per normal.
+     * @return size_t number of voxels.
+     */
+    size_t process(const float *xyz,
+                   const size_t &num_points,
+                   const int &xyz_stride = 3,
+                   const uint8_t *rgb = nullptr,
+                   const float *normals = nullptr,
+                   const int &normals_stride = 3);
+
+    size_t size();
+
+    /**
+     * @brief Voxels of the last call, x,y,z / r,g,b / nx,ny,nz per voxel.
+     * colors()/normals() are nullptr if they were not given.
+     *
+     */
+    const float *points();
+    const uint8_t *colors();
+    const float *normals();
+
+private:
+    struct voxel
+    {
+        uint64_t key;
+        uint32_t count;
+        uint32_t partition;
+        float xyz[3];
+        float normal[3];
+        uint32_t rgb[3];
+    };
+
+    struct table
+    {
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> slots;
+        std::vector<voxel> voxels;
+        // voxel indices sorted by partition (tiles only).
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> partition_offsets;
+
+        void reset(const size_t &capacity);
+        voxel &find_or_insert(const uint64_t &key, const uint64_t &hash, bool &inserted);
+    };
+
+    void bin_tile(table &tile,
+                  const size_t &begin,
+                  const size_t &end);
+    void merge_partition(const int &p, const int &num_tiles);
+    void parallel_for(const int &begin,
+                      const int &end,
+                      const std::function<void(int, int)> &fn);
+
+    float inv_voxel_size = 100.0f;
+    reduction mode = CENTROID;
+    workerpool *pool = nullptr;
+
+    // input of the current call.
+    const float *in_xyz = nullptr;
+    const uint8_t *in_rgb = nullptr;
+    const float *in_normals = nullptr;
+    int xyz_stride = 3;
+    int normals_stride = 3;
+
+    std::vector<table> tiles;
+    std::vector<table> partitions;
+    std::vector<size_t> partition_offsets;
+
+    std::vector<float> xyz;
+    std::vector<uint8_t> rgb;
+    std::vector<float> nxyz;
+    size_t num_voxels = 0;
+};
+
+#endif
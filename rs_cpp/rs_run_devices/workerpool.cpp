@@ -0,0 +1,123 @@
+#include "workerpool.hpp"
+
+workerpool::workerpool(const int &num_threads)
+    : next_chunk(0),
+      done_chunks(0)
+{
+    int n = num_threads > 0 ? num_threads : (int)std::thread::hardware_concurrency();
+    // The calling thread also works on the chunks.
+    for (int i = 1; i < n; i++)
+        workers.push_back(std::thread(&workerpool::run, this));
+}
+
+workerpool::~workerpool()
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        running = false;
+    }
+    cv.notify_all();
+    for (auto &&worker : workers)
+        if (worker.joinable())
+            worker.join();
+}
+
+void workerpool::parallel_for(const int &begin,
+                              const int &end,
+                              const std::function<void(int, int)> &fn)
+{
+    if (end <= begin)
+        return;
+    if (workers.empty() || end - begin == 1)
+    {
+        fn(begin, end);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_guard(call_mux);
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        // A few chunks per thread to balance uneven rows.
+        int num_chunks = std::min(end - begin, size() * 4);
+        job = &fn;
+        job_begin = begin;
+        job_end = end;
+        job_chunk = (end - begin + num_chunks - 1) / num_chunks;
+        job_chunks = (end - begin + job_chunk - 1) / job_chunk;
+        next_chunk = 0;
+        done_chunks = 0;
+        generation++;
+    }
+    cv.notify_all();
+
+    run_chunks(fn, begin, end, job_chunk, job_chunks);
+
+    std::unique_lock<std::mutex> lock(mux);
+    // Also waits for the workers to leave the job before it is replaced.
+    done_cv.wait(lock, [this]
+                 { return done_chunks == job_chunks && active_workers == 0; });
+    job = nullptr;
+}
+
+int workerpool::size()
+{
+    return (int)workers.size() + 1;
+}
+
+void workerpool::run()
+{
+    int seen_generation = 0;
+    while (true)
+    {
+        const std::function<void(int, int)> *fn = nullptr;
+        int begin = 0;
+        int end = 0;
+        int chunk_size = 1;
+        int num_chunks = 0;
+        {
+            std::unique_lock<std::mutex> lock(mux);
+            cv.wait(lock, [this, &seen_generation]
+                    { return !running || generation != seen_generation; });
+            if (!running)
+                return;
+            seen_generation = generation;
+            // A worker that wakes up after the job is done skips it.
+            if (job == nullptr)
+                continue;
+            fn = job;
+            begin = job_begin;
+            end = job_end;
+            chunk_size = job_chunk;
+            num_chunks = job_chunks;
+            active_workers++;
+        }
+        run_chunks(*fn, begin, end, chunk_size, num_chunks);
+        {
+            std::lock_guard<std::mutex> guard(mux);
+            active_workers--;
+        }
+        done_cv.notify_all();
+    }
+}
+
+void workerpool::run_chunks(const std::function<void(int, int)> &fn,
+                            const int &begin,
+                            const int &end,
+                            const int &chunk_size,
+                            const int &num_chunks)
+{
+    while (true)
+    {
+        int chunk = next_chunk++;
+        if (chunk >= num_chunks)
+            return;
+        int start = begin + chunk * chunk_size;
+        int stop = std::min(end, start + chunk_size);
+        fn(start, stop);
+        if (++done_chunks == num_chunks)
+        {
+            std::lock_guard<std::mutex> guard(mux);
+            done_cv.notify_all();
+        }
+    }
+}
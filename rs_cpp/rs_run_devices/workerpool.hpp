@@ -0,0 +1,78 @@
+#ifndef WORKERPOOL_HPP
+#define WORKERPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of threads for data parallel loops (e.g. over image rows).
+ *
+ * 'parallel_for' splits a range into chunks that are processed by the
+ * workers and the calling thread, and returns once all chunks are done.
+ * Calls from multiple threads are serialized, so one pool can be shared
+ * by all capture threads.
+ *
+ */
+class workerpool
+{
+public:
+    /**
+     * @brief Construct a new workerpool object
+     *
+     * @param num_threads Number of threads incl. the caller, 0 = number of cores.
+     */
+    explicit workerpool(const int &num_threads = 0);
+    ~workerpool();
+
+    /**
+     * @brief Runs fn over [begin, end) in chunks.
+     *
+     * @param begin start of the range.
+     * @param end end of the range (exclusive).
+     * @param fn called with the [start, stop) of a chunk.
+     */
+    void parallel_for(const int &begin,
+                      const int &end,
+                      const std::function<void(int, int)> &fn);
+
+    /**
+     * @brief Number of threads incl. the caller.
+     *
+     * @return int
+     */
+    int size();
+
+private:
+    void run();
+    void run_chunks(const std::function<void(int, int)> &fn,
+                    const int &begin,
+                    const int &end,
+                    const int &chunk_size,
+                    const int &num_chunks);
+
+    std::vector<std::thread> workers;
+    std::mutex call_mux;
+    std::mutex mux;
+    std::condition_variable cv;
+    std::condition_variable done_cv;
+    bool running = true;
+    int generation = 0;
+    int active_workers = 0;
+
+    // current job, guarded by 'mux' except for the atomic counters. The
+    // workers copy it under the lock before working on it.
+    const std::function<void(int, int)> *job = nullptr;
+    int job_begin = 0;
+    int job_end = 0;
+    int job_chunk = 1;
+    int job_chunks = 0;
+    std::atomic<int> next_chunk;
+    std::atomic<int> done_chunks;
+};
+
+#endif
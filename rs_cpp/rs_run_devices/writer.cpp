@@ -0,0 +1,68 @@
+#include "writer.hpp"
+
+asyncwriter::asyncwriter(const size_t &max_pending)
+    : max_pending(std::max<size_t>(1, max_pending))
+{
+}
+
+asyncwriter::~asyncwriter()
+{
+    stop();
+}
+
+void asyncwriter::start()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    if (running)
+        return;
+    running = true;
+    th = std::thread(&asyncwriter::run, this);
+}
+
+void asyncwriter::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        if (!running)
+            return;
+        running = false;
+    }
+    cv.notify_all();
+    th.join();
+}
+
+bool asyncwriter::push(const std::function<void()> &job)
+{
+    {
+        std::lock_guard<std::mutex> guard(mux);
+        if (!running || jobs.size() >= max_pending)
+            return false;
+        jobs.push_back(job);
+    }
+    cv.notify_one();
+    return true;
+}
+
+size_t asyncwriter::pending()
+{
+    std::lock_guard<std::mutex> guard(mux);
+    return jobs.size();
+}
+
+void asyncwriter::run()
+{
+    std::unique_lock<std::mutex> lock(mux);
+    while (true)
+    {
+        cv.wait(lock, [this]
+                { return !running || !jobs.empty(); });
+        // the queued writes are done before stopping.
+        if (jobs.empty())
+            break;
+        std::function<void()> job = jobs.front();
+        jobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef WRITER_HPP
+#define WRITER_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Runs file writes on a background thread, so that large files
+ * (e.g. the fused point cloud) do not stall the capture threads.
+ *
+ * At most 'max_pending' writes are queued, a write that does not fit is
+ * dropped. 'stop' writes what is still queued.
+ *
+ */
+class asyncwriter
+{
+public:
+    /**
+     * @brief Construct a new asyncwriter object
+     *
+     * @param max_pending max number of queued writes.
+     */
+    explicit asyncwriter(const size_t &max_pending = 4);
+    ~asyncwriter();
+
+    void start();
+    void stop();
+
+    /**
+     * @brief Queues a write.
+     *
+     * @param job function that writes the file.
+     * @return bool false if the queue is full and the write was dropped.
+     */
+    bool push(const std::function<void()> &job);
+
+    size_t pending();
+
+private:
+    void run();
+
+    size_t max_pending;
+    bool running = false;
+    std::thread th;
+    std::mutex mux;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> jobs;
+};
+
+#endif
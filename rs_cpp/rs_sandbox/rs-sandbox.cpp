@@ -32,6 +32,7 @@
 #include <thread>
 #include <vector>
 #include <string>
+#include <sstream>
 #include <algorithm>
 
 #include <unistd.h>
@@ -45,6 +46,9 @@
 #include <dirent.h>
 #include <opencv2/opencv.hpp> // Include OpenCV API
 
+#include "../rs_run_devices/filter.hpp"
+#include "../rs_run_devices/metadata.hpp"
+
 // Usefull links:
 // https://github.com/IntelRealSense/librealsense/tree/master/examples/software-device
 // https://github.com/IntelRealSense/librealsense/blob/master/examples/post-processing/rs-post-processing.cpp
@@ -93,6 +97,7 @@ public:
     const int H = 480;
     const int BPP = 2;
     const float depth_unit = 0.0010000000474974513f;
+    const float stereo_baseline = 50.16090393066406f; // mm
 
     rs2_timestamp_domain domain = RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK;
 
@@ -144,7 +149,7 @@ public:
         rs2::software_sensor depth_sensor = dev.add_sensor("Depth"); // Define single sensor
         depth_stream_profile = depth_sensor.add_video_stream(depth_video_stream);
         depth_sensor.add_read_only_option(RS2_OPTION_DEPTH_UNITS, depth_unit);
-        depth_sensor.add_read_only_option(RS2_OPTION_STEREO_BASELINE, 50.16090393066406f);
+        depth_sensor.add_read_only_option(RS2_OPTION_STEREO_BASELINE, stereo_baseline);
 
         // dev.create_matcher(RS2_MATCHER_DLR_C);
         // sync = rs2::syncer();
@@ -250,27 +255,18 @@ public:
     };
 };
 
-int main(int argc, char *argv[])
+/**
+ * @brief Lists the files in a folder, relative to that folder.
+ *
+ * Subfolders (e.g. the shards created with --storage-fanout) are walked
+ * recursively, so the sorted list keeps the recording order.
+ *
+ * Taken from: https://stackoverflow.com/questions/612097/how-can-i-get-the-list-of-files-in-a-directory-using-c-or-c
+ */
+int list_files(const std::string &path,
+               std::vector<std::string> &file_names,
+               const std::string &prefix = "")
 {
-
-    const auto depth_window_name1 = "Display Depth Image";
-    cv::namedWindow(depth_window_name1, cv::WINDOW_AUTOSIZE);
-    const auto depth_window_name2 = "Display Depth Image Filtered";
-    cv::namedWindow(depth_window_name2, cv::WINDOW_AUTOSIZE);
-    const auto depth_window_name3 = "Display Depth Image All Filtered";
-    cv::namedWindow(depth_window_name3, cv::WINDOW_AUTOSIZE);
-    int key1, key2, key3;
-
-    std::string path = "/data/tmp/depth";
-    // std::string path = "/data/tmp/depth_16.bin";
-    // std::string path = "/code/realsense-simple-wrapper/output/testing_cpp/001622070408/1660659930/depth/000210127864.bin";
-    // std::string path = "/code/realsense-simple-wrapper/data/local/realsense-15fps/001622070408/1681746140/depth/00000000000027746044.bin";
-
-    LocalDepthSensor LDS;
-    LDS.initialize();
-
-    // Taken from: https://stackoverflow.com/questions/612097/how-can-i-get-the-list-of-files-in-a-directory-using-c-or-c
-    std::vector<std::string> file_names;
     DIR *dir;
     struct dirent *ent;
     if ((dir = opendir(path.c_str())) != NULL)
@@ -282,9 +278,14 @@ int main(int argc, char *argv[])
                 continue;
             if (strcmp("..", ent->d_name) == 0)
                 continue;
-            file_names.push_back(std::string(ent->d_name));
+            std::string name = prefix + std::string(ent->d_name);
+            if (ent->d_type == DT_DIR)
+                list_files(path + "/" + ent->d_name, file_names, name + "/");
+            else
+                file_names.push_back(name);
         }
         closedir(dir);
+        return EXIT_SUCCESS;
     }
     else
     {
@@ -292,6 +293,222 @@ int main(int argc, char *argv[])
         perror("");
         return EXIT_FAILURE;
     }
+}
+
+/**
+ * @brief Compares the rs2 filter chain with the in-house 'depthfilter' on the
+ * recorded depth data, using the same threshold/spatial/temporal params.
+ *
+ * @param LDS initialized local depth sensor.
+ * @param path folder with the recorded depth .bin files.
+ * @param file_names sorted file names in the folder.
+ * @param num_threads threads of the depthfilter, 0 = number of cores.
+ * @return int
+ */
+int benchmark(LocalDepthSensor &LDS,
+              const std::string &path,
+              const std::vector<std::string> &file_names,
+              const int &num_threads)
+{
+    // The in-house spatial filter does not fill holes.
+    LDS.spat_filter.set_option(RS2_OPTION_HOLES_FILL, 0);
+
+    // The baseline the rs2 disparity transform of this run uses.
+    float baseline_m = LDS.depth_sensors[0].get_option(RS2_OPTION_STEREO_BASELINE) * 0.001f;
+
+    workerpool pool(num_threads);
+    depthfilter filter(LDS.depth_unit,
+                       baseline_m,
+                       LDS.depth_intrinsics.fx,
+                       &pool);
+    filter.set_threshold(0.5f, 5.0f);
+    filter.set_spatial(0.5f, 20.0f, 2);
+    filter.set_temporal(0.4f, 20.0f, 3);
+
+    const size_t num_pixels = LDS.W * LDS.H;
+    std::vector<uint16_t> buffer(num_pixels);
+    std::vector<uint16_t> filtered(num_pixels);
+    double rs2_ms = 0.0;
+    double own_ms = 0.0;
+    double stage_ms[depthfilter::NUM_STAGES] = {0};
+    double abs_diff = 0.0;
+    int64_t num_compared = 0;
+    int64_t num_hole_mismatch = 0;
+    int frame_number = 0;
+
+    for (const std::string &file_name : file_names)
+    {
+        frame_number++;
+        std::ifstream input(path + "/" + file_name, std::ios::binary);
+        input.read((char *)buffer.data(), num_pixels * 2);
+        LDS.add_pixels(buffer.data(), frame_number);
+        LDS.get_depth_data();
+
+        auto t0 = std::chrono::steady_clock::now();
+        rs2::frame df = LDS.filter_depth_data(rs2::frame(LDS.depth), false, true, true, true);
+        auto t1 = std::chrono::steady_clock::now();
+        filter.process(buffer.data(), LDS.W, LDS.H, LDS.W * LDS.BPP, filtered.data());
+        auto t2 = std::chrono::steady_clock::now();
+
+        rs2_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        own_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        for (int s = 0; s < depthfilter::NUM_STAGES; s++)
+            stage_ms[s] += filter.stage_duration_ns((depthfilter::stage)s) * 1e-6;
+
+        const uint16_t *ref = (const uint16_t *)df.get_data();
+        for (size_t i = 0; i < num_pixels; i++)
+        {
+            if ((ref[i] == 0) != (filtered[i] == 0))
+                num_hole_mismatch++;
+            else if (ref[i] != 0)
+            {
+                abs_diff += std::abs((int)ref[i] - (int)filtered[i]);
+                num_compared++;
+            }
+        }
+    }
+
+    if (frame_number == 0)
+        return EXIT_FAILURE;
+
+    printf("frames                 : %d\n", frame_number);
+    printf("threads                : %d\n", pool.size());
+    printf("rs2 chain              : %.3f ms/frame\n", rs2_ms / frame_number);
+    printf("depthfilter            : %.3f ms/frame (x%.2f)\n",
+           own_ms / frame_number, rs2_ms / own_ms);
+    for (int s = 0; s < depthfilter::NUM_STAGES; s++)
+        printf("  %-20s : %.3f ms/frame\n",
+               depthfilter::stage_name((depthfilter::stage)s).c_str(),
+               stage_ms[s] / frame_number);
+    printf("mean abs diff          : %.3f depth units\n",
+           num_compared > 0 ? abs_diff / num_compared : 0.0);
+    printf("hole mismatch          : %.4f %%\n",
+           100.0 * num_hole_mismatch / (num_pixels * frame_number));
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Compares the per-frame metadata extraction of the csv writer:
+ * 'supports_frame_metadata' on every field of every frame (before) vs the
+ * cached 'metadatamask' of the profile (now). Both are formatted in memory
+ * so that the file IO, which is the same for both, is not measured.
+ *
+ * @param LDS initialized local depth sensor.
+ * @param num_frames number of frames.
+ * @return int
+ */
+int metadata_benchmark(LocalDepthSensor &LDS, const int &num_frames)
+{
+    // Every field is set, the worst case of the extraction.
+    for (int i = 0; i < RS2_FRAME_METADATA_COUNT; i++)
+        LDS.depth_sensors[0].set_metadata((rs2_frame_metadata_value)i, 1000 + i);
+
+    const size_t num_pixels = LDS.W * LDS.H;
+    std::vector<uint16_t> buffer(num_pixels, 0);
+    metadatacache cache;
+    metadatarecord record;
+    double before_ms = 0.0;
+    double extract_ms = 0.0;
+    double now_ms = 0.0;
+    int num_fields = 0;
+    int num_mismatch = 0;
+
+    for (int frame_number = 1; frame_number <= num_frames; frame_number++)
+    {
+        LDS.add_pixels(buffer.data(), frame_number);
+        rs2::frame frm = LDS.fset.first_or_default(RS2_STREAM_DEPTH);
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::ostringstream before;
+        before << "Stream,"
+               << rs2_stream_to_string(frm.get_profile().stream_type())
+               << "\nAttribute,Value\n";
+        for (size_t i = 0; i < RS2_FRAME_METADATA_COUNT; i++)
+        {
+            rs2_frame_metadata_value metadata_idx = (rs2_frame_metadata_value)i;
+            if (frm.supports_frame_metadata(metadata_idx))
+                before << rs2_frame_metadata_to_string(metadata_idx)
+                       << ","
+                       << frm.get_frame_metadata(metadata_idx)
+                       << "\n";
+        }
+        std::string before_csv = before.str();
+        auto t1 = std::chrono::steady_clock::now();
+        const metadatamask &mask = cache.query(frm);
+        mask.extract(frm, record);
+        auto t2 = std::chrono::steady_clock::now();
+        std::string now_csv;
+        mask.format(record, now_csv);
+        auto t3 = std::chrono::steady_clock::now();
+
+        before_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        extract_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        now_ms += std::chrono::duration<double, std::milli>(t3 - t1).count();
+        num_fields = record.count;
+        if (before_csv != now_csv)
+            num_mismatch++;
+    }
+
+    if (num_frames <= 0)
+        return EXIT_FAILURE;
+
+    printf("frames                 : %d\n", num_frames);
+    printf("fields                 : %d / %d\n", num_fields, (int)RS2_FRAME_METADATA_COUNT);
+    printf("supports + stream      : %.3f us/frame\n", 1e3 * before_ms / num_frames);
+    printf("mask extract           : %.3f us/frame\n", 1e3 * extract_ms / num_frames);
+    printf("mask extract + format  : %.3f us/frame (x%.2f)\n",
+           1e3 * now_ms / num_frames, before_ms / now_ms);
+    printf("csv mismatch           : %d frames\n", num_mismatch);
+    return num_mismatch == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+    // rs-sandbox benchmark <depth_path> [num_threads] : rs2 filters vs depthfilter.
+    if (argc > 1 && std::string(argv[1]) == "benchmark")
+    {
+        if (argc < 3)
+        {
+            printf("usage : rs-sandbox benchmark <depth_path> [num_threads]\n");
+            return EXIT_FAILURE;
+        }
+        std::string path = argv[2];
+        LocalDepthSensor LDS;
+        LDS.initialize();
+        std::vector<std::string> file_names;
+        if (list_files(path, file_names) != EXIT_SUCCESS)
+            return EXIT_FAILURE;
+        std::sort(file_names.begin(), file_names.end());
+        return benchmark(LDS, path, file_names, argc > 3 ? std::stoi(argv[3]) : 0);
+    }
+
+    // rs-sandbox metadata-benchmark [num_frames] : per-frame metadata csv.
+    if (argc > 1 && std::string(argv[1]) == "metadata-benchmark")
+    {
+        LocalDepthSensor LDS;
+        LDS.initialize();
+        return metadata_benchmark(LDS, argc > 2 ? std::stoi(argv[2]) : 1000);
+    }
+
+    const auto depth_window_name1 = "Display Depth Image";
+    cv::namedWindow(depth_window_name1, cv::WINDOW_AUTOSIZE);
+    const auto depth_window_name2 = "Display Depth Image Filtered";
+    cv::namedWindow(depth_window_name2, cv::WINDOW_AUTOSIZE);
+    const auto depth_window_name3 = "Display Depth Image All Filtered";
+    cv::namedWindow(depth_window_name3, cv::WINDOW_AUTOSIZE);
+    int key1, key2, key3;
+
+    std::string path = "/data/tmp/depth";
+    // std::string path = "/data/tmp/depth_16.bin";
+    // std::string path = "/code/realsense-simple-wrapper/output/testing_cpp/001622070408/1660659930/depth/000210127864.bin";
+    // std::string path = "/code/realsense-simple-wrapper/data/local/realsense-15fps/001622070408/1681746140/depth/00000000000027746044.bin";
+
+    LocalDepthSensor LDS;
+    LDS.initialize();
+
+    std::vector<std::string> file_names;
+    if (list_files(path, file_names) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
     std::sort(file_names.begin(), file_names.end());
 
     int frame_number = 0;
@@ -16,13 +16,17 @@ if __name__ == "__main__":
     for dev, trial_ts_filepath in dev_trial_ts_filepaths.items():
         for trial, ts_filepath in trial_ts_filepath.items():
 
-            ts_filepath = ts_filepath[0]
+            ts_filepath = [i for i in ts_filepath
+                           if i.endswith('timestamp.txt')][0]
             with open(ts_filepath, 'r') as f:
                 lines = f.readlines()
 
+            # a stream without a frame in a step (different fps) is -1.
             s_ts = [float(i.split("::")[0]) for i in lines]
             c_ts = [float(i.split("::")[1]) for i in lines]
             d_ts = [float(i.split("::")[2]) for i in lines]
+            c_ts = [i for i in c_ts if i != -1]
+            d_ts = [i for i in d_ts if i != -1]
 
             s_fps = float(len(s_ts))/((s_ts[-1]-s_ts[0])/1e9)
             c_fps = float(len(c_ts))/((c_ts[-1]-c_ts[0])/1e6)
@@ -27,11 +27,9 @@ def data_process_fn(**kwargs):
         image = read_color_file(color_dc.file)
         image = image.reshape(h_c, w_c, 3)
 
-        new_dir = "/".join(color_dc.file.split('/')[:-2]) + "/color_png"
-        os.makedirs(new_dir, exist_ok=True)
-
         new_file = color_dc.file.replace('/color/', '/color_png/')
         new_file = os.path.splitext(new_file)[0] + '.png'
+        os.makedirs(os.path.dirname(new_file), exist_ok=True)
         cv2.imwrite(new_file, image)
 
     printout("-"*80, 'i')
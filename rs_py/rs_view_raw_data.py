@@ -37,6 +37,10 @@ def data_process_fn(**kwargs):
                                 calib_data['color'].get('format', None))
         depth = read_depth_file(depth_dc.file)
 
+        # the depth has the color size if it is aligned to color.
+        if calib_data['depth']['aligned']:
+            h_d, w_d = h_c, w_c
+
         image = image.reshape(h_c, w_c, 3)
         depth = depth[-h_d*w_d:].reshape(h_d, w_d)
         # depth_i = depth[-(h_d//3)*(w_d//3+2):].reshape(h_d//3, w_d//3+2)
@@ -63,6 +67,9 @@ def data_process_fn(**kwargs):
                     (0, 255, 0),
                     2,
                     cv2.LINE_AA)
+        # unaligned depth keeps its own resolution.
+        if depth.shape[1] != w_c:
+            depth = cv2.resize(depth, (w_c, h_d * w_c // w_d))
         imgs.append(np.vstack([image, depth]))
 
         # break
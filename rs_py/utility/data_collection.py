@@ -6,18 +6,32 @@ from typing import Tuple, Optional
 from .utils import printout
 
 
+def _list_sensor_files(sensor_path: str) -> list:
+    # The per-frame folders can be fanned out into numbered subfolders
+    # (--storage-fanout), these are walked in order transparently.
+    out = []
+    for filename in sorted(os.listdir(sensor_path)):
+        filepath = os.path.join(sensor_path, filename)
+        if os.path.isdir(filepath):
+            out += _list_sensor_files(filepath)
+        else:
+            out.append(filepath)
+    return out
+
+
 def get_filepaths(base_path: str, sensor: str) -> dict:
     path = {}
     for device in sorted(os.listdir(base_path)):
-        path[device] = {}
         device_path = os.path.join(base_path, device)
+        # Folders of all devices (e.g. _sync) are not devices.
+        if device.startswith('_') or not os.path.isdir(device_path):
+            continue
+        path[device] = {}
         for ts in sorted(os.listdir(device_path)):
-            path[device][ts] = []
             sensor_path = os.path.join(base_path, device, ts, sensor)
-            filenames = sorted(os.listdir(sensor_path))
-            # filenames.reverse()
-            for filename in filenames:
-                path[device][ts].append(os.path.join(sensor_path, filename))
+            if not os.path.isdir(sensor_path):
+                continue
+            path[device][ts] = _list_sensor_files(sensor_path)
     return path
 
 
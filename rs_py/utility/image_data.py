@@ -95,7 +95,16 @@ def read_calib_file(calib_file: str) -> dict:
                 if line_count == 3:
                     calib_data['depth']['depth_scale'] = float(row[0])
                     calib_data['depth']['depth_baseline'] = float(row[1])
+                if line_count == 4:
+                    calib_data['depth']['filtered_width'] = int(row[0])
+                    calib_data['depth']['filtered_height'] = int(row[1])
+                    # the depth is saved with the color intrinsics if aligned.
+                    if len(row) > 2 and row[2] != '':
+                        calib_data['depth']['aligned'] = row[2] != '0'
                 line_count += 1
+            # older recordings are always aligned.
+            if 'depth' in calib_data:
+                calib_data['depth'].setdefault('aligned', True)
     return calib_data
 
 